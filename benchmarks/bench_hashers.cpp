@@ -0,0 +1,282 @@
+#include <array>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dottorrent/hash.hpp"
+#include "dottorrent/hash_function.hpp"
+#include "dottorrent/hasher/native_hasher.hpp"
+#include "dottorrent/hasher/backends/native.hpp"
+#ifdef DOTTORRENT_USE_OPENSSL
+#include "dottorrent/hasher/openssl_hasher.hpp"
+#endif
+#ifdef DOTTORRENT_USE_ISAL
+#include "dottorrent/hasher/isal_multi_buffer_hasher.hpp"
+#endif
+
+#include "hasher/backends/native_kernels.hpp"
+
+namespace dt = dottorrent;
+namespace native = dottorrent::native;
+
+namespace {
+
+// size of a v2 merkle tree leaf and a typical v1 piece
+constexpr std::size_t leaf_size = 16 * 1024;
+constexpr std::size_t piece_size = 1024 * 1024;
+constexpr std::size_t job_count = 16;
+
+const std::vector<std::byte>& random_data()
+{
+    static const auto data = [] {
+        std::mt19937 rng(0);
+        std::vector<std::byte> v(job_count * piece_size);
+        for (auto& b : v) b = static_cast<std::byte>(rng());
+        return v;
+    }();
+    return data;
+}
+
+template <typename Hasher>
+void single_buffer(benchmark::State& state, dt::hash_function f)
+{
+    const auto size = static_cast<std::size_t>(state.range(0));
+    auto data = std::span(random_data()).first(size);
+    Hasher hasher(f);
+    std::array<std::byte, 64> out {};
+
+    for (auto _ : state) {
+        hasher.update(data);
+        hasher.finalize_to(out);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * size));
+}
+
+template <typename MultiBufferHasher, typename... Args>
+void multi_buffer(benchmark::State& state, Args... args)
+{
+    const auto size = static_cast<std::size_t>(state.range(0));
+    const auto& data = random_data();
+    MultiBufferHasher hasher(args...);
+    hasher.resize(job_count);
+    std::array<std::byte, 64> out {};
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < job_count; ++i) {
+            hasher.submit(i, std::span(data).subspan(i * size, size));
+        }
+        for (std::size_t i = 0; i < job_count; ++i) {
+            hasher.finalize_to(i, out);
+        }
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * size * job_count));
+}
+
+void compress(benchmark::State& state,
+              void(*kernel)(std::uint32_t*, const std::byte*, std::size_t) noexcept,
+              bool supported = true)
+{
+    if (!supported) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    const auto blocks = static_cast<std::size_t>(state.range(0)) / 64;
+    std::array<std::uint32_t, 8> s {};
+
+    for (auto _ : state) {
+        kernel(s.data(), random_data().data(), blocks);
+        benchmark::DoNotOptimize(s);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * blocks * 64));
+}
+
+void compress_lanes(benchmark::State& state, native::lanes_compress_function kernel, bool supported)
+{
+    if (!supported) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    const auto blocks = static_cast<std::size_t>(state.range(0)) / 64;
+    std::array<std::array<std::uint32_t, 8>, native::lane_count> s {};
+    std::array<std::uint32_t*, native::lane_count> states {};
+    std::array<const std::byte*, native::lane_count> data {};
+    for (std::size_t i = 0; i < native::lane_count; ++i) {
+        states[i] = s[i].data();
+        data[i] = random_data().data() + i * blocks * 64;
+    }
+
+    for (auto _ : state) {
+        kernel(states.data(), data.data(), blocks);
+        benchmark::DoNotOptimize(s);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * blocks * 64 * native::lane_count));
+}
+
+void leaf_blocks(benchmark::State& state, native::kernels::batch_kernel kernel, bool supported)
+{
+    if (!supported) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    const auto blocks = static_cast<std::size_t>(state.range(0)) / leaf_size;
+    std::vector<dt::sha256_hash> out(blocks);
+
+    for (auto _ : state) {
+        native::kernels::sha256_leaf_blocks(
+                kernel, random_data().data(), blocks, reinterpret_cast<std::byte*>(out.data()));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * blocks * leaf_size));
+}
+
+void inner_nodes(benchmark::State& state, native::kernels::batch_kernel kernel, bool supported)
+{
+    if (!supported) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    const auto nodes = static_cast<std::size_t>(state.range(0));
+    std::vector<dt::sha256_hash> out(nodes);
+
+    for (auto _ : state) {
+        native::kernels::sha256_inner_nodes(
+                kernel, random_data().data(), nodes, reinterpret_cast<std::byte*>(out.data()));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * nodes));
+}
+
+/// Inner nodes hashed with update and finalize_to calls of a single buffer hasher, as before the batch kernels.
+template <typename Hasher>
+void inner_nodes_hasher(benchmark::State& state)
+{
+    const auto nodes = static_cast<std::size_t>(state.range(0));
+    const auto data = std::span(random_data());
+    Hasher hasher(dt::hash_function::sha256);
+    dt::sha256_hash out {};
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < nodes; ++i) {
+            hasher.update(data.subspan(64 * i, 32));
+            hasher.update(data.subspan(64 * i + 32, 32));
+            hasher.finalize_to(out);
+        }
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * nodes));
+}
+
+#ifdef DOTTORRENT_USE_OPENSSL
+void openssl_single_buffer(benchmark::State& state, dt::hash_function f)
+{
+    single_buffer<dt::openssl_hasher>(state, f);
+}
+#endif
+
+void native_single_buffer(benchmark::State& state, dt::hash_function f)
+{
+    single_buffer<dt::native_hasher>(state, f);
+}
+
+#ifdef DOTTORRENT_USE_OPENSSL
+void openssl_inner_nodes(benchmark::State& state)
+{
+    inner_nodes_hasher<dt::openssl_hasher>(state);
+}
+#endif
+
+#ifdef DOTTORRENT_USE_ISAL
+void isal_multi_buffer(benchmark::State& state, dt::hash_function f)
+{
+    multi_buffer<dt::isal_multi_buffer_hasher>(state, f);
+}
+#endif
+
+void native_multi_buffer(benchmark::State& state, dt::hash_function f,
+                         native::lanes_compress_function lanes_compress)
+{
+    if (f == dt::hash_function::sha1) {
+        multi_buffer<native::sha1_multi_buffer_hasher>(state, lanes_compress);
+    }
+    else {
+        multi_buffer<native::sha256_multi_buffer_hasher>(state, lanes_compress);
+    }
+}
+
+} // namespace
+
+
+// single buffer hashers
+
+#ifdef DOTTORRENT_USE_OPENSSL
+BENCHMARK_CAPTURE(openssl_single_buffer, sha1, dt::hash_function::sha1)->Arg(leaf_size)->Arg(piece_size);
+BENCHMARK_CAPTURE(openssl_single_buffer, sha256, dt::hash_function::sha256)->Arg(leaf_size)->Arg(piece_size);
+#endif
+BENCHMARK_CAPTURE(native_single_buffer, sha1, dt::hash_function::sha1)->Arg(leaf_size)->Arg(piece_size);
+BENCHMARK_CAPTURE(native_single_buffer, sha256, dt::hash_function::sha256)->Arg(leaf_size)->Arg(piece_size);
+
+// multi-buffer hashers, throughput of 16 messages
+
+#ifdef DOTTORRENT_USE_ISAL
+BENCHMARK_CAPTURE(isal_multi_buffer, sha1, dt::hash_function::sha1)->Arg(leaf_size)->Arg(piece_size);
+BENCHMARK_CAPTURE(isal_multi_buffer, sha256, dt::hash_function::sha256)->Arg(leaf_size)->Arg(piece_size);
+#endif
+BENCHMARK_CAPTURE(native_multi_buffer, sha1, dt::hash_function::sha1,
+                  native::sha1_lanes_compress())->Arg(leaf_size)->Arg(piece_size);
+BENCHMARK_CAPTURE(native_multi_buffer, sha256, dt::hash_function::sha256,
+                  native::sha256_lanes_compress())->Arg(leaf_size)->Arg(piece_size);
+
+// compression functions
+
+BENCHMARK_CAPTURE(compress, sha1_portable, native::kernels::sha1_compress_portable)->Arg(leaf_size);
+BENCHMARK_CAPTURE(compress, sha256_portable, native::kernels::sha256_compress_portable)->Arg(leaf_size);
+
+#if defined(DOTTORRENT_NATIVE_X86)
+BENCHMARK_CAPTURE(compress, sha1_sha_ni, native::kernels::sha1_compress_sha_ni,
+                  native::detected_cpu_features().sha_ni)->Arg(leaf_size);
+BENCHMARK_CAPTURE(compress, sha256_sha_ni, native::kernels::sha256_compress_sha_ni,
+                  native::detected_cpu_features().sha_ni)->Arg(leaf_size);
+BENCHMARK_CAPTURE(compress_lanes, sha1_avx2_x8, native::kernels::sha1_compress_x8_avx2,
+                  native::detected_cpu_features().avx2)->Arg(leaf_size);
+BENCHMARK_CAPTURE(compress_lanes, sha256_avx2_x8, native::kernels::sha256_compress_x8_avx2,
+                  native::detected_cpu_features().avx2)->Arg(leaf_size);
+
+// multi-buffer hashers with the AVX2 kernels, also on CPUs where SHA-NI is selected
+BENCHMARK_CAPTURE(native_multi_buffer, sha1_avx2_x8, dt::hash_function::sha1,
+                  native::detected_cpu_features().avx2 ? native::kernels::sha1_compress_x8_avx2 : nullptr)
+        ->Arg(leaf_size)->Arg(piece_size);
+BENCHMARK_CAPTURE(native_multi_buffer, sha256_avx2_x8, dt::hash_function::sha256,
+                  native::detected_cpu_features().avx2 ? native::kernels::sha256_compress_x8_avx2 : nullptr)
+        ->Arg(leaf_size)->Arg(piece_size);
+#endif
+
+// v2 leaf blocks, the digests of all 16 KiB blocks of a piece
+
+BENCHMARK_CAPTURE(leaf_blocks, portable, native::kernels::batch_kernel::portable, true)->Arg(piece_size);
+#if defined(DOTTORRENT_NATIVE_X86)
+BENCHMARK_CAPTURE(leaf_blocks, sha_ni, native::kernels::batch_kernel::sha_ni,
+                  native::detected_cpu_features().sha_ni)->Arg(piece_size);
+BENCHMARK_CAPTURE(leaf_blocks, avx2_x8, native::kernels::batch_kernel::avx2_x8,
+                  native::detected_cpu_features().avx2)->Arg(piece_size);
+BENCHMARK_CAPTURE(leaf_blocks, avx512_x16, native::kernels::batch_kernel::avx512_x16,
+                  native::detected_cpu_features().avx512)->Arg(piece_size);
+#endif
+
+// merkle tree inner nodes, the digests of a layer of 64 byte messages
+
+#ifdef DOTTORRENT_USE_OPENSSL
+BENCHMARK(openssl_inner_nodes)->Arg(4096);
+#endif
+BENCHMARK_CAPTURE(inner_nodes, portable, native::kernels::batch_kernel::portable, true)->Arg(4096);
+#if defined(DOTTORRENT_NATIVE_X86)
+BENCHMARK_CAPTURE(inner_nodes, sha_ni, native::kernels::batch_kernel::sha_ni,
+                  native::detected_cpu_features().sha_ni)->Arg(4096);
+BENCHMARK_CAPTURE(inner_nodes, avx2_x8, native::kernels::batch_kernel::avx2_x8,
+                  native::detected_cpu_features().avx2)->Arg(4096);
+BENCHMARK_CAPTURE(inner_nodes, avx512_x16, native::kernels::batch_kernel::avx512_x16,
+                  native::detected_cpu_features().avx512)->Arg(4096);
+#endif
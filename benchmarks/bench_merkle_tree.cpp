@@ -0,0 +1,95 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dottorrent/hash.hpp"
+#include "dottorrent/hash_function.hpp"
+#include "dottorrent/merkle_tree.hpp"
+#include "dottorrent/streaming_merkle_tree.hpp"
+#include "dottorrent/hasher/factory.hpp"
+
+namespace dt = dottorrent;
+
+namespace {
+
+using tree_type = dt::merkle_tree<dt::hash_function::sha256>;
+
+tree_type make_tree(std::size_t leaf_count)
+{
+    tree_type tree(leaf_count);
+    for (std::size_t i = 0; i < leaf_count; ++i) {
+        dt::sha256_hash leaf {};
+        for (std::size_t j = 0; j < sizeof(i); ++j) {
+            leaf.data()[j] = static_cast<std::byte>(i >> (8 * j));
+        }
+        tree.set_leaf(i, leaf);
+    }
+    return tree;
+}
+
+void set_counters(benchmark::State& state, std::size_t leaf_count)
+{
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * leaf_count));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * leaf_count * sizeof(dt::sha256_hash)));
+}
+
+} // namespace
+
+// merkle_tree::update, every layer of the tree is hashed before the next one.
+// Children and parents are read and written sequentially over the whole layer.
+static void merkle_update_breadth_first(benchmark::State& state)
+{
+    const auto leaf_count = std::size_t(1) << state.range(0);
+    auto tree = make_tree(leaf_count);
+    auto hasher = dt::make_hasher(dt::hash_function::sha256);
+
+    for (auto _ : state) {
+        tree.update(*hasher);
+        benchmark::DoNotOptimize(tree.root());
+    }
+    set_counters(state, leaf_count);
+}
+
+// merkle_tree::update_blocked, subtrees of 2^10 leaves are hashed up to their root while their nodes are in cache,
+// then their roots are hashed the same way.
+static void merkle_update_blocked(benchmark::State& state)
+{
+    const auto leaf_count = std::size_t(1) << state.range(0);
+    auto tree = make_tree(leaf_count);
+    auto hasher = dt::make_hasher(dt::hash_function::sha256);
+
+    for (auto _ : state) {
+        tree.update_blocked(*hasher);
+        benchmark::DoNotOptimize(tree.root());
+    }
+    set_counters(state, leaf_count);
+}
+
+// 1M, 16M and 64M leaves: files of 16 GiB, 256 GiB and 1 TiB.
+// The tree of 64M leaves takes 4 GiB of memory.
+BENCHMARK(merkle_update_breadth_first)->Arg(20)->Arg(24)->Arg(26)->Unit(benchmark::kMillisecond);
+BENCHMARK(merkle_update_blocked)->Arg(20)->Arg(24)->Arg(26)->Unit(benchmark::kMillisecond);
+
+// streaming_merkle_tree::set_leaf for all leaves of a file of 16 GiB and finalize,
+// with pieces of 1, 16 and 64 leaves: 16 KiB, 256 KiB and 1 MiB.
+static void streaming_merkle_set_leaf(benchmark::State& state)
+{
+    const auto leaf_count = std::size_t(1) << 20;
+    auto full_tree = make_tree(leaf_count);
+    const auto leaves = full_tree.get_layer(full_tree.tree_height());
+    const std::vector<dt::sha256_hash> leaf_hashes(leaves.begin(), leaves.end());
+
+    for (auto _ : state) {
+        auto tree = dt::streaming_merkle_tree(leaf_count, static_cast<std::size_t>(state.range(0)));
+        for (std::size_t i = 0; i < leaf_count; ++i) {
+            tree.set_leaf(i, leaf_hashes[i]);
+        }
+        tree.finalize();
+        benchmark::DoNotOptimize(tree.root());
+    }
+    set_counters(state, leaf_count);
+}
+
+BENCHMARK(streaming_merkle_set_leaf)->Arg(1)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond);
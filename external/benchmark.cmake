@@ -0,0 +1,26 @@
+if (TARGET benchmark::benchmark)
+    log_target_found(benchmark)
+    return()
+endif()
+
+find_package(benchmark QUIET)
+if (benchmark_FOUND)
+    log_module_found(benchmark)
+    return()
+endif()
+
+set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+
+if(EXISTS ${CMAKE_CURRENT_LIST_DIR}/benchmark)
+    log_dir_found(benchmark)
+    add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/benchmark)
+else()
+    log_fetch(benchmark)
+    FetchContent_Declare(
+            benchmark
+            GIT_REPOSITORY https://github.com/google/benchmark.git
+            GIT_TAG        main
+    )
+    FetchContent_MakeAvailable(benchmark)
+endif()
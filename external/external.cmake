@@ -28,3 +28,6 @@ if (DOTTORRENT_TESTS)
     include(${CMAKE_CURRENT_LIST_DIR}/Catch2.cmake)
 endif()
 
+if (DOTTORRENT_BENCHMARKS)
+    include(${CMAKE_CURRENT_LIST_DIR}/benchmark.cmake)
+endif()
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+#include "dottorrent/hash_function.hpp"
+#include "dottorrent/checksum.hpp"
+#include "dottorrent/file_storage.hpp"
+#include "dottorrent/data_chunk.hpp"
+#include "dottorrent/chunk_processor_base.hpp"
+#include "dottorrent/hash_checkpoint.hpp"
+#include "dottorrent/hasher/factory.hpp"
+
+namespace dottorrent {
+
+/// Data of a chunk that belongs to a single file.
+struct file_data_range
+{
+    /// Index of the file in the file_storage object.
+    std::size_t file_index;
+    /// Position in the file of the first byte of data.
+    std::size_t file_offset;
+    std::span<const std::byte> data;
+};
+
+/// Base class for the per file checksum hashers.
+///
+/// Every file that is being hashed has its own hasher context, so that chunks of different files
+/// can be processed by different threads at the same time.
+/// Data of a single file has to be hashed in order. When a thread receives data of a file that
+/// is not the next range of that file, or data of a file that is currently being hashed by another thread,
+/// the range is stored with a reference to its chunk buffer and picked up by the thread that hashes the
+/// preceding data. Threads never wait on each other.
+///
+/// When multi-buffer hashing is enabled, files that are contained in a single chunk are hashed
+/// together with the other complete files of that chunk, using one multi-buffer lane per file.
+///
+/// Chunks must be published in file order, otherwise ranges that are kept for later could hold on to
+/// all buffers of the chunk reader before the missing data is read.
+class checksum_hasher : public chunk_processor_base
+{
+public:
+    checksum_hasher(file_storage& storage, hash_function f, std::size_t capacity, std::size_t thread_count,
+                    bool enable_multi_buffer_hashing);
+
+    void start() override;
+
+    /// Add the checksum of every finished file to a checkpoint.
+    /// Files that already have a checksum in the checkpoint are not hashed again,
+    /// their checksum is copied to the file entry.
+    /// @remark Not thread-safe, must be set before starting the hasher.
+    void set_checkpoint(std::shared_ptr<hash_checkpoint> checkpoint);
+
+protected:
+    void run(std::stop_token stop_token, int thread_idx) override;
+
+    void drain(std::size_t slot) override;
+
+    /// Split a chunk in ranges of data of a single file. Ranges of padding files are not included.
+    virtual void split_chunk(const data_chunk& chunk, std::vector<file_data_range>& ranges) = 0;
+
+private:
+    /// Maximum number of complete files submitted to a multi-buffer hasher at a time.
+    static constexpr std::size_t multi_buffer_lanes = 16;
+
+    /// Data of a file that is waiting for the preceding data to be hashed.
+    struct pending_range
+    {
+        std::shared_ptr<data_chunk::data_type> buffer;
+        std::span<const std::byte> data;
+    };
+
+    struct file_state
+    {
+        std::mutex mutex {};
+        std::unique_ptr<single_buffer_hasher> hasher {};
+        /// Position in the file of the first byte that was not hashed yet.
+        std::size_t next_offset = 0;
+        /// Set while a thread is hashing data of this file.
+        bool busy = false;
+        std::map<std::size_t, pending_range> pending {};
+    };
+
+    /// Per worker state, reused across executor tasks.
+    struct slot_state
+    {
+        std::vector<file_data_range> ranges {};
+        std::vector<file_data_range> complete_files {};
+        std::unique_ptr<multi_buffer_hasher> mb_hasher {};
+    };
+
+    void hash_chunk(slot_state& state, const data_chunk& chunk);
+
+    /// Hash a range of a file that can span multiple chunks.
+    /// `buffer` is the chunk buffer that holds data and is kept alive when the data cannot be hashed yet.
+    /// The checksum is added to the file entry when the last byte of the file is hashed.
+    void hash_file_data(const file_data_range& range, const std::shared_ptr<data_chunk::data_type>& buffer);
+
+    /// Hash ranges that hold all data of a file with a multi-buffer hasher.
+    void hash_complete_files(multi_buffer_hasher& hasher, std::span<const file_data_range> files);
+
+    slot_state& get_slot_state(std::size_t slot);
+
+    file_state& get_file_state(std::size_t file_index);
+
+    void finalize_file(std::size_t file_index, single_buffer_hasher& hasher);
+
+    bool enable_multi_buffer_hashing_;
+    std::vector<slot_state> slots_ {};
+    std::shared_ptr<hash_checkpoint> checkpoint_ {};
+    /// Files with a checksum restored from the checkpoint.
+    std::vector<bool> restored_files_ {};
+
+    std::mutex states_mutex_ {};
+    /// State of files that are partially hashed. Removed when the checksum of the file is set.
+    std::unordered_map<std::size_t, std::unique_ptr<file_state>> states_ {};
+};
+
+} // namespace dottorrent
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "dottorrent/aligned_allocator.hpp"
+
+namespace dottorrent {
+
+/// Contiguous byte buffer of a data_chunk.
+/// A buffer either owns its memory, aligned for up to 512 bit SIMD instructions,
+/// or is a read-only view of memory owned by another object, eg. a memory mapped file region.
+class chunk_buffer
+{
+public:
+    using value_type = std::byte;
+    using size_type = std::size_t;
+    using pointer = std::byte*;
+    using const_pointer = const std::byte*;
+    using iterator = pointer;
+    using const_iterator = const_pointer;
+
+    /// Alignment of owned memory.
+    static constexpr size_type default_alignment = 64;
+
+    chunk_buffer() = default;
+
+    /// Create a view of `data`.
+    /// @param owner: keeps the memory of `data` alive for the lifetime of the buffer.
+    chunk_buffer(std::span<const std::byte> data, std::shared_ptr<const void> owner) noexcept
+            : owner_(std::move(owner))
+            , data_(const_cast<std::byte*>(data.data()))
+            , size_(data.size())
+    {}
+
+    chunk_buffer(const chunk_buffer&) = delete;
+    chunk_buffer& operator=(const chunk_buffer&) = delete;
+
+    /// Resize the owned memory to `n` bytes.
+    /// A view is released and replaced by owned memory.
+    void resize(size_type n)
+    {
+        owner_.reset();
+        storage_.resize(n);
+        data_ = storage_.data();
+        size_ = n;
+    }
+
+    /// Resize the owned memory to `n` bytes with data() aligned to `alignment` bytes.
+    /// The memory after the last byte is padded up to a multiple of `alignment` bytes,
+    /// which allows block-based I/O to write the complete last block.
+    /// A view is released and replaced by owned memory.
+    void resize(size_type n, size_type alignment)
+    {
+        Expects(std::has_single_bit(alignment));
+        Expects(alignment >= default_alignment);
+        owner_.reset();
+
+        const auto padded_size = (n + alignment - 1) & ~(alignment - 1);
+        storage_.resize(padded_size + alignment - default_alignment);
+
+        auto address = reinterpret_cast<std::uintptr_t>(storage_.data());
+        auto aligned_address = (address + alignment - 1) & ~(alignment - 1);
+        data_ = storage_.data() + (aligned_address - address);
+        size_ = n;
+    }
+
+    /// @note Writing to the data of a view is undefined behavior.
+    pointer data() noexcept
+    { return data_; }
+
+    const_pointer data() const noexcept
+    { return data_; }
+
+    size_type size() const noexcept
+    { return size_; }
+
+    bool empty() const noexcept
+    { return size_ == 0; }
+
+    /// Return true if the buffer does not own its memory.
+    bool is_view() const noexcept
+    { return owner_ != nullptr; }
+
+    iterator begin() noexcept
+    { return data_; }
+
+    iterator end() noexcept
+    { return data_ + size_; }
+
+    const_iterator begin() const noexcept
+    { return data_; }
+
+    const_iterator end() const noexcept
+    { return data_ + size_; }
+
+private:
+    std::vector<std::byte, aligned_allocator<std::byte, default_alignment>> storage_ {};
+    std::shared_ptr<const void> owner_ {};
+    std::byte* data_ = nullptr;
+    size_type size_ = 0;
+};
+
+} // namespace dottorrent
@@ -9,10 +9,21 @@ class chunk_hasher_single_buffer : public chunk_processor_base
 public:
     using chunk_processor_base::chunk_processor_base;
 
+    void start() override;
+
 protected:
     void run(std::stop_token stop_token, int thread_idx) override;
 
+    void drain(std::size_t slot) override;
+
+    /// Return the hashers of a worker thread or executor slot.
+    std::vector<std::unique_ptr<single_buffer_hasher>>& slot_hashers(std::size_t slot);
+
     virtual void hash_chunk(std::vector<std::unique_ptr<single_buffer_hasher>>& hashers, const data_chunk& chunk) = 0;
+
+private:
+    // per worker hashers, reused across executor tasks
+    std::vector<std::vector<std::unique_ptr<single_buffer_hasher>>> slot_hashers_ {};
 };
 
 } // namespace dottorrent
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "dottorrent/file_storage.hpp"
+#include "dottorrent/general.hpp"
+
+namespace dottorrent {
+
+/// Part of a chunk that is backed by a single file.
+struct chunk_segment
+{
+    /// Index of the file in the file_storage object.
+    std::uint32_t file_index;
+    /// Position of the first byte of the segment in the file.
+    std::size_t file_offset;
+    /// Position of the first byte of the segment in the chunk.
+    std::size_t chunk_offset;
+    /// Number of bytes in the segment.
+    std::size_t size;
+    /// The segment is not backed by file data and must be filled with zero bytes.
+    bool zero_fill = false;
+};
+
+/// Description of a data_chunk as it is published by a chunk_reader.
+struct chunk_descriptor
+{
+    /// Index of the first piece in the chunk [v1] or in the file [v2].
+    std::uint32_t piece_index;
+    /// Index of the file in the file_storage object.
+    std::uint32_t file_index;
+    /// Total number of bytes in the chunk.
+    std::size_t size;
+    /// When false the chunk is published without data to mark pieces of a missing file.
+    bool has_data = true;
+    /// Byte ranges the chunk is composed of, in chunk order.
+    std::vector<chunk_segment> segments {};
+};
+
+/// Splits the files of a storage in the chunks a reader has to publish.
+/// The produced layout is identical to that of v1_chunk_reader and v2_chunk_reader,
+/// which allows readers with a different I/O strategy to share it.
+///
+/// The planner checks if files exist and sets the last modified time of existing files
+/// when it first visits them.
+class chunk_planner
+{
+public:
+    chunk_planner(file_storage& storage, protocol protocol_version, std::size_t chunk_size);
+
+    /// Return the next chunk or std::nullopt when all chunks have been planned.
+    std::optional<chunk_descriptor> next();
+
+    /// Return the number of bytes of padding and missing files skipped since the last call.
+    /// These bytes are never read from disk but do count towards bytes read for v2 torrents.
+    std::size_t take_skipped_bytes() noexcept;
+
+    /// Return true if the file at `file_index` was found on disk.
+    /// Only valid after the planner has visited the file.
+    bool file_exists(std::size_t file_index) const noexcept;
+
+private:
+    void plan_next_file_v1();
+
+    void plan_missing_file_v1(std::size_t file_size);
+
+    void plan_next_file_v2();
+
+    void add_segment(const chunk_segment& segment);
+
+    void emit_current(std::size_t size);
+
+    bool check_file(std::size_t file_index);
+
+    std::reference_wrapper<file_storage> storage_;
+    std::vector<fs::path> file_paths_;
+    std::vector<bool> file_exists_;
+    bool v1_layout_;
+    std::size_t chunk_size_;
+    std::size_t piece_size_;
+
+    // index of the next file to plan
+    std::size_t file_index_ = 0;
+    // index of the first piece of the chunk being planned
+    std::size_t piece_index_ = 0;
+    // position of the first free byte in the chunk being planned
+    std::size_t chunk_offset_ = 0;
+    std::size_t skipped_bytes_ = 0;
+    chunk_descriptor current_ {};
+    std::deque<chunk_descriptor> ready_ {};
+};
+
+} // namespace dottorrent
@@ -7,6 +7,7 @@
 
 #include <gsl-lite/gsl-lite.hpp>
 #include "dottorrent/concurrent_queue.hpp"
+#include "dottorrent/executor.hpp"
 #include "dottorrent/hash.hpp"
 #include "dottorrent/file_storage.hpp"
 #include "dottorrent/data_chunk.hpp"
@@ -21,9 +22,9 @@ class chunk_processor
 {
 public:
     using chunk_type = data_chunk;
-    using queue_type = concurrent_queue<chunk_type>;
-    using v1_hashed_piece_queue = concurrent_queue<std::optional<v1_hashed_piece>>;
-    using v2_hashed_piece_queue = concurrent_queue<std::optional<v2_hashed_piece>>;
+    using queue_type = data_chunk_queue;
+    using v1_hashed_piece_queue = concurrent_queue<std::optional<v1_hashed_piece_batch>>;
+    using v2_hashed_piece_queue = concurrent_queue<std::optional<v2_hashed_piece_batch>>;
 
     /// Start the worker threads
     virtual void start() = 0;
@@ -63,6 +64,17 @@ public:
 
     virtual void register_v2_hashed_piece_queue(const std::shared_ptr<v2_hashed_piece_queue>& queue) {};
 
+    /// Register a function that is called after hashed pieces are pushed to the hashed piece queues.
+    virtual void register_publish_callback(std::function<void()> callback) {};
+
+    /// Run the workers as tasks on `executor` instead of on dedicated threads.
+    /// Must be called before start().
+    virtual void set_executor(std::shared_ptr<executor> executor) = 0;
+
+    /// Signal that items were added to the work queue.
+    /// Required after each push when running on an executor.
+    virtual void notify() = 0;
+
     virtual ~chunk_processor() = default;
 };
 
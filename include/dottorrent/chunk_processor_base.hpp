@@ -56,6 +56,12 @@ public:
 
     void register_v2_hashed_piece_queue(const std::shared_ptr<v2_hashed_piece_queue>& queue) override;
 
+    void register_publish_callback(std::function<void()> callback) override;
+
+    void set_executor(std::shared_ptr<executor> executor) override;
+
+    void notify() override;
+
     /// Number of total bytes hashes.
     auto bytes_hashed() const noexcept -> std::size_t;
 
@@ -67,11 +73,31 @@ public:
 protected:
     virtual void run(std::stop_token stop_token, int thread_idx) = 0;
 
+    /// Process items from the work queue on an executor using the worker state of `slot`.
+    /// Returns when the queue is empty or after max_items_per_task items.
+    virtual void drain(std::size_t slot) = 0;
+
+    /// Maximum number of items processed by a single executor task,
+    /// so other stages sharing the executor are not starved.
+    /// Each item is a data chunk, which takes far longer to process than the piece hash batches
+    /// of concurrent_queue_processor.
+    static constexpr std::size_t max_items_per_task = 4;
+
+    /// Push the piece hashes of a chunk to the registered v1 hashed piece queue as a single item.
+    void publish(v1_hashed_piece_batch&& batch);
+
+    /// Push the leaf hashes of a chunk to the registered v2 hashed piece queue as a single item.
+    void publish(v2_hashed_piece_batch&& batch);
+
     std::reference_wrapper<file_storage> storage_;
     std::vector<std::jthread> threads_;
     std::shared_ptr<work_queue_type> queue_;
     std::shared_ptr<v1_hashed_piece_queue> v1_hashed_piece_queue_;
     std::shared_ptr<v2_hashed_piece_queue> v2_hashed_piece_queue_;
+    std::function<void()> publish_callback_ {};
+
+    std::shared_ptr<executor> executor_ {};
+    std::unique_ptr<bounded_task_runner> runner_ {};
 
     std::vector<hash_function> hash_functions_;
 
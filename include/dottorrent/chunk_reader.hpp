@@ -1,6 +1,7 @@
 #pragma once
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -16,13 +17,30 @@
 
 namespace dottorrent {
 
+/// Strategy used by a chunk_reader to read file data from disk.
+enum class reader_type
+{
+    /// Read files one after another with a single blocking read per chunk.
+    sequential,
+    /// Keep multiple reads in flight using io_uring. Only available on Linux.
+    io_uring,
+    /// Read multiple files, or ranges of large files, concurrently on multiple threads.
+    /// Chunks are not published in order so per-file checksums are not supported.
+    parallel,
+    /// Publish chunks that view memory mapped files instead of copying the data.
+    /// Only available when the platform supports mmap.
+    mmap,
+    /// Read with O_DIRECT to bypass the page cache. Only available when the platform supports O_DIRECT.
+    direct,
+};
+
 class chunk_reader
 {
 public:
     using chunk_type = data_chunk;
     using data_type = typename data_chunk::data_type ;
-    using hash_queue = concurrent_queue<chunk_type>;
-    using checksum_queue = concurrent_queue<chunk_type>;
+    using hash_queue = data_chunk_queue;
+    using checksum_queue = data_chunk_queue;
 
     using hash_queue_vector = std::vector<std::shared_ptr<hash_queue>>;
     using checksum_queue_vector = std::vector<std::shared_ptr<checksum_queue>>;
@@ -33,6 +51,9 @@ public:
 
     void register_checksum_queue(std::shared_ptr<checksum_queue> q);
 
+    /// Register a function that is called after each chunk is pushed to the registered queues.
+    void register_push_callback(std::function<void()> callback);
+
     /// Start the worker threads
     void start();
 
@@ -56,11 +77,20 @@ public:
 protected:
     virtual void run() = 0;
 
+    /// Push a chunk to all registered queues.
+    void push(const data_chunk& chunk);
+
+    /// Return the path of the first file after `file_index` that is not a padding file,
+    /// or nullptr if there is no such file.
+    const fs::path* next_file_path(const std::vector<fs::path>& file_paths, std::size_t file_index) const;
+
     std::reference_wrapper<file_storage> storage_;
     std::size_t chunk_size_;
+    std::size_t capacity_;
     pool::object_pool<data_type> pool_;
     hash_queue_vector hash_queues_ {};
     checksum_queue_vector checksum_queues_ {};
+    std::vector<std::function<void()>> push_callbacks_ {};
     std::jthread thread_;
     std::atomic<std::size_t> bytes_read_ = 0;
     std::atomic<bool> started_ = false;
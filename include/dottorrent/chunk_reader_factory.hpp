@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory>
+
+#include "dottorrent/chunk_reader.hpp"
+#include "dottorrent/general.hpp"
+
+namespace dottorrent {
+
+/// Options to select and configure the chunk_reader of a storage_hasher or storage_verifier.
+struct chunk_reader_options
+{
+    /// The strategy used to read data from disk.
+    reader_type type = reader_type::sequential;
+    /// Maximum number of read requests in flight for the io_uring reader.
+    std::size_t queue_depth = 32;
+    /// Number of reader threads for the parallel reader.
+    std::size_t threads = 4;
+};
+
+/// Create a chunk reader for given protocol.
+/// @throws std::invalid_argument if the reader type is not supported on this platform.
+std::unique_ptr<chunk_reader> make_chunk_reader(
+        file_storage& storage,
+        protocol protocol_version,
+        std::size_t block_size,
+        std::size_t capacity,
+        const chunk_reader_options& options = {});
+
+} // namespace dottorrent
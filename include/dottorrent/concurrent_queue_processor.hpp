@@ -5,6 +5,7 @@
 #include <ranges>
 
 #include "concurrent_queue.hpp"
+#include "executor.hpp"
 
 namespace dottorrent {
 
@@ -39,6 +40,20 @@ public:
         done_ = std::vector<std::atomic<bool>>(max_concurrency);
     }
 
+    /// Run the work function as tasks on `executor` instead of on dedicated threads,
+    /// with at most max_concurrency tasks active at a time.
+    void set_executor(std::shared_ptr<executor> executor)
+    {
+        Expects(!started());
+        executor_ = std::move(executor);
+    }
+
+    /// Signal that items were added to the queue. Required after each push when running on an executor.
+    void notify()
+    {
+        if (runner_) runner_->schedule();
+    }
+
 
     /// Start the worker threads
     void start()
@@ -46,6 +61,17 @@ public:
         Ensures(!started());
         Ensures(!cancelled());
 
+        if (executor_) {
+            for (auto& d : done_) { d = false; }
+            runner_ = std::make_unique<bounded_task_runner>(
+                    executor_, threads_.size(),
+                    [this]() { return queue_->size() != 0; },
+                    [this](std::size_t) { drain(); });
+            started_.store(true, std::memory_order_release);
+            runner_->schedule();
+            return;
+        }
+
         for (std::size_t i = 0; i < threads_.size(); ++i) {
             done_[i] = false;
             threads_[i] = std::jthread([=, this](std::stop_token st) { run(std::move(st), i); });
@@ -74,6 +100,13 @@ public:
     {
         if (!started()) return;
 
+        // producers are finished, complete the remaining work
+        if (runner_) {
+            runner_->wait_idle();
+            for (auto& d : done_) { d = true; }
+            return;
+        }
+
         // Wake threads that remain blocked on pop calls.
         for  (auto i = 0; i < threads_.size(); ++i) {
             queue_->push(std::nullopt);
@@ -156,14 +189,32 @@ private:
         }
         done_[thread_idx] = true;
 
-        // Remaining pieces should all be empty
+        // Remaining pieces should all be empty, unless the remaining work of a cancelled processor is discarded
         if (queue_->size() != 0) {
             while (queue_->try_pop(item)) {
-                Ensures(!item.has_value());
+                Ensures(!item.has_value() || cancelled_.load(std::memory_order_relaxed));
             }
         }
     }
 
+    /// Process items from the queue on the executor.
+    void drain()
+    {
+        std::optional<parameter_type> item {};
+
+        for (std::size_t i = 0; i < max_items_per_task && queue_->try_pop(item); ++i) {
+            if (item.has_value() && !cancelled_.load(std::memory_order_relaxed)) {
+                std::invoke(work_function_, std::move(*item));
+            }
+        }
+    }
+
+    /// Maximum number of items processed by a single executor task,
+    /// so other stages sharing the executor are not starved.
+    /// Larger than chunk_processor_base::max_items_per_task: an item is a batch of piece hashes,
+    /// which takes far less time to process than hashing a data chunk.
+    static constexpr std::size_t max_items_per_task = 16;
+
     std::vector<std::jthread> threads_;
     std::function<void(parameter_type&&)> work_function_;
     std::shared_ptr<queue_type> queue_;
@@ -171,6 +222,8 @@ private:
     std::atomic<bool> cancelled_ = false;
     std::atomic<bool> stopped_ = false;
     std::vector<std::atomic<bool>> done_;
+    std::shared_ptr<executor> executor_ {};
+    std::unique_ptr<bounded_task_runner> runner_ {};
 };
 
 } // namespace dottorrent
\ No newline at end of file
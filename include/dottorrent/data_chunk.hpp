@@ -5,15 +5,28 @@
 #include <memory>
 #include <cstddef>
 
-#include "dottorrent/aligned_allocator.hpp"
+#include "dottorrent/chunk_buffer.hpp"
+#include "dottorrent/concurrent_queue.hpp"
+#include "dottorrent/ring_queue.hpp"
 
 namespace dottorrent {
 
+/// Range of the data of a packed chunk that holds the complete content of a single file. [v2]
+struct data_chunk_part
+{
+    /// Index of the file in the file_storage object.
+    std::uint32_t file_index{};
+    /// Position of the first byte of the file in data.
+    std::size_t offset{};
+    /// Number of bytes in the file.
+    std::size_t size{};
+};
+
 /// Chunk of file data.
 struct data_chunk
 {
-    /// A vector with bytes of data. Aligned for up to 512 bit SIMD instructions.
-    using data_type = std::vector<std::byte, aligned_allocator<std::byte, 64>>;
+    /// A buffer with bytes of data. Owned buffers are aligned for up to 512 bit SIMD instructions.
+    using data_type = chunk_buffer;
     /// Index of the first `piece size` bytes in data. [v1]
     /// The position in the file of the first byte in `data` divided by the piece_size. [v2]
     std::uint32_t piece_index{};
@@ -21,6 +34,16 @@ struct data_chunk
     std::uint32_t file_index{};
     /// Variable length vector of bytes.
     std::shared_ptr<data_type> data{};
+    /// Files packed in data when a chunk holds multiple small files, nullptr otherwise. [v2]
+    /// piece_index and file_index then refer to the first part.
+    std::shared_ptr<const std::vector<data_chunk_part>> parts{};
 };
 
-}
\ No newline at end of file
+/// Queue between a chunk reader and the chunk processors.
+#ifdef DOTTORRENT_USE_LOCKFREE_QUEUE
+using data_chunk_queue = ring_queue<data_chunk>;
+#else
+using data_chunk_queue = concurrent_queue<data_chunk>;
+#endif
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "dottorrent/chunk_reader.hpp"
+#include "dottorrent/chunk_planner.hpp"
+
+namespace dottorrent {
+
+/// Chunk reader for v1, v2 and hybrid torrents that bypasses the page cache using O_DIRECT.
+/// Data is read in blocks of `alignment` bytes into pool buffers aligned to `alignment` bytes.
+/// File data that is not aligned in the chunk, eg. files starting halfway a v1 chunk,
+/// and file tails that are not a multiple of the alignment are read through a bounce buffer.
+/// When a file system does not support O_DIRECT the file is read buffered and the kernel is advised
+/// to drop the data from the page cache after reading.
+///
+/// This reader is intended for background verification of large data sets
+/// where polluting the page cache would evict the working set of other processes.
+/// @note Only available when build with DOTTORRENT_USE_DIRECT_IO.
+class direct_chunk_reader : public chunk_reader
+{
+public:
+    /// Alignment of file offsets, buffer addresses and transfer sizes.
+    static constexpr std::size_t alignment = 4_KiB;
+
+    direct_chunk_reader(file_storage& storage,
+                        protocol protocol_version,
+                        std::size_t block_size,
+                        std::size_t capacity);
+
+    void run() final;
+
+private:
+
+    protocol protocol_;
+};
+
+} // namespace dottorrent
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dottorrent {
+
+/// Work-stealing thread pool shared by the stages of one or more storage_hasher objects.
+///
+/// Every worker thread has its own task queue. Tasks submitted from a worker are pushed to the queue
+/// of that worker, tasks submitted from other threads to a shared injection queue.
+/// Idle workers take tasks from their own queue first, then from the injection queue
+/// and finally steal from the queues of other workers. Workers without work park until a task is submitted.
+///
+/// Tasks must not block on other tasks of the same executor.
+class executor
+{
+public:
+    using task_type = std::function<void()>;
+
+    /// Create an executor with `thread_count` workers.
+    /// When `thread_count` is 0 the number of hardware threads is used.
+    explicit executor(std::size_t thread_count = 0);
+
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+
+    /// Stop all workers. Tasks that did not start yet are discarded.
+    ~executor();
+
+    void submit(task_type task);
+
+    std::size_t thread_count() const noexcept
+    { return workers_.size(); }
+
+private:
+    struct task_queue
+    {
+        std::mutex mutex {};
+        std::deque<task_type> tasks {};
+    };
+
+    void run(std::stop_token stop_token, std::size_t index);
+
+    bool try_take(std::size_t index, std::size_t tick, task_type& task);
+
+    static bool try_pop_front(task_queue& queue, task_type& task);
+
+    static bool try_pop_back(task_queue& queue, task_type& task);
+
+    std::vector<std::unique_ptr<task_queue>> queues_ {};
+    task_queue injection_queue_ {};
+
+    // number of tasks in all queues
+    std::atomic<std::size_t> pending_ = 0;
+    std::atomic<std::size_t> parked_ = 0;
+    std::mutex park_mutex_ {};
+    std::condition_variable_any park_cv_ {};
+
+    std::vector<std::jthread> workers_ {};
+};
+
+
+/// Runs the tasks of a single pipeline stage on an executor.
+///
+/// A stage processes items from its own queue. When items are available the runner submits a task
+/// calling the drain function, with at most `concurrency` of these tasks active at a time.
+/// Each active task is assigned a slot index in [0, concurrency), which allows a stage to keep
+/// per slot state, such as hashers, across tasks.
+/// The drain function returns when its queue is empty or after processing a bounded number of items,
+/// so that other stages sharing the executor get their turn.
+class bounded_task_runner
+{
+public:
+    using drain_function = std::function<void(std::size_t slot)>;
+    using has_work_function = std::function<bool()>;
+
+    bounded_task_runner(std::shared_ptr<executor> executor,
+                        std::size_t concurrency,
+                        has_work_function has_work,
+                        drain_function drain);
+
+    bounded_task_runner(const bounded_task_runner&) = delete;
+    bounded_task_runner& operator=(const bounded_task_runner&) = delete;
+
+    /// Submit a task if there is work and a free slot.
+    /// Producers call this after adding items to the queue of the stage.
+    void schedule();
+
+    /// Block until no tasks are active and there is no work left.
+    /// Producers must have called schedule() after their last push.
+    void wait_idle();
+
+    ~bounded_task_runner();
+
+private:
+    void run(std::size_t slot);
+
+    std::shared_ptr<executor> executor_;
+    has_work_function has_work_;
+    drain_function drain_;
+
+    std::mutex mutex_ {};
+    std::condition_variable idle_cv_ {};
+    std::vector<std::size_t> free_slots_ {};
+    std::size_t active_ = 0;
+};
+
+} // namespace dottorrent
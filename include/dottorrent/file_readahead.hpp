@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+#include "dottorrent/file_storage.hpp"
+#include "dottorrent/literals.hpp"
+
+namespace dottorrent {
+
+/// Prefetches file data for readers that read files front to back.
+/// A window of data after the read position of the current file is kept requested
+/// with POSIX_FADV_WILLNEED, and when the current file is within one window of its end the first
+/// window of the next file is requested, so that reading it does not start with a blocking read.
+///
+/// The hints are issued on separate file descriptors and do not depend on how the data is read.
+/// All hints are advisory: errors are ignored and the class does nothing on platforms
+/// without posix_fadvise.
+class file_readahead
+{
+public:
+    static constexpr std::size_t default_window_size = 8_MiB;
+
+    explicit file_readahead(std::size_t window_size = default_window_size);
+
+    file_readahead(const file_readahead&) = delete;
+    file_readahead& operator=(const file_readahead&) = delete;
+
+    ~file_readahead();
+
+    /// Start reading the file at `path`.
+    /// @param next_path: the file that will be read after this one or nullptr if there is none.
+    void open(const fs::path& path, std::size_t file_size, const fs::path* next_path);
+
+    /// Notify that the current file has been read up to `offset`.
+    void advance(std::size_t offset);
+
+    /// Stop reading the current file. A prefetched next file is kept open.
+    void close() noexcept;
+
+private:
+    std::size_t window_size_;
+    int fd_ = -1;
+    std::size_t file_size_ = 0;
+    // first byte of the current file that has not been requested yet
+    std::size_t prefetched_until_ = 0;
+    fs::path next_path_ {};
+    int next_fd_ = -1;
+    bool next_prefetched_ = false;
+};
+
+} // namespace dottorrent
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "dottorrent/checksum.hpp"
+#include "dottorrent/file_storage.hpp"
+#include "dottorrent/general.hpp"
+#include "dottorrent/hash.hpp"
+
+namespace dottorrent {
+
+namespace fs = std::filesystem;
+
+/// Hashes completed by a storage_hasher, to resume hashing after it was interrupted.
+///
+/// Contains the v1 piece hashes [v1, hybrid], the piece-layer hashes of each file [v2, hybrid]
+/// and the per-file checksums that are complete.
+/// A checkpoint is saved to a compact binary file together with the size and last modification time
+/// of each file. When loading a checkpoint, the hashes of files that changed since are discarded.
+///
+/// All member functions are thread-safe.
+class hash_checkpoint
+{
+public:
+    /// Create an empty checkpoint for the files of a storage.
+    /// The last modification time of the files on disk is recorded when the checkpoint is created.
+    hash_checkpoint(const file_storage& storage, protocol protocol_version);
+
+    /// Load the hashes saved in a checkpoint file.
+    /// Hashes of files that changed on disk since the checkpoint was created are discarded.
+    /// @throws std::invalid_argument if the checkpoint was created for a different storage, protocol or piece size.
+    /// @throws std::runtime_error if the file cannot be read or is not a checkpoint file.
+    void load(const fs::path& path);
+
+    /// Write the checkpoint to a file.
+    /// The checkpoint is written to a temporary file that replaces `path`,
+    /// so an interrupted save never leaves a partial checkpoint.
+    /// @throws std::runtime_error if the file cannot be written.
+    void save(const fs::path& path) const;
+
+    /// Add the hashes of the files that did not change since a previous version of the storage was hashed,
+    /// for example the storage of a previously created metafile.
+    ///
+    /// Files are matched by path. A file is unchanged when it has the same size and the last modification
+    /// time recorded in `previous`, or, when `previous` does not record the last modification time,
+    /// when it was not modified after `unchanged_since`.
+    /// The piece layers, pieces roots and checksums of unchanged files are added [v2, hybrid],
+    /// as well as the v1 pieces that only contain data of unchanged files at the same position [v1, hybrid].
+    /// @returns the number of unchanged files.
+    /// @throws std::invalid_argument if `previous` has a different piece size.
+    std::size_t add_unchanged_files(const file_storage& storage,
+                                    const file_storage& previous,
+                                    std::optional<fs::file_time_type> unchanged_since = std::nullopt);
+
+    void add_v1_piece(std::size_t index, const sha1_hash& hash);
+
+    void add_v2_piece(std::size_t file_index, std::size_t piece_index, const sha256_hash& hash);
+
+    void add_checksum(std::size_t file_index, const checksum& value);
+
+    /// Return the hash of v1 piece `index` if it is complete.
+    std::optional<sha1_hash> v1_piece(std::size_t index) const;
+
+    /// Return the hash of piece `piece_index` of file `file_index` if it is complete.
+    std::optional<sha256_hash> v2_piece(std::size_t file_index, std::size_t piece_index) const;
+
+    /// Return a copy of the checksum of file `file_index` if it is complete.
+    std::unique_ptr<checksum> get_checksum(std::size_t file_index, hash_function algorithm) const;
+
+    /// Return the number of pieces of file `file_index`, files smaller than a piece have a single piece.
+    std::size_t v2_piece_count(std::size_t file_index) const noexcept;
+
+private:
+    /// Discard all hashes of file `file_index`.
+    void discard_file(std::size_t file_index);
+
+    protocol protocol_;
+    std::size_t piece_size_;
+    std::vector<std::uint64_t> file_sizes_ {};
+    std::vector<std::int64_t> file_mtimes_ {};
+    // position of the first byte of each file in the v1 piece list
+    std::vector<std::size_t> v1_file_offsets_ {};
+    // first piece of each file in the v2 piece list
+    std::vector<std::size_t> v2_file_offsets_ {};
+
+    mutable std::mutex mutex_ {};
+    std::vector<sha1_hash> v1_pieces_ {};
+    std::vector<bool> v1_done_ {};
+    std::vector<sha256_hash> v2_pieces_ {};
+    std::vector<bool> v2_done_ {};
+    std::vector<std::vector<std::unique_ptr<checksum>>> checksums_ {};
+};
+
+} // namespace dottorrent
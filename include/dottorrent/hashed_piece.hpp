@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "hash.hpp"
 
 namespace dottorrent {
@@ -17,4 +19,11 @@ struct v2_hashed_piece
     std::size_t leaf_index;
 };
 
+/// Hashes of all pieces computed from a single data_chunk.
+/// Chunk hashers publish a batch as a single queue item to reduce the synchronisation per piece.
+using v1_hashed_piece_batch = std::vector<v1_hashed_piece>;
+
+/// Hashes of all 16 KiB blocks computed from a single data_chunk.
+using v2_hashed_piece_batch = std::vector<v2_hashed_piece>;
+
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "dottorrent/concurrent_queue.hpp"
+#include "dottorrent/executor.hpp"
 #include "dottorrent/hashed_piece.hpp"
 
 namespace dottorrent {
@@ -11,8 +12,8 @@ namespace dottorrent {
 class hashed_piece_processor
 {
 public:
-    using v1_piece_queue_type = concurrent_queue<std::optional<v1_hashed_piece>>;
-    using v2_piece_queue_type = concurrent_queue<std::optional<v2_hashed_piece>>;
+    using v1_piece_queue_type = concurrent_queue<std::optional<v1_hashed_piece_batch>>;
+    using v2_piece_queue_type = concurrent_queue<std::optional<v2_hashed_piece_batch>>;
 
     virtual void start() = 0;
 
@@ -32,6 +33,14 @@ public:
     /// Check if the hasher has completed all work or is cancelled.
     virtual bool done() const noexcept = 0;
 
+    /// Run the workers as tasks on `executor` instead of on dedicated threads.
+    /// Must be called before start().
+    virtual void set_executor(std::shared_ptr<executor> executor) = 0;
+
+    /// Signal that items were added to the queues.
+    /// Required after each push when running on an executor.
+    virtual void notify() = 0;
+
     virtual std::shared_ptr<v1_piece_queue_type> get_v1_queue()
     { return nullptr; };
 
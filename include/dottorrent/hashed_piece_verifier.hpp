@@ -1,6 +1,7 @@
 #pragma once
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -9,18 +10,47 @@
 #include <gsl-lite/gsl-lite.hpp>
 
 #include "dottorrent/hashed_piece_processor.hpp"
+#include "dottorrent/piece_state_map.hpp"
 
 namespace dottorrent {
 
 class hashed_piece_verifier : public hashed_piece_processor
 {
 public:
+    /// Called with the index in result() of a piece and whether it matches its hash.
+    using piece_callback = std::function<void(std::size_t piece_index, bool verified)>;
+
     // Return for each block wether it is valid or not.
     // For v1 torrents each block is equal to the piece size.
     // For v2 torrents each block is equal to 16 KiB.
     virtual const std::vector<std::uint8_t>& result() const noexcept = 0;
 
     virtual double percentage(std::size_t file_index) const noexcept = 0;
+
+    /// Return the state of the pieces in result(), published as soon as each piece is checked.
+    /// Safe to read while the verifier is running and after it was cancelled.
+    const piece_state_map& piece_states() const noexcept
+    { return piece_states_; }
+
+    /// Set a function called for every checked piece, on the thread that checked the piece.
+    /// @remark Not thread-safe, must be set before starting the verifier.
+    void set_piece_callback(piece_callback callback)
+    { piece_callback_ = std::move(callback); }
+
+protected:
+    /// Publish the result of checking a piece to piece_states() and the piece callback.
+    void publish_piece(std::size_t piece_index, bool verified)
+    {
+        piece_states_.publish(piece_index, verified);
+        if (piece_callback_) {
+            piece_callback_(piece_index, verified);
+        }
+    }
+
+    piece_state_map piece_states_ {};
+
+private:
+    piece_callback piece_callback_ {};
 };
 
 }
\ No newline at end of file
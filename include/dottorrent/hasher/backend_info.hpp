@@ -22,6 +22,10 @@
 #include <wolfssl/version.h>
 #endif
 
+#if defined(DOTTORRENT_USE_NATIVE)
+#include "dottorrent/hasher/backends/native.hpp"
+#endif
+
 #if defined(DOTTORRENT_USE_WINCNG)
 #include <windows.h>
 #include <ntstatus.h>
@@ -52,6 +56,9 @@ cryptographic_backends()
 #if defined(DOTTORRENT_USE_WINCNG)
     versions["wincng"] = BCRYPT_HASH_INTERFACE_VERSION_1;
 #endif
+#if defined(DOTTORRENT_USE_NATIVE)
+    versions["native"] = native::selected_kernels();
+#endif
 
     return versions;
 }
@@ -3,6 +3,7 @@
 #include <span>
 #include <string_view>
 #include <cstring>
+#include <type_traits>
 #include <unordered_set>
 
 #include "dottorrent/hasher/multi_buffer_hasher.hpp"
@@ -109,11 +110,23 @@ public:
         while (!hash_ctx_complete(context_pool_[job_id])) {
             Flush(context_manager_);
         }
-        // Intel ISA-L stores the hash as 32 bit words so we need to byteswap and copy per word
+        // Intel ISA-L stores the hash as native words so we need to byteswap and copy per word.
+        // SHA-512 uses 64 bit words, MD5 is defined on little endian words.
+        const auto* digest = hash_ctx_digest(context_pool_[job_id]);
+        using word_type = std::remove_cvref_t<decltype(digest[0])>;
+
         for (std::size_t i = 0; i < N_WORDS; ++i) {
-            auto big_endian_word = to_be32(hash_ctx_digest(context_pool_[job_id])[i]);
-            std::memcpy(buffer.data()+ i * sizeof(big_endian_word),
-                        &big_endian_word, sizeof(big_endian_word));
+            word_type word;
+            if constexpr (std::is_same_v<CTX, MD5_HASH_CTX>) {
+                word = to_le32(digest[i]);
+            }
+            else if constexpr (sizeof(word_type) == 8) {
+                word = to_be64(digest[i]);
+            }
+            else {
+                word = to_be32(digest[i]);
+            }
+            std::memcpy(buffer.data() + i * sizeof(word), &word, sizeof(word));
         }
     }
 
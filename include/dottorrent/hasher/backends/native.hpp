@@ -0,0 +1,527 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "dottorrent/hash.hpp"
+#include "dottorrent/hash_function.hpp"
+#include "dottorrent/hasher/single_buffer_hasher.hpp"
+#include "dottorrent/hasher/multi_buffer_hasher.hpp"
+
+namespace dottorrent {
+
+/// Built-in hash functions that do not depend on a cryptographic library.
+///
+/// SHA-1 and SHA-256 select the compression function at runtime for the instruction set extensions
+/// of the CPU: SHA-NI when available, otherwise a portable implementation.
+/// Their multi-buffer hashers interleave up to `lane_count` messages in AVX2 registers on CPUs
+/// with AVX2 but without SHA-NI, SHA-NI hashes a single message faster than the multi-lane kernels.
+/// MD5 and SHA-512, used for checksums and cross-seed hashes, only have a portable implementation.
+///
+/// `sha256_leaf_blocks` and `sha256_inner_nodes` hash batches of v2 leaf blocks and merkle tree nodes,
+/// independent of the configured backend.
+namespace native {
+
+/// Instruction set extensions used by the native hashers.
+struct cpu_features
+{
+    bool sha_ni = false;
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+/// Return the instruction set extensions supported by the CPU and the operating system.
+const cpu_features& detected_cpu_features() noexcept;
+
+/// Return a description of the compression functions selected for this CPU.
+std::string selected_kernels();
+
+/// Number of messages hashed at once by the multi-lane compression functions.
+constexpr std::size_t lane_count = 8;
+
+/// Compression function for `block_count` blocks of `lane_count` independent messages.
+using lanes_compress_function = void(*)(std::uint32_t* const* states, const std::byte* const* data,
+                                        std::size_t block_count) noexcept;
+
+void md5_compress(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+void sha1_compress(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+void sha256_compress(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+void sha512_compress(std::uint64_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+/// Return the multi-lane SHA-1 compression function, or nullptr when it is not faster than `sha1_compress`.
+lanes_compress_function sha1_lanes_compress() noexcept;
+
+/// Return the multi-lane SHA-256 compression function, or nullptr when it is not faster than `sha256_compress`.
+lanes_compress_function sha256_lanes_compress() noexcept;
+
+/// Size of the blocks hashed by `sha256_leaf_blocks`, the leaf size of v2 merkle trees.
+constexpr std::size_t leaf_block_size = 16 * 1024;
+
+/// Write the SHA-256 digest of block i of `data` to out[i], for `out.size()` consecutive blocks
+/// of `leaf_block_size` bytes.
+/// All messages have the same length, so every block is finished with the same precomputed padding block
+/// and no hasher state is set up per block. The blocks are interleaved in AVX-512 lanes when available,
+/// otherwise hashed with SHA-NI or interleaved in AVX2 lanes.
+void sha256_leaf_blocks(std::span<const std::byte> data, std::span<sha256_hash> out);
+
+/// Write the SHA-256 digest of the pair of child nodes `children[2*i]` and `children[2*i+1]` to out[i],
+/// the parent layer of a merkle tree layer.
+/// Every 64 byte message is finished with the same precomputed padding block, like `sha256_leaf_blocks`.
+void sha256_inner_nodes(std::span<const sha256_hash> children, std::span<sha256_hash> out);
+
+/// Return true when `sha256_leaf_blocks` and `sha256_inner_nodes` use instruction set extensions of the CPU.
+/// Otherwise the hasher of the configured cryptographic library is expected to be faster.
+bool sha256_batches_accelerated() noexcept;
+
+
+struct md5_traits
+{
+    using word_type = std::uint32_t;
+    static constexpr std::size_t block_size = 64;
+    static constexpr std::size_t digest_size = 16;
+    static constexpr bool big_endian = false;
+    static constexpr std::array<word_type, 4> initial_state {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476
+    };
+
+    static void compress(word_type* state, const std::byte* blocks, std::size_t block_count) noexcept
+    { md5_compress(state, blocks, block_count); }
+};
+
+struct sha1_traits
+{
+    using word_type = std::uint32_t;
+    static constexpr std::size_t block_size = 64;
+    static constexpr std::size_t digest_size = 20;
+    static constexpr bool big_endian = true;
+    static constexpr std::array<word_type, 5> initial_state {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+
+    static void compress(word_type* state, const std::byte* blocks, std::size_t block_count) noexcept
+    { sha1_compress(state, blocks, block_count); }
+
+    static lanes_compress_function lanes_compress() noexcept
+    { return sha1_lanes_compress(); }
+};
+
+struct sha256_traits
+{
+    using word_type = std::uint32_t;
+    static constexpr std::size_t block_size = 64;
+    static constexpr std::size_t digest_size = 32;
+    static constexpr bool big_endian = true;
+    static constexpr std::array<word_type, 8> initial_state {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+
+    static void compress(word_type* state, const std::byte* blocks, std::size_t block_count) noexcept
+    { sha256_compress(state, blocks, block_count); }
+
+    static lanes_compress_function lanes_compress() noexcept
+    { return sha256_lanes_compress(); }
+};
+
+struct sha512_traits
+{
+    using word_type = std::uint64_t;
+    static constexpr std::size_t block_size = 128;
+    static constexpr std::size_t digest_size = 64;
+    static constexpr bool big_endian = true;
+    static constexpr std::array<word_type, 8> initial_state {
+        0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+        0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179
+    };
+
+    static void compress(word_type* state, const std::byte* blocks, std::size_t block_count) noexcept
+    { sha512_compress(state, blocks, block_count); }
+};
+
+
+namespace detail {
+
+/// Streaming state of a single message.
+template <typename Traits>
+struct message_state
+{
+    using word_type = typename Traits::word_type;
+    using state_type = std::remove_const_t<decltype(Traits::initial_state)>;
+    static constexpr std::size_t block_size = Traits::block_size;
+
+    state_type state = Traits::initial_state;
+    std::array<std::byte, block_size> buffer {};
+    std::size_t buffered = 0;
+    std::uint64_t length = 0;
+
+    void reset() noexcept
+    {
+        state = Traits::initial_state;
+        buffered = 0;
+        length = 0;
+    }
+
+    /// Add data to a partially filled block.
+    /// Return the data that remains when the block is complete and compressed.
+    std::span<const std::byte> fill_buffer(std::span<const std::byte> data) noexcept
+    {
+        if (buffered == 0 || data.empty()) return data;
+
+        auto n = std::min(block_size - buffered, data.size());
+        std::memcpy(buffer.data() + buffered, data.data(), n);
+        buffered += n;
+
+        if (buffered == block_size) {
+            Traits::compress(state.data(), buffer.data(), 1);
+            buffered = 0;
+        }
+        return data.subspan(n);
+    }
+
+    /// Store the last partial block of data, `data` must be smaller than a block.
+    void store_tail(std::span<const std::byte> data) noexcept
+    {
+        if (data.empty()) return;
+        std::memcpy(buffer.data() + buffered, data.data(), data.size());
+        buffered += data.size();
+    }
+
+    void finalize_to(std::span<std::byte> out) noexcept
+    {
+        Expects(out.size() >= Traits::digest_size);
+
+        // the message length is stored in the last 8 bytes of the block for MD5, SHA-1 and SHA-256,
+        // and in the last 16 bytes for SHA-512
+        constexpr std::size_t length_size = 2 * sizeof(word_type);
+        const std::uint64_t bit_length = length * 8;
+        buffer[buffered++] = std::byte{0x80};
+
+        if (buffered > block_size - length_size) {
+            std::memset(buffer.data() + buffered, 0, block_size - buffered);
+            Traits::compress(state.data(), buffer.data(), 1);
+            buffered = 0;
+        }
+        std::memset(buffer.data() + buffered, 0, block_size - 8 - buffered);
+        for (std::size_t i = 0; i < 8; ++i) {
+            const auto position = Traits::big_endian ? block_size - 1 - i : block_size - 8 + i;
+            buffer[position] = static_cast<std::byte>(bit_length >> (8 * i));
+        }
+        Traits::compress(state.data(), buffer.data(), 1);
+
+        constexpr std::size_t word_size = sizeof(word_type);
+        for (std::size_t i = 0; i < Traits::digest_size; ++i) {
+            const auto shift = Traits::big_endian ? 8 * (word_size - 1 - i % word_size) : 8 * (i % word_size);
+            out[i] = static_cast<std::byte>(state[i / word_size] >> shift);
+        }
+    }
+};
+
+} // namespace detail
+
+
+template <typename Traits>
+class hasher_impl : public single_buffer_hasher
+{
+public:
+    hasher_impl() = default;
+
+    void update(std::span<const std::byte> data) override
+    {
+        message_.length += data.size();
+        data = message_.fill_buffer(data);
+
+        if (auto n = data.size() / Traits::block_size; n != 0) {
+            Traits::compress(message_.state.data(), data.data(), n);
+            data = data.subspan(n * Traits::block_size);
+        }
+        message_.store_tail(data);
+    }
+
+    void finalize_to(std::span<std::byte> out) override
+    {
+        message_.finalize_to(out);
+        reset();
+    }
+
+    void reset()
+    {
+        message_.reset();
+    }
+
+private:
+    detail::message_state<Traits> message_ {};
+};
+
+
+/// Multi-buffer hasher that compresses the whole blocks of all submitted jobs together.
+/// Only for hash functions with a multi-lane compression function.
+///
+/// Like the ISA-L multi-buffer hashers, submitted data is not copied and
+/// must remain valid until the digest of the job is retrieved with finalize_to,
+/// or until new data is submitted for the same job.
+template <typename Traits>
+class multi_buffer_hasher_impl : public multi_buffer_hasher
+{
+public:
+    multi_buffer_hasher_impl()
+        : multi_buffer_hasher_impl(Traits::lanes_compress())
+    {}
+
+    /// Construct with the given multi-lane compression function instead of the one selected for the CPU.
+    /// When `lanes_compress` is nullptr the jobs are compressed one by one.
+    explicit multi_buffer_hasher_impl(lanes_compress_function lanes_compress)
+        : lanes_compress_(lanes_compress)
+    {}
+
+    std::size_t submit(std::span<const std::byte> data) override
+    {
+        auto job_id = allocate_job();
+        enqueue(job_id, data, true, true);
+        return job_id;
+    }
+
+    void submit(std::size_t job_id, std::span<const std::byte> data) override
+    {
+        enqueue(job_id, data, true, true);
+    }
+
+    void submit_first(std::size_t job_id, std::span<const std::byte> data) override
+    {
+        enqueue(job_id, data, true, false);
+    }
+
+    std::size_t submit_first(std::span<const std::byte> data) override
+    {
+        auto job_id = allocate_job();
+        enqueue(job_id, data, true, false);
+        return job_id;
+    }
+
+    void submit_update(std::size_t job_id, std::span<const std::byte> data) override
+    {
+        enqueue(job_id, data, false, false);
+    }
+
+    void submit_last(std::size_t job_id, std::span<const std::byte> data) override
+    {
+        enqueue(job_id, data, false, true);
+    }
+
+    std::size_t job_count() override
+    {
+        return jobs_.size();
+    }
+
+    void finalize_to(std::size_t job_id, std::span<std::byte> buffer) override
+    {
+        Expects(job_id < jobs_.size());
+        if (jobs_[job_id].queued) {
+            flush();
+        }
+        Expects(jobs_[job_id].complete);
+        // finalize a copy, the digest of a job can be retrieved more than once
+        auto message = jobs_[job_id].message;
+        message.finalize_to(buffer);
+    }
+
+    void reset() override
+    {
+        jobs_.clear();
+    }
+
+    void resize(std::size_t len) override
+    {
+        jobs_.resize(len);
+    }
+
+private:
+    struct job
+    {
+        detail::message_state<Traits> message {};
+        /// Data submitted since the last flush.
+        std::span<const std::byte> pending {};
+        bool last = false;
+        bool queued = false;
+        bool complete = false;
+    };
+
+    /// Whole blocks of a job that can be compressed without copying.
+    struct block_range
+    {
+        std::uint32_t* state;
+        const std::byte* data;
+        std::size_t block_count;
+    };
+
+    /// Use the multi-lane kernel while at least this many lanes have data.
+    static constexpr std::size_t min_active_lanes = 3;
+
+    std::size_t allocate_job()
+    {
+        jobs_.emplace_back();
+        return jobs_.size() - 1;
+    }
+
+    void enqueue(std::size_t job_id, std::span<const std::byte> data, bool first, bool last)
+    {
+        Expects(job_id < jobs_.size());
+        if (jobs_[job_id].queued) {
+            flush();
+        }
+
+        auto& j = jobs_[job_id];
+        if (first) {
+            j.message.reset();
+        }
+        j.pending = data;
+        j.last = last;
+        j.queued = true;
+        j.complete = false;
+    }
+
+    void flush()
+    {
+        ranges_.clear();
+
+        for (auto& j : jobs_) {
+            if (!j.queued) continue;
+            j.message.length += j.pending.size();
+            j.pending = j.message.fill_buffer(j.pending);
+
+            if (auto n = j.pending.size() / Traits::block_size; n != 0) {
+                ranges_.push_back({j.message.state.data(), j.pending.data(), n});
+                j.pending = j.pending.subspan(n * Traits::block_size);
+            }
+        }
+
+        compress_ranges();
+
+        for (auto& j : jobs_) {
+            if (!j.queued) continue;
+            j.message.store_tail(j.pending);
+            j.pending = {};
+            j.queued = false;
+            j.complete = j.last;
+        }
+    }
+
+    void compress_ranges()
+    {
+        std::size_t next = 0;
+
+        if (lanes_compress_ != nullptr && ranges_.size() >= min_active_lanes) {
+            using state_type = typename detail::message_state<Traits>::state_type;
+
+            // lanes without a job compress a copy of the data of an active lane into a scratch state
+            state_type scratch_state {};
+            std::array<std::uint32_t*, lane_count> states {};
+            std::array<const std::byte*, lane_count> data {};
+            std::array<std::size_t, lane_count> remaining {};
+            std::size_t active = 0;
+
+            auto assign_lane = [&](std::size_t lane) {
+                if (next < ranges_.size()) {
+                    states[lane] = ranges_[next].state;
+                    data[lane] = ranges_[next].data;
+                    remaining[lane] = ranges_[next].block_count;
+                    ++next;
+                    ++active;
+                }
+                else {
+                    states[lane] = scratch_state.data();
+                    remaining[lane] = 0;
+                }
+            };
+
+            for (std::size_t lane = 0; lane < lane_count; ++lane) {
+                assign_lane(lane);
+            }
+
+            while (active >= min_active_lanes) {
+                std::size_t n = std::numeric_limits<std::size_t>::max();
+                const std::byte* active_data = nullptr;
+                for (std::size_t lane = 0; lane < lane_count; ++lane) {
+                    if (remaining[lane] == 0) continue;
+                    n = std::min(n, remaining[lane]);
+                    active_data = data[lane];
+                }
+                for (std::size_t lane = 0; lane < lane_count; ++lane) {
+                    if (remaining[lane] == 0) data[lane] = active_data;
+                }
+
+                lanes_compress_(states.data(), data.data(), n);
+
+                for (std::size_t lane = 0; lane < lane_count; ++lane) {
+                    if (remaining[lane] == 0) continue;
+                    data[lane] += n * Traits::block_size;
+                    remaining[lane] -= n;
+                    if (remaining[lane] == 0) {
+                        --active;
+                        assign_lane(lane);
+                    }
+                }
+            }
+
+            for (std::size_t lane = 0; lane < lane_count; ++lane) {
+                if (remaining[lane] != 0) {
+                    Traits::compress(states[lane], data[lane], remaining[lane]);
+                }
+            }
+        }
+
+        for (; next < ranges_.size(); ++next) {
+            Traits::compress(ranges_[next].state, ranges_[next].data, ranges_[next].block_count);
+        }
+    }
+
+    lanes_compress_function lanes_compress_;
+    std::vector<job> jobs_ {};
+    std::vector<block_range> ranges_ {};
+};
+
+
+extern template class hasher_impl<md5_traits>;
+using md5_hasher    = hasher_impl<md5_traits>;
+
+extern template class hasher_impl<sha1_traits>;
+using sha1_hasher   = hasher_impl<sha1_traits>;
+
+extern template class hasher_impl<sha256_traits>;
+using sha256_hasher = hasher_impl<sha256_traits>;
+
+extern template class hasher_impl<sha512_traits>;
+using sha512_hasher = hasher_impl<sha512_traits>;
+
+extern template class multi_buffer_hasher_impl<sha1_traits>;
+using sha1_multi_buffer_hasher   = multi_buffer_hasher_impl<sha1_traits>;
+
+extern template class multi_buffer_hasher_impl<sha256_traits>;
+using sha256_multi_buffer_hasher = multi_buffer_hasher_impl<sha256_traits>;
+
+static const auto supported_hash_functions = std::unordered_set {
+        hash_function::md5,
+        hash_function::sha1,
+        hash_function::sha256,
+        hash_function::sha512,
+};
+
+static const auto supported_multi_buffer_hash_functions = std::unordered_set {
+        hash_function::sha1,
+        hash_function::sha256,
+};
+
+} // namespace native
+} // namespace dottorrent
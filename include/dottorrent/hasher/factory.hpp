@@ -19,6 +19,10 @@
 #ifdef DOTTORRENT_USE_WOLFSSL
 #include "dottorrent/hasher/wolfssl_hasher.hpp"
 #endif
+#ifdef DOTTORRENT_USE_NATIVE
+#include "dottorrent/hasher/native_hasher.hpp"
+#include "dottorrent/hasher/native_multi_buffer_hasher.hpp"
+#endif
 
 #if defined(DOTTORRENT_USE_ISAL)
 #include "dottorrent/hasher/isal_multi_buffer_hasher.hpp"
@@ -39,6 +43,8 @@ inline std::unique_ptr<single_buffer_hasher> make_hasher(hash_function f)
     return std::make_unique<wincng_hasher>(f);
 #elif defined(DOTTORRENT_USE_WOLFSSL)
     return std::make_unique<wolfssl_hasher>(f);
+#elif defined(DOTTORRENT_USE_NATIVE)
+    return std::make_unique<native_hasher>(f);
 #else
     #error "No cryptographic library specified"
 #endif
@@ -50,6 +56,10 @@ inline std::unique_ptr<multi_buffer_hasher> make_multi_buffer_hasher(hash_functi
 {
 #if defined(DOTTORRENT_USE_ISAL)
     return std::make_unique<isal_multi_buffer_hasher>(f);
+#elif defined(DOTTORRENT_USE_NATIVE)
+    if (native_multi_buffer_hasher::supported_algorithms().contains(f)) {
+        return std::make_unique<native_multi_buffer_hasher>(f);
+    }
 #endif
     return nullptr;
 }
@@ -69,6 +79,8 @@ make_hash(std::span<const std::byte> data)
     auto hasher = std::make_unique<wincng_hasher>(F);
 #elif defined(DOTTORRENT_USE_WOLFSSL)
     auto hasher = std::make_unique<wolfssl_hasher>(F);
+#elif defined(DOTTORRENT_USE_NATIVE)
+    auto hasher = std::make_unique<native_hasher>(F);
 #else
     #error "No cryptographic library specified"
 #endif
@@ -90,6 +102,8 @@ hasher_supported_algorithms() noexcept
     return wincng_hasher::supported_algorithms();
 #elif defined(DOTTORRENT_USE_WOLFSSL)
     return wolfssl_hasher::supported_algorithms();
+#elif defined(DOTTORRENT_USE_NATIVE)
+    return native_hasher::supported_algorithms();
 #else
     #error "No cryptographic library specified!"
 #endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "dottorrent/chunk_reader.hpp"
+#include "dottorrent/chunk_planner.hpp"
+
+namespace dottorrent {
+
+/// Chunk reader for v1, v2 and hybrid torrents that keeps multiple reads in flight using io_uring.
+/// Reads are issued for several chunks at once, possibly spanning multiple files,
+/// and completed chunks are published in the same order as the sequential readers.
+/// @note Only available on Linux when build with DOTTORRENT_USE_IO_URING.
+class io_uring_chunk_reader : public chunk_reader
+{
+public:
+    /// @param queue_depth: the maximum number of read requests in flight.
+    io_uring_chunk_reader(file_storage& storage,
+                          protocol protocol_version,
+                          std::size_t block_size,
+                          std::size_t capacity,
+                          std::size_t queue_depth = 32);
+
+    void run() final;
+
+private:
+
+    protocol protocol_;
+    std::size_t queue_depth_;
+};
+
+} // namespace dottorrent
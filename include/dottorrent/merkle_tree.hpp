@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <shared_mutex>
 #include <gsl-lite/gsl-lite.hpp>
@@ -7,6 +10,7 @@
 #include "dottorrent/hash.hpp"
 #include "dottorrent/hash_function_traits.hpp"
 #include "dottorrent/hasher/factory.hpp"
+#include "dottorrent/hasher/backends/native.hpp"
 
 namespace dottorrent {
 
@@ -41,20 +45,33 @@ public:
     }
 
     merkle_tree(const merkle_tree& other)
-            : data_(other.data_) { }
+            : data_(other.data_)
+            , height_(other.height_)
+            , data_leaf_count_(other.data_leaf_count_)
+            , zero_padded_(other.zero_padded_)
+            , leaves_set_(other.leaves_set_.load(std::memory_order_acquire)) { }
 
     merkle_tree(merkle_tree&& other) noexcept
-            : data_(std::move(other.data_)) { }
+            : data_(std::move(other.data_))
+            , height_(other.height_)
+            , data_leaf_count_(other.data_leaf_count_)
+            , zero_padded_(other.zero_padded_)
+            , leaves_set_(other.leaves_set_.load(std::memory_order_acquire)) { }
 
     merkle_tree& operator=(const merkle_tree& other)
     {
         if (&other == this)
             return *this;
 
-        std::unique_lock lck1{data_.mutex_, std::defer_lock};
+        std::unique_lock lck1{mutex_, std::defer_lock};
         std::unique_lock lck2{other.mutex_, std::defer_lock};
         std::lock(lck1, lck2);
         data_ = other.data_;
+        height_ = other.height_;
+        data_leaf_count_ = other.data_leaf_count_;
+        zero_padded_ = other.zero_padded_;
+        leaves_set_.store(other.leaves_set_.load(std::memory_order_acquire), std::memory_order_release);
+        return *this;
     }
 
     merkle_tree& operator=(merkle_tree&& other) noexcept
@@ -62,15 +79,22 @@ public:
         if (&other == this)
             return *this;
 
-        std::unique_lock lck1{data_.mutex_, std::defer_lock};
+        std::unique_lock lck1{mutex_, std::defer_lock};
         std::unique_lock lck2{other.mutex_, std::defer_lock};
         std::lock(lck1, lck2);
         data_ = std::move(other.data_);
+        height_ = other.height_;
+        data_leaf_count_ = other.data_leaf_count_;
+        zero_padded_ = other.zero_padded_;
+        leaves_set_.store(other.leaves_set_.load(std::memory_order_acquire), std::memory_order_release);
+        return *this;
     }
 
     /// Set the number of leaf nodes and initialize them to `value`
     /// If no value is given the nodes will be default constructed.
-    /// All current values are invalidated.
+    /// All current values are invalidated and the count of leaves set is reset.
+    /// The tree is padded to a power of two with leaves equal to `value`, these must not be set.
+    /// Subtrees of zero padding leaves are not hashed, their roots are taken from padding_root().
     /// @remark Not thread-safe.
     void set_leaf_nodes(std::size_t leaf_nodes, const value_type& value = {})
     {
@@ -81,6 +105,30 @@ public:
         std::unique_lock lck{mutex_};
         data_.clear();
         data_.assign(node_count, value);
+        height_ = height;
+        // a tree without leaves still has a first leaf that can be set
+        data_leaf_count_ = std::max<std::size_t>(leaf_nodes, 1);
+        zero_padded_ = (value == value_type{});
+        leaves_set_.store(0, std::memory_order_release);
+    }
+
+    /// Return the root of a subtree of `height` with only zero leaves.
+    /// The roots are computed once for all heights.
+    static const value_type& padding_root(std::size_t height)
+    {
+        static const auto roots = [] {
+            std::array<value_type, max_tree_height + 1> r {};
+            auto hasher = make_hasher(FN);
+            for (std::size_t h = 1; h < r.size(); ++h) {
+                hasher->update(r[h-1]);
+                hasher->update(r[h-1]);
+                hasher->finalize_to(r[h]);
+            }
+            return r;
+        }();
+
+        Expects(height <= max_tree_height);
+        return roots[height];
     }
 
     /// Return true if the merkle root is set.
@@ -92,26 +140,37 @@ public:
     /// Calculate the root and inner hashes from the leaf hashes.
     void update(single_buffer_hasher& hasher)
     {
-        for (std::size_t layer = tree_height(); layer > 0; --layer) {
-            for (std::size_t i = 0; i < nodes_in_layer(layer); ++ i) {
-                hasher.update(get_node(layer, i));
-                hasher.update(get_node(layer, ++ i));
+        std::unique_lock lck{mutex_};
+        update_layers(height_, 0, 0, &hasher);
+    }
 
-                value_type hash{};
-                hasher.finalize_to(hash);
-                set_node(layer-1, parent(i), hash);
+    /// Calculate the root and inner hashes from the leaf hashes in blocks of subtrees.
+    /// Subtrees of `blocked_subtree_height` layers are hashed up to their root one after the other.
+    /// Each layer of a subtree is contiguous in the breadth-first layout and the nodes of a subtree fit in cache,
+    /// so a subtree is hashed without reloading its nodes from memory.
+    /// The result is the same as update(), see benchmarks/bench_merkle_tree.cpp for a comparison.
+    void update_blocked(single_buffer_hasher& hasher)
+    {
+        std::unique_lock lck{mutex_};
+        for (std::size_t bottom = height_; bottom > 0; ) {
+            const std::size_t top = bottom > blocked_subtree_height ? bottom - blocked_subtree_height : 0;
+            for (std::size_t i = 0; i < nodes_in_layer(top); ++i) {
+                update_layers(bottom, top, i, &hasher);
             }
+            bottom = top;
         }
     }
 
 #if defined(DOTTORRENT_USE_ISAL)
     void update(multi_buffer_hasher& hasher)
     {
+        if (update_batched()) return;
+
         for (std::size_t layer = tree_height(); layer > 0; -- layer) {
             std::size_t n_nodes = nodes_in_layer(layer);
 
             Expects(n_nodes % 2 == 0);
-            std::size_t n_jobs = n_nodes / 2;
+            std::size_t n_jobs = hashed_node_count(layer-1, 0, n_nodes / 2);
             hasher.resize(n_jobs);
             std::size_t job_id = 0;
 
@@ -127,11 +186,13 @@ public:
             }
             // Update parent nodes
             job_id = 0;
-            for (std::size_t i = 0; job_id < n_jobs; ++job_id, i+=2) {
+            for (; job_id < n_jobs; ++job_id) {
                 value_type hash{};
                 hasher.finalize_to(job_id, hash);
-                set_node(layer-1, parent(i), hash);
+                set_node(layer-1, job_id, hash);
             }
+            auto parents = std::span(data_).subspan(get_flat_index(layer-1, 0), n_nodes / 2);
+            set_padding_nodes(layer-1, parents.subspan(n_jobs));
         }
     }
 #endif
@@ -169,11 +230,11 @@ public:
     }
 
     /// Return the node at given layer and index
-     const value_type& get_node(std::size_t layer, std::size_t index) const
+    /// Lock-free, the node must not be written concurrently.
+    const value_type& get_node(std::size_t layer, std::size_t index) const
     {
         Expects(layer <= tree_height());
         Expects(index < nodes_in_layer(layer));
-        std::shared_lock lck{mutex_};
         return data_[get_flat_index(layer, index)];
     }
 
@@ -194,30 +255,100 @@ public:
         return get_node(tree_height(), index);
     }
 
-    void set_leaf(std::size_t index, const value_type& value)
+    /// Set the leaf at `index` and return the number of leaves set so far, including this one.
+    /// Lock-free, the leaves are preallocated slots and concurrent calls must set distinct leaves.
+    /// The returned count is incremented with acquire-release ordering: the call that observes the
+    /// final count has seen the writes of all previous calls and can complete the tree.
+    std::size_t set_leaf(std::size_t index, const value_type& value)
     {
         set_node(tree_height(), index, value);
+        return leaves_set_.fetch_add(1, std::memory_order_acq_rel) + 1;
     };
 
-    std::size_t node_count() const
+    /// Return the number of calls to set_leaf since the leaf nodes were set.
+    std::size_t leaves_set() const noexcept
+    { return leaves_set_.load(std::memory_order_acquire); }
+
+    std::size_t node_count() const noexcept
+    { return data_.size(); }
+
+    std::size_t leaf_count() const noexcept
+    { return (data_.size() + 1) / 2 ; }
+
+    std::size_t tree_height() const noexcept
+    { return height_; }
+
+private:
+    /// Hash a SHA-256 tree with the native inner node kernel.
+    /// Return false if the kernel is not accelerated on this CPU and the hasher should be used instead.
+    bool update_batched()
     {
-        std::shared_lock lck{mutex_};
-        return data_.size();
+        if constexpr (FN == hash_function::sha256) {
+            if (!native::sha256_batches_accelerated()) {
+                return false;
+            }
+
+            std::unique_lock lck{mutex_};
+            update_layers(height_, 0, 0, nullptr);
+            return true;
+        }
+        else {
+            return false;
+        }
     }
 
-    std::size_t leaf_count() const
+    /// Hash the layers from `bottom` up to the subtree with root node `index` in layer `top`.
+    /// The hasher can be null if the native inner node kernel is accelerated.
+    /// The caller must hold the mutex.
+    void update_layers(std::size_t bottom, std::size_t top, std::size_t index, single_buffer_hasher* hasher)
     {
-        std::shared_lock lck{mutex_};
-        return (data_.size() + 1) / 2 ;
+        for (std::size_t layer = bottom; layer > top; --layer) {
+            // number of nodes of the subtree in this layer
+            const std::size_t width = std::size_t(1) << (layer - top);
+            auto children = std::span(data_).subspan(get_flat_index(layer, index * width), width);
+            auto parents = std::span(data_).subspan(get_flat_index(layer-1, index * width / 2), width / 2);
+
+            const auto hashed = hashed_node_count(layer-1, index * width / 2, parents.size());
+            set_padding_nodes(layer-1, parents.subspan(hashed));
+            children = children.first(2 * hashed);
+            parents = parents.first(hashed);
+
+            if constexpr (FN == hash_function::sha256) {
+                if (native::sha256_batches_accelerated()) {
+                    native::sha256_inner_nodes(children, parents);
+                    continue;
+                }
+            }
+
+            Expects(hasher != nullptr);
+            for (std::size_t i = 0; i < parents.size(); ++i) {
+                hasher->update(children[2*i]);
+                hasher->update(children[2*i+1]);
+                hasher->finalize_to(parents[i]);
+            }
+        }
     }
 
-    std::size_t tree_height() const
+    /// Return how many of the `count` nodes in `layer` starting at `first` have data leaves below them.
+    /// The other nodes are roots of padding subtrees.
+    std::size_t hashed_node_count(std::size_t layer, std::size_t first, std::size_t count) const noexcept
     {
-        std::shared_lock lck{mutex_};
-        return get_node_layer(data_.size()-1);
+        if (!zero_padded_) {
+            return count;
+        }
+        const std::size_t data_nodes = detail::div_ceil(data_leaf_count_, std::size_t(1) << (height_ - layer));
+        return std::min(count, data_nodes - std::min(data_nodes, first));
     }
 
-private:
+    /// Set nodes of `layer` without data leaves below them from the padding table.
+    void set_padding_nodes(std::size_t layer, std::span<value_type> nodes) const
+    {
+        if (!nodes.empty()) {
+            std::fill(nodes.begin(), nodes.end(), padding_root(height_ - layer));
+        }
+    }
+
+    /// Lock-free, nodes are only resized by set_leaf_nodes which is not thread-safe.
     void set_node(std::size_t layer, std::size_t index, const value_type& value) noexcept
     {
         Expects(layer <= tree_height());
@@ -225,7 +356,6 @@ private:
 
         auto flat_index = get_flat_index(layer, index);
         Expects(flat_index <= data_.size());
-        std::unique_lock lck{mutex_};
         data_[flat_index] = value;
     }
 
@@ -270,7 +400,19 @@ private:
     static constexpr std::size_t right_child_n(std::size_t flat_idx, std::size_t n) noexcept
     { return (flat_idx * (2U << n)) + (4U << n) - 2; }
 
+    // leaves are indexed with std::size_t
+    static constexpr std::size_t max_tree_height = 63;
+
+    // subtrees of 2^10 nodes, 32 KiB of SHA-256 leaves and 32 KiB of inner nodes
+    static constexpr std::size_t blocked_subtree_height = 10;
+
     std::vector<value_type> data_;
+    std::size_t height_ = 0;
+    // number of leaves before the padding
+    std::size_t data_leaf_count_ = 0;
+    bool zero_padded_ = true;
+    // number of calls to set_leaf, hands the leaves over to the thread completing the tree
+    std::atomic<std::size_t> leaves_set_ = 0;
     mutable std::shared_mutex mutex_;
 };
 
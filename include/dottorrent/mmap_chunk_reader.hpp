@@ -0,0 +1,35 @@
+#pragma once
+
+#include "dottorrent/chunk_reader.hpp"
+#include "dottorrent/chunk_planner.hpp"
+
+namespace dottorrent {
+
+/// Chunk reader for v1, v2 and hybrid torrents that memory maps files.
+/// Chunks backed by a single file region are published as views of the mapping
+/// so no data is copied from the page cache.
+/// Chunks spanning multiple files [v1] are copied into a pool buffer.
+/// Files are mapped in windows of at least `mapping_size` bytes with sequential access and
+/// readahead hints. A window is unmapped when all chunks viewing it are released by the consumers.
+///
+/// @note Only available when build with DOTTORRENT_USE_MMAP.
+/// @warning Truncating a file while it is being read terminates the process with SIGBUS.
+class mmap_chunk_reader : public chunk_reader
+{
+public:
+    /// Minimal number of bytes mapped at once.
+    static constexpr std::size_t mapping_size = 64_MiB;
+
+    mmap_chunk_reader(file_storage& storage,
+                      protocol protocol_version,
+                      std::size_t block_size,
+                      std::size_t capacity);
+
+    void run() final;
+
+private:
+
+    protocol protocol_;
+};
+
+} // namespace dottorrent
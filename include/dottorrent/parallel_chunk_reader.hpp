@@ -0,0 +1,47 @@
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <optional>
+
+#include "dottorrent/chunk_reader.hpp"
+#include "dottorrent/chunk_planner.hpp"
+
+namespace dottorrent {
+
+/// Chunk reader that reads with multiple threads.
+/// Reader threads claim ranges of consecutive chunks from a shared work list.
+/// For v2 and hybrid torrents a range never crosses a file boundary so multiple files,
+/// or multiple parts of a large file, are read concurrently.
+/// Chunks are published in order within a range but ranges are published in any order.
+/// This is fine for piece hashers but not for consumers that require sequential data.
+class parallel_chunk_reader : public chunk_reader
+{
+public:
+    /// Maximum number of chunks claimed by a reader thread at once.
+    static constexpr std::size_t max_chunks_per_claim = 16;
+
+    parallel_chunk_reader(file_storage& storage,
+                          protocol protocol_version,
+                          std::size_t block_size,
+                          std::size_t capacity,
+                          std::size_t thread_count = 4);
+
+    void run() final;
+
+private:
+    void run_worker();
+
+    /// Claim the next range of chunks from the shared work list.
+    /// @returns false when all work is claimed.
+    bool claim(std::vector<chunk_descriptor>& range);
+
+
+    protocol protocol_;
+    std::size_t thread_count_;
+    std::mutex planner_mutex_ {};
+    std::optional<chunk_planner> planner_ {};
+    std::optional<chunk_descriptor> next_ {};
+};
+
+} // namespace dottorrent
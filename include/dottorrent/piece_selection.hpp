@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "dottorrent/file_storage.hpp"
+#include "dottorrent/general.hpp"
+
+namespace dottorrent {
+
+/// How the sampled pieces of a file are chosen.
+enum class sampling_strategy
+{
+    /// Pieces are chosen uniformly at random.
+    random,
+    /// The file is divided in equally sized strata and a random piece is chosen from each stratum.
+    stratified,
+};
+
+/// Options for a quick check that only verifies a sample of the pieces of each file.
+struct piece_sampling_options
+{
+    /// Fraction of the pieces of each file to verify.
+    double fraction = 0.01;
+    /// Minimum number of pieces to verify per file.
+    /// The larger of `count` and `fraction` times the number of pieces is used.
+    std::size_t count = 4;
+    /// The first and last piece of every file are always verified.
+    sampling_strategy strategy = sampling_strategy::stratified;
+    /// Seed of the random generator. When not set a random seed is used.
+    std::optional<std::uint64_t> seed = std::nullopt;
+    /// Stop reading pieces of a file after the first piece that does not match its hash.
+    bool stop_at_first_mismatch = false;
+};
+
+/// Summary of a sampled verification of a file.
+struct piece_sample_summary
+{
+    /// Number of pieces of the file.
+    std::size_t piece_count = 0;
+    /// Number of pieces selected for verification.
+    std::size_t sampled = 0;
+    /// Number of selected pieces that match their hash.
+    std::size_t verified = 0;
+    /// Number of selected pieces that do not match their hash.
+    std::size_t failed = 0;
+
+    /// Return true if all sampled pieces were verified.
+    bool intact() const noexcept
+    { return failed == 0 && verified == sampled; }
+
+    /// Return the probability that the sample would have contained a corrupted piece
+    /// if `corrupt_fraction` of the pieces of the file were corrupted.
+    /// Computed as if the verified pieces were drawn at random without replacement.
+    double confidence(double corrupt_fraction) const noexcept;
+};
+
+/// Pieces of a storage selected to be read, for a sampled verification or to resume hashing.
+///
+/// Pieces are indexed like the result of the piece verifier:
+/// by piece index for v1 torrents and by the index in the concatenated piece layers for v2 torrents,
+/// where files smaller than a piece have a single piece.
+/// For v1 torrents pieces that overlap multiple files can be selected for each of these files.
+class piece_selection
+{
+public:
+    /// Create a selection without selected pieces.
+    piece_selection(const file_storage& storage, protocol protocol_version);
+
+    /// Select a sample of the pieces of each file.
+    piece_selection(const file_storage& storage, protocol protocol_version, const piece_sampling_options& options);
+
+    /// Return the number of pieces in the index space of the selection.
+    std::size_t size() const noexcept
+    { return selected_.size(); }
+
+    bool selected(std::size_t index) const noexcept;
+
+    /// Add piece `index` to the selection.
+    /// @remark Not thread-safe, the selection cannot be changed while it is being read.
+    void select(std::size_t index) noexcept;
+
+    /// Return true if piece `piece_index` is selected,
+    /// with `piece_index` the piece index of a chunk published for file `file_index`.
+    bool selected(std::size_t file_index, std::size_t piece_index) const noexcept;
+
+    /// Return the first and one past the last piece of file `file_index`.
+    std::pair<std::size_t, std::size_t> file_pieces(std::size_t file_index) const noexcept;
+
+    /// Return the number of selected pieces of file `file_index`.
+    std::size_t selected_count(std::size_t file_index) const noexcept;
+
+    /// Mark all files that contain piece `index` as failed.
+    /// Thread-safe.
+    void mark_failed(std::size_t index) noexcept;
+
+    /// Return true if a piece of file `file_index` was marked as failed.
+    /// Thread-safe.
+    bool file_failed(std::size_t file_index) const noexcept;
+
+private:
+    /// Select the pieces in [first, last) of a file.
+    void select_file_pieces(std::size_t first, std::size_t last, std::mt19937_64& engine);
+
+    bool v1_layout_;
+    piece_sampling_options options_ {};
+    std::vector<bool> selected_ {};
+    // the range of pieces of each file, empty for padding files
+    std::vector<std::pair<std::size_t, std::size_t>> file_pieces_ {};
+    std::unique_ptr<std::atomic<bool>[]> file_failed_ {};
+};
+
+} // namespace dottorrent
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "dottorrent/utils.hpp"
+
+namespace dottorrent {
+
+enum class piece_state : std::uint8_t
+{
+    /// The piece was not checked yet.
+    pending,
+    /// The piece matches its hash.
+    verified,
+    /// The piece does not match its hash.
+    failed,
+};
+
+/// Lock-free verification state of a set of pieces.
+///
+/// Each piece has a checked bit and a verified bit, packed in 64-bit words.
+/// A piece is published once, from any thread.
+/// The verified bit is set before the checked bit is set with release ordering,
+/// so a reader that sees a piece as checked also sees whether it was verified.
+class piece_state_map
+{
+public:
+    piece_state_map() = default;
+
+    explicit piece_state_map(std::size_t size)
+            : size_(size)
+            , checked_(std::make_unique<std::atomic<std::uint64_t>[]>(word_count(size)))
+            , verified_(std::make_unique<std::atomic<std::uint64_t>[]>(word_count(size)))
+    {}
+
+    std::size_t size() const noexcept
+    { return size_; }
+
+    /// Publish the result of checking piece `index`.
+    void publish(std::size_t index, bool verified) noexcept
+    {
+        Expects(index < size_);
+        const auto word = index / bits_per_word;
+        const auto mask = std::uint64_t(1) << (index % bits_per_word);
+
+        if (verified) {
+            verified_[word].fetch_or(mask, std::memory_order_relaxed);
+        }
+        checked_[word].fetch_or(mask, std::memory_order_release);
+    }
+
+    piece_state state(std::size_t index) const noexcept
+    {
+        Expects(index < size_);
+        const auto word = index / bits_per_word;
+        const auto mask = std::uint64_t(1) << (index % bits_per_word);
+
+        if ((checked_[word].load(std::memory_order_acquire) & mask) == 0) {
+            return piece_state::pending;
+        }
+        if ((verified_[word].load(std::memory_order_relaxed) & mask) == 0) {
+            return piece_state::failed;
+        }
+        return piece_state::verified;
+    }
+
+    /// Return the number of checked pieces in [first, last).
+    std::size_t count_checked(std::size_t first, std::size_t last) const noexcept
+    { return count_bits(checked_.get(), first, last); }
+
+    /// Return the number of verified pieces in [first, last).
+    std::size_t count_verified(std::size_t first, std::size_t last) const noexcept
+    { return count_bits(verified_.get(), first, last); }
+
+private:
+    static constexpr std::size_t bits_per_word = 64;
+
+    static constexpr std::size_t word_count(std::size_t size) noexcept
+    { return detail::div_ceil(size, bits_per_word); }
+
+    std::size_t count_bits(const std::atomic<std::uint64_t>* words, std::size_t first, std::size_t last) const noexcept
+    {
+        Expects(first <= last);
+        Expects(last <= size_);
+        std::size_t count = 0;
+
+        for (std::size_t word = first / bits_per_word; word * bits_per_word < last; ++word) {
+            auto bits = words[word].load(std::memory_order_acquire);
+
+            // mask the bits before first and from last
+            const auto word_first = word * bits_per_word;
+            if (first > word_first) {
+                bits &= ~std::uint64_t(0) << (first - word_first);
+            }
+            if (last - word_first < bits_per_word) {
+                bits &= ~(~std::uint64_t(0) << (last - word_first));
+            }
+            count += std::popcount(bits);
+        }
+        return count;
+    }
+
+    std::size_t size_ = 0;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> checked_ {};
+    std::unique_ptr<std::atomic<std::uint64_t>[]> verified_ {};
+};
+
+} // namespace dottorrent
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace dottorrent {
+
+namespace detail {
+
+/// Hint to the processor that the calling thread is in a spin-wait loop.
+inline void spin_pause() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+} // namespace detail
+
+/// Bounded lock-free queue with the same interface as concurrent_queue.
+///
+/// The queue is a ring of slots with a sequence number per slot.
+/// Producers and consumers claim a slot with a single compare-and-swap on the tail or head counter,
+/// so consumers never contend on a lock, and a push only wakes a thread if one is parked.
+/// The queue is intended for the hop from a chunk reader to a pool of chunk processor threads,
+/// but multiple producers are supported.
+///
+/// Blocking calls spin for a short while before parking the thread on an atomic wait.
+/// The capacity is rounded up to a power of two.
+template <typename T>
+class ring_queue
+{
+public:
+    explicit ring_queue(std::size_t capacity)
+            : capacity_(std::bit_ceil(std::max<std::size_t>(capacity, 2)))
+            , mask_(capacity_ - 1)
+            , slots_(std::make_unique<slot[]>(capacity_))
+    {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ring_queue(const ring_queue&) = delete;
+    ring_queue(ring_queue&&) = delete;
+    ring_queue& operator=(const ring_queue&) = delete;
+    ring_queue& operator=(ring_queue&&) = delete;
+
+    void push(const T& item)
+    {
+        T copy = item;
+        push(std::move(copy));
+    }
+
+    void push(T&& item)
+    {
+        wait_until([&] { return try_push(std::move(item)); }, pop_count_, waiting_producers_);
+    }
+
+    bool try_push(T&& item)
+    {
+        std::size_t position = tail_.load(std::memory_order_relaxed);
+
+        for (;;) {
+            slot& s = slots_[position & mask_];
+            const auto sequence = s.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    s.value = std::move(item);
+                    s.sequence.store(position + 1, std::memory_order_release);
+                    notify(push_count_, waiting_consumers_);
+                    return true;
+                }
+            }
+            // the slot still holds an item from the previous lap
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void pop(T& item)
+    {
+        wait_until([&] { return try_pop(item); }, push_count_, waiting_consumers_);
+    }
+
+    bool try_pop(T& item)
+    {
+        std::size_t position = head_.load(std::memory_order_relaxed);
+
+        for (;;) {
+            slot& s = slots_[position & mask_];
+            const auto sequence = s.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    item = std::move(s.value);
+                    // release the moved-from value, eg. a buffer that has to return to an object pool
+                    s.value = T{};
+                    s.sequence.store(position + capacity_, std::memory_order_release);
+                    notify(pop_count_, waiting_producers_);
+                    return true;
+                }
+            }
+            // the slot has not been filled yet
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                position = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Return the number of items in the queue.
+    /// The result is approximate when other threads modify the queue concurrently.
+    std::size_t size() const noexcept
+    {
+        const auto head = head_.load(std::memory_order_acquire);
+        const auto tail = tail_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    std::size_t capacity() const noexcept
+    { return capacity_; }
+
+private:
+    /// Number of failed attempts before a blocked thread yields.
+    static constexpr std::size_t spin_count = 64;
+    /// Number of yields before a blocked thread parks.
+    static constexpr std::size_t yield_count = 16;
+
+    struct slot
+    {
+        std::atomic<std::size_t> sequence {};
+        T value {};
+    };
+
+    /// Call `f` until it returns true. After spinning the thread parks on `event` until it changes.
+    template <typename Fn>
+    static void wait_until(Fn&& f, std::atomic<std::uint32_t>& event, std::atomic<std::uint32_t>& waiting)
+    {
+        for (std::size_t i = 0; i < spin_count; ++i) {
+            if (f()) return;
+            detail::spin_pause();
+        }
+        for (std::size_t i = 0; i < yield_count; ++i) {
+            if (f()) return;
+            std::this_thread::yield();
+        }
+        for (;;) {
+            // Register as waiting before the last attempt, so that a notify that
+            // happens after the attempt sees the waiter and changes `event`.
+            waiting.fetch_add(1, std::memory_order_seq_cst);
+            const auto current = event.load(std::memory_order_seq_cst);
+            if (f()) {
+                waiting.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            event.wait(current, std::memory_order_seq_cst);
+            waiting.fetch_sub(1, std::memory_order_relaxed);
+            if (f()) return;
+        }
+    }
+
+    static void notify(std::atomic<std::uint32_t>& event, std::atomic<std::uint32_t>& waiting) noexcept
+    {
+        event.fetch_add(1, std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_seq_cst) != 0) {
+            event.notify_one();
+        }
+    }
+
+    // keep counters that are written by different threads on separate cache lines
+    static constexpr std::size_t cache_line_size = 64;
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<slot[]> slots_;
+
+    alignas(cache_line_size) std::atomic<std::size_t> tail_ {0};
+    alignas(cache_line_size) std::atomic<std::size_t> head_ {0};
+    alignas(cache_line_size) std::atomic<std::uint32_t> push_count_ {0};
+    std::atomic<std::uint32_t> waiting_consumers_ {0};
+    alignas(cache_line_size) std::atomic<std::uint32_t> pop_count_ {0};
+    std::atomic<std::uint32_t> waiting_producers_ {0};
+};
+
+} // namespace dottorrent
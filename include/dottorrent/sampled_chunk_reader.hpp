@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+
+#include "dottorrent/chunk_reader.hpp"
+#include "dottorrent/chunk_planner.hpp"
+#include "dottorrent/piece_selection.hpp"
+
+namespace dottorrent {
+
+/// Chunk reader that only reads the pieces of a piece_selection.
+/// Chunks are planned with the same layout as the other readers and trimmed to runs of
+/// consecutive selected pieces, so each run is read with a single seek.
+/// Pieces of files that are marked as failed in the selection are skipped.
+/// Pieces that are not selected are never published.
+class sampled_chunk_reader : public chunk_reader
+{
+public:
+    sampled_chunk_reader(file_storage& storage,
+                         protocol protocol_version,
+                         std::size_t block_size,
+                         std::size_t capacity,
+                         std::shared_ptr<const piece_selection> selection);
+
+    void run() final;
+
+private:
+    /// Return the part of `descriptor` that covers the pieces in [first, last) of the chunk.
+    chunk_descriptor trim(const chunk_descriptor& descriptor, std::size_t first, std::size_t last) const;
+
+    /// Return true if all files of a chunk are marked as failed in the selection.
+    bool skip(const chunk_descriptor& descriptor) const noexcept;
+
+    protocol protocol_;
+    std::shared_ptr<const piece_selection> selection_;
+};
+
+} // namespace dottorrent
@@ -27,8 +27,12 @@
 #include "dottorrent/hash.hpp"
 #include "dottorrent/checksum.hpp"
 #include "dottorrent/chunk_reader.hpp"
+#include "dottorrent/chunk_reader_factory.hpp"
+#include "dottorrent/executor.hpp"
 #include "dottorrent/chunk_hasher_single_buffer.hpp"
 #include "dottorrent/hashed_piece_processor.hpp"
+#include "dottorrent/hash_checkpoint.hpp"
+#include "dottorrent/piece_selection.hpp"
 
 
 namespace dottorrent {
@@ -54,10 +58,47 @@ struct storage_hasher_options
     /// Weither to enable multi-buffer hashing if linked against Intel ISA-L.
     bool enable_multi_buffer_hashing = true;
 
-    /// Number of threads to hash pieces.
+    /// Number of threads to hash pieces, and to hash files for each per file checksum type.
     /// Total number of threads will be equal to:
-    /// 1 main thread + 1 reader + <thread> piece hashers + <#checksums types> checksum hashers
+    /// 1 main thread + 1 reader + <thread> piece hashers + <#checksums types> * <thread> checksum hashers
     std::size_t threads = 2;
+
+    /// The strategy used to read data from disk.
+    /// Must be sequential when `checkpoint_file` or `previous_storage` is set:
+    /// pieces that are not restored are then read one run of pieces at a time with blocking reads.
+    reader_type reader = reader_type::sequential;
+    /// Maximum number of read requests in flight when using the io_uring reader.
+    std::size_t io_queue_depth = 32;
+    /// Number of reader threads when using the parallel reader.
+    std::size_t reader_threads = 4;
+    /// Let the chunk hashers store v1 piece hashes directly in the file_storage
+    /// instead of passing them to a piece writer thread. Only applies to v1 torrents.
+    /// Cannot be combined with `checkpoint_file`.
+    bool write_pieces_in_place = false;
+    /// Executor to run the piece hashers, the checksum hashers and the piece writer on.
+    /// When set, these stages do not start their own threads and `threads` limits
+    /// the number of piece hashing tasks that run concurrently.
+    /// The executor can be shared between multiple storage_hasher objects.
+    /// The reader always runs on its own thread.
+    std::shared_ptr<dottorrent::executor> executor = nullptr;
+    /// Path of a checkpoint file to save the completed hashes to.
+    /// The checkpoint is saved every `checkpoint_interval` and when the hasher is cancelled,
+    /// and removed when hashing completes.
+    /// When the file exists on start, the hashes in the checkpoint are restored and only
+    /// the pieces that were not completed, and files that changed since, are read.
+    /// Requires the sequential reader and cannot be combined with `write_pieces_in_place`.
+    std::optional<fs::path> checkpoint_file = std::nullopt;
+    /// Interval between two saves of the checkpoint file.
+    std::chrono::seconds checkpoint_interval = 60s;
+    /// Storage of a previous version of the files, for example the storage of a previously created metafile.
+    /// Only files that changed since are read, the hashes of unchanged files are taken from the previous storage.
+    /// See hash_checkpoint::add_unchanged_files for when a file is unchanged.
+    /// Requires the sequential reader.
+    std::shared_ptr<const file_storage> previous_storage = nullptr;
+    /// Files without a last modification time in `previous_storage` are unchanged
+    /// when they were not modified after this time, for example the creation date of the previous metafile.
+    /// Changes within the timestamp resolution of the file system are not detected.
+    std::optional<fs::file_time_type> unchanged_since = std::nullopt;
 };
 
 
@@ -93,19 +134,40 @@ public:
     bool done() const noexcept;
 
     /// The number of bytes read from disk by the reader thread.
+    /// Pieces restored from a checkpoint or previous storage are not read.
     std::size_t bytes_read() const noexcept;
 
     /// Return the number of bytes hashed by the v1 or v2 hasher,
     /// or the average between the two for hybrid torrents.
+    /// Pieces restored from a checkpoint or previous storage are counted as hashed when the hasher starts.
     std::size_t bytes_hashed() const noexcept;
 
     /// Return the number of bytes hashed by the v1 or v2 hasher,
     /// or the average between the two for hybrid torrents.
+    /// Pieces restored from a checkpoint or previous storage are counted as hashed when the hasher starts.
     std::size_t bytes_done() const noexcept;
 
     file_progress_data current_file_progress() const noexcept;
 
+    /// Return the number of files of which the hashes were taken from the previous storage.
+    std::size_t unchanged_file_count() const noexcept;
+
+    /// Save the completed hashes to the checkpoint file.
+    /// @throws std::logic_error if no checkpoint file is set or the hasher is not started.
+    void save_checkpoint() const;
+
 private:
+    /// Return the pieces that are not complete in the checkpoint and have to be read.
+    std::shared_ptr<piece_selection> make_resume_selection() const;
+
+    /// Restore the hashes of the pieces that are not in the resume selection.
+    void restore_checkpoint(const piece_selection& selection);
+
+    /// Return true if the checkpoint does not contain all checksums of a file.
+    bool missing_checksums(std::size_t file_index) const;
+
+    void stop_checkpoint_thread();
+
     std::reference_wrapper<file_storage> storage_;
     enum protocol protocol_;
     std::unordered_set<hash_function> checksums_;
@@ -113,11 +175,24 @@ private:
     std::size_t io_block_size_;
     std::size_t queue_capacity_;
     bool enable_multi_buffer_hashing_;
+    bool write_pieces_in_place_;
+    chunk_reader_options reader_options_;
+    std::shared_ptr<executor> executor_;
+    std::optional<fs::path> checkpoint_file_;
+    std::chrono::seconds checkpoint_interval_;
+    std::shared_ptr<const file_storage> previous_storage_;
+    std::optional<fs::file_time_type> unchanged_since_;
+    std::size_t unchanged_file_count_ = 0;
+    // file bytes of the pieces restored from the checkpoint
+    std::size_t restored_bytes_ = 0;
 
     std::unique_ptr<chunk_reader> reader_;
     std::unique_ptr<chunk_processor> hasher_;
     std::vector<std::unique_ptr<chunk_processor>> checksum_hashers_;
+    /// Piece writer, nullptr when v1 pieces are written in place.
     std::unique_ptr<hashed_piece_processor> verifier_;
+    std::shared_ptr<hash_checkpoint> checkpoint_ {};
+    std::jthread checkpoint_thread_ {};
 
     bool started_ = false;
     bool stopped_ = false;
@@ -27,8 +27,11 @@
 #include "dottorrent/hash.hpp"
 #include "dottorrent/checksum.hpp"
 #include "dottorrent/chunk_reader.hpp"
+#include "dottorrent/chunk_reader_factory.hpp"
+#include "dottorrent/executor.hpp"
 #include "dottorrent/chunk_hasher_single_buffer.hpp"
 #include "dottorrent/hashed_piece_processor.hpp"
+#include "dottorrent/piece_selection.hpp"
 #include "hashed_piece_verifier.hpp"
 
 namespace dottorrent {
@@ -57,6 +60,26 @@ struct storage_verifier_options
     /// Total number of threads will be equal to:
     /// 1 main thread + 1 reader + <thread> piece hashers + <#checksums types> checksum hashers
     std::size_t threads = 2;
+
+    /// The strategy used to read data from disk.
+    reader_type reader = reader_type::sequential;
+    /// Maximum number of read requests in flight when using the io_uring reader.
+    std::size_t io_queue_depth = 32;
+    /// Number of reader threads when using the parallel reader.
+    std::size_t reader_threads = 4;
+    /// Executor to run the piece hashers and the piece verifier on.
+    /// When set, these stages do not start their own threads and `threads` limits
+    /// the number of piece hashing tasks that run concurrently.
+    /// The executor can be shared between multiple storage_verifier objects.
+    /// The reader always runs on its own thread.
+    std::shared_ptr<dottorrent::executor> executor = nullptr;
+    /// Called for every piece as soon as it is checked, with the index of the piece in result()
+    /// and whether it matches its hash.
+    /// Called concurrently from the verifier threads, or from the executor threads when an executor is set.
+    hashed_piece_verifier::piece_callback piece_callback = nullptr;
+    /// When set only a sample of the pieces of each file is read and verified.
+    /// The sampled pieces are read with a dedicated reader and `reader` is ignored.
+    std::optional<piece_sampling_options> sampling = std::nullopt;
 };
 
 
@@ -106,10 +129,28 @@ public:
 
     const std::vector<std::uint8_t>& result() const noexcept;
 
+    /// Return the state of the pieces in result().
+    /// Can be read while verifying, pieces are published as soon as they are checked,
+    /// and keeps the pieces checked before a cancellation.
+    /// @remark Only valid after calling start().
+    const piece_state_map& piece_states() const noexcept;
+
     double percentage(std::size_t file_index) const noexcept;
 
     double percentage(const file_entry& entry) const;
 
+    /// Return true if only a sample of the pieces is verified.
+    bool sampled() const noexcept;
+
+    /// Return the pieces selected for a sampled verification.
+    /// @throws std::logic_error if sampling is not enabled.
+    const piece_selection& selection() const;
+
+    /// Return the result of the sampled verification of a file.
+    /// Pieces that are not sampled remain pending in piece_states() and unverified in result().
+    /// @throws std::logic_error if sampling is not enabled.
+    piece_sample_summary sample_summary(std::size_t file_index) const;
+
     ~storage_verifier();
 
 private:
@@ -120,6 +161,11 @@ private:
     std::size_t io_block_size_;
     std::size_t queue_capacity_;
     bool enable_multi_buffer_hashing_;
+    chunk_reader_options reader_options_;
+    std::shared_ptr<executor> executor_;
+    hashed_piece_verifier::piece_callback piece_callback_;
+    std::optional<piece_sampling_options> sampling_;
+    std::shared_ptr<piece_selection> selection_ {};
 
     std::unique_ptr<chunk_reader> reader_;
     std::unique_ptr<chunk_processor> hasher_;
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "dottorrent/hash.hpp"
+
+namespace dottorrent {
+
+/// SHA-256 merkle tree of a v2 file that is reduced while the leaves arrive.
+///
+/// Leaves can be set in any order. The leaves of a piece are buffered until the last one arrives,
+/// then the piece subtree is hashed and the leaves are released.
+/// Pieces of a single leaf are not buffered, the leaf is the piece hash.
+/// Setting a leaf is lock-free, only the completion of the first incomplete piece takes the lock.
+/// Piece hashes are folded towards the root as soon as they form a contiguous range from the first piece,
+/// using a frontier stack with at most one subtree per height.
+/// Only the piece layer, the leaves of incomplete pieces and the frontier are kept in memory.
+///
+/// The tree has the same shape as a merkle_tree<hash_function::sha256> with `leaf_count` leaves.
+/// Leaves that are never set are zero.
+class streaming_merkle_tree
+{
+public:
+    /// Called with the index and hash of a piece when its subtree is hashed.
+    using piece_callback = std::function<void(std::size_t piece_index, const sha256_hash& hash)>;
+
+    /// @param leaf_count the number of 16 KiB blocks of the file.
+    /// @param piece_leaf_count the number of leaves covered by a piece hash, a power of two.
+    streaming_merkle_tree(std::size_t leaf_count, std::size_t piece_leaf_count);
+
+    streaming_merkle_tree(streaming_merkle_tree&& other) noexcept;
+
+    ~streaming_merkle_tree();
+
+    /// Set a function called for every piece hash, on the thread that completed the piece.
+    /// Files that fit in a single piece have a single piece hash equal to the root.
+    /// @remark Not thread-safe, must be set before the first leaf.
+    void set_piece_callback(piece_callback callback);
+
+    /// Set the value of leaf `index` and hash the piece it belongs to if it is complete.
+    /// Thread-safe, concurrent calls must set distinct leaves.
+    /// @returns true if this call hashed the last piece and the tree can be finalized.
+    bool set_leaf(std::size_t index, const sha256_hash& value);
+
+    /// Set the hash of a complete piece without setting its leaves, to restore a piece hashed before.
+    /// The piece callback is called like for a piece completed by its leaves.
+    /// Thread-safe, no leaves of the piece can be set.
+    /// @returns true if this call set the last piece and the tree can be finalized.
+    bool set_piece_hash(std::size_t piece_index, const sha256_hash& hash);
+
+    /// Hash the incomplete pieces and fold the remaining subtrees into the root.
+    /// Missing leaves are treated as zero.
+    /// @remark Not thread-safe.
+    void finalize();
+
+    /// Return the root hash.
+    /// @remark Only valid after calling finalize().
+    const sha256_hash& root() const noexcept
+    { return root_; }
+
+    /// Return the piece hashes covering the data of the file.
+    /// Empty if the file fits in a single piece, like the piece layers of a metafile.
+    /// @remark Only valid after calling finalize().
+    std::span<const sha256_hash> piece_layer() const noexcept;
+
+    std::size_t leaf_count() const noexcept
+    { return leaf_count_; }
+
+    std::size_t tree_height() const noexcept
+    { return tree_height_; }
+
+private:
+    /// Leaf buffer of a piece, allocated by the first leaf of the piece.
+    /// The count hands the buffer over to the thread setting the last leaf with acquire-release ordering.
+    /// The done flag publishes the piece hash to the thread folding the piece into the frontier.
+    struct piece_slot
+    {
+        std::atomic<sha256_hash*> leaves = nullptr;
+        std::atomic<std::size_t> leaves_set = 0;
+        std::atomic<bool> done = false;
+    };
+
+    struct frontier_node
+    {
+        std::size_t height;
+        sha256_hash hash;
+    };
+
+    /// Number of leaves of the file in piece `piece_index`.
+    std::size_t leaves_in_piece(std::size_t piece_index) const noexcept;
+
+    /// Store a piece hash and fold the contiguous pieces into the frontier.
+    /// Only takes the mutex if the piece is the first incomplete piece.
+    /// @returns true if this call folded the last piece.
+    bool set_piece(std::size_t piece_index, const sha256_hash& hash);
+
+    /// Push the root of a subtree of `height` above the piece layer and merge subtrees of equal height.
+    void push_frontier(std::size_t height, const sha256_hash& hash);
+
+    std::size_t leaf_count_;
+    std::size_t tree_height_;
+    // number of leaves per piece, at most all leaves of the padded tree
+    std::size_t piece_width_;
+    // height of the subtree above the piece layer
+    std::size_t top_height_;
+
+    std::vector<piece_slot> slots_ {};
+    // written once per piece before its done flag is set
+    std::vector<sha256_hash> pieces_ {};
+    // first piece not folded into the frontier, only written with mutex_ held
+    std::atomic<std::size_t> next_piece_ = 0;
+
+    // guarded by mutex_
+    std::vector<frontier_node> frontier_ {};
+    sha256_hash root_ {};
+    piece_callback piece_callback_ {};
+    mutable std::mutex mutex_ {};
+};
+
+} // namespace dottorrent
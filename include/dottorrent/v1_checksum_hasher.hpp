@@ -1,37 +1,28 @@
 #pragma once
 #include <vector>
 #include <memory>
-#include <atomic>
-#include <thread>
-
-#include <gsl-lite/gsl-lite.hpp>
 
 #include "dottorrent/hash_function.hpp"
-#include "dottorrent/hash.hpp"
-#include "dottorrent/checksum.hpp"
-
 #include "dottorrent/file_storage.hpp"
 #include "dottorrent/data_chunk.hpp"
-#include "dottorrent/hash_function_traits.hpp"
-#include "dottorrent/chunk_hasher_single_buffer.hpp"
-#include "dottorrent/hasher/factory.hpp"
+#include "dottorrent/checksum_hasher.hpp"
 
 namespace dottorrent {
 
-class v1_checksum_hasher : public chunk_hasher_single_buffer {
+/// Per file checksums for v1 torrents.
+/// Chunks hold the data of consecutive files and are split in ranges of a single file.
+class v1_checksum_hasher : public checksum_hasher {
 public:
 
-    explicit v1_checksum_hasher(file_storage& storage, hash_function f, std::size_t capacity);
+    explicit v1_checksum_hasher(file_storage& storage, hash_function f, std::size_t capacity,
+                                std::size_t thread_count = 1, bool enable_multi_buffer_hashing = false);
 
 protected:
-    void hash_chunk(std::vector<std::unique_ptr<single_buffer_hasher>>& hashers, const data_chunk& chunk) override;
-
-    void hash_chunk(single_buffer_hasher& hasher, const data_chunk& item);
+    void split_chunk(const data_chunk& chunk, std::vector<file_data_range>& ranges) override;
 
 private:
-    std::atomic<std::size_t> current_file_index_ = 0;
-    std::atomic<std::size_t> current_file_size_ = 0;
-    std::atomic<std::size_t> current_file_data_hashed_ = 0;
+    // position of the end of each file in the concatenated file data
+    std::vector<std::size_t> file_end_offsets_;
 };
 
-} // namespace dottorrent
\ No newline at end of file
+} // namespace dottorrent
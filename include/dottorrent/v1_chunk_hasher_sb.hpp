@@ -15,14 +15,21 @@ public:
     using base_type = chunk_hasher_single_buffer;
     using hash_type = sha1_hash;
 
-    explicit v1_chunk_hasher_sb(file_storage& storage, std::size_t capacity, std::size_t thread_count = 1);
+    /// @param write_in_place: store piece hashes directly in `storage` instead of publishing them
+    ///     to the registered v1 hashed piece queue.
+    explicit v1_chunk_hasher_sb(file_storage& storage, std::size_t capacity, std::size_t thread_count = 1,
+                                bool write_in_place = false);
 
 protected:
     void hash_chunk(std::vector<std::unique_ptr<single_buffer_hasher>>& hashers, const data_chunk& chunk) override;
 
     void hash_chunk(single_buffer_hasher& hasher, const data_chunk& chunk);
 
-    void process_piece_hash(std::size_t piece_idx, std::size_t file_idx, const sha1_hash& piece_hash);
+    void process_piece_hash(v1_hashed_piece_batch& pieces, std::size_t piece_idx, std::size_t file_idx,
+                            const sha1_hash& piece_hash);
+
+private:
+    bool write_in_place_ = false;
 };
 
 }
\ No newline at end of file
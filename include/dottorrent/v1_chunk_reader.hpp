@@ -18,11 +18,6 @@ public:
 private:
     void handle_missing_file();
 
-    /// @param file_idx: index of the file the data is read from,
-    ///     when a chunk consists of data from multiple files,
-    ///     the index of the first part as given by file_offset.
-    void push(const data_chunk& data_chunk);
-
     // index of the first piece in a chunk
     std::size_t piece_index_ = 0;
     // position of the first free byte in the current chunk
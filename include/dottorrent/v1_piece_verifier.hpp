@@ -33,6 +33,10 @@ public:
 
     bool done() const noexcept override;
 
+    void set_executor(std::shared_ptr<executor> executor) override;
+
+    void notify() override;
+
     std::shared_ptr<v1_piece_queue_type> get_v1_queue() override;
 
     std::shared_ptr<v2_piece_queue_type> get_v2_queue() override;
@@ -45,7 +49,7 @@ private:
     void verify_finished_piece(const v1_hashed_piece& piece);
 
     std::reference_wrapper<file_storage> storage_;
-    concurrent_queue_processor<v1_hashed_piece> processor_;
+    concurrent_queue_processor<v1_hashed_piece_batch> processor_;
     std::vector<std::uint8_t> piece_map_;
 
 };
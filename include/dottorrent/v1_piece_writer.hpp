@@ -7,6 +7,7 @@
 #include "hash.hpp"
 #include "concurrent_queue_processor.hpp"
 #include "hashed_piece_processor.hpp"
+#include "hash_checkpoint.hpp"
 
 namespace dottorrent {
 
@@ -31,15 +32,24 @@ public:
 
     bool done() const noexcept override;
 
+    void set_executor(std::shared_ptr<executor> executor) override;
+
+    void notify() override;
+
     std::shared_ptr<v1_piece_queue_type> get_v1_queue() override;
 
     std::shared_ptr<v2_piece_queue_type> get_v2_queue() override;
 
+    /// Add every finished piece to a checkpoint.
+    /// @remark Not thread-safe, must be set before starting the writer.
+    void set_checkpoint(std::shared_ptr<hash_checkpoint> checkpoint);
+
 private:
     void set_finished_piece(const v1_hashed_piece& finished_piece);
 
     std::reference_wrapper<file_storage> storage_;
-    concurrent_queue_processor<v1_hashed_piece> processor_;
+    std::shared_ptr<hash_checkpoint> checkpoint_ {};
+    concurrent_queue_processor<v1_hashed_piece_batch> processor_;
 };
 
 }
\ No newline at end of file
@@ -25,9 +25,23 @@ protected:
 
     void hash_chunk(multi_buffer_hasher& sha256_hasher, multi_buffer_hasher& sha1_hasher, const data_chunk& chunk);
 
-    void process_piece_hash(std::size_t piece_idx, std::size_t file_index, const sha1_hash& piece_hash);
-
-    void process_piece_hash(std::size_t leaf_index, std::size_t file_index, const sha256_hash& piece_hash);
+    /// Data of a single file starting at piece `piece_index` of the file.
+    struct file_data
+    {
+        std::size_t piece_index;
+        std::size_t file_index;
+        std::span<const std::byte> data;
+    };
+
+    /// Hash the data of one or more files in a single multi-buffer batch.
+    void hash_file_data(multi_buffer_hasher& sha256_hasher, multi_buffer_hasher& sha1_hasher,
+                        std::span<const file_data> files);
+
+    void process_piece_hash(v1_hashed_piece_batch& pieces, std::size_t piece_idx, std::size_t file_index,
+                            const sha1_hash& piece_hash);
+
+    void process_piece_hash(v2_hashed_piece_batch& leaves, std::size_t leaf_index, std::size_t file_index,
+                            const sha256_hash& piece_hash);
 
 private:
     bool add_v1_compatibility_ = false;
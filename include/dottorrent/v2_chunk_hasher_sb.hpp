@@ -24,9 +24,17 @@ protected:
 
     void hash_chunk(single_buffer_hasher& sha256_hasher, single_buffer_hasher& sha1_hasher, const data_chunk& chunk);
 
-    void process_piece_hash(std::size_t piece_idx, std::size_t file_index, const sha1_hash& piece_hash);
+    /// Hash data of a single file starting at piece `piece_index` of the file.
+    /// The resulting hashes are appended to `pieces` and `leaves`.
+    void hash_file_data(single_buffer_hasher& sha256_hasher, single_buffer_hasher& sha1_hasher,
+                        v1_hashed_piece_batch& pieces, v2_hashed_piece_batch& leaves,
+                        std::size_t piece_index, std::size_t file_index, std::span<const std::byte> data);
 
-    void process_piece_hash(std::size_t leaf_index, std::size_t file_index, const sha256_hash& piece_hash);
+    void process_piece_hash(v1_hashed_piece_batch& pieces, std::size_t piece_idx, std::size_t file_index,
+                            const sha1_hash& piece_hash);
+
+    void process_piece_hash(v2_hashed_piece_batch& leaves, std::size_t leaf_index, std::size_t file_index,
+                            const sha256_hash& piece_hash);
 
 private:
     bool add_v1_compatibility_ = false;
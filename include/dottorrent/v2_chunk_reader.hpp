@@ -8,6 +8,7 @@ namespace dottorrent {
 
 
 /// Chunk reader suitable for v2 and hybrid torrents.
+/// Files smaller than the chunk size are packed together in a single chunk.
 class v2_chunk_reader : public chunk_reader
 {
 public:
@@ -21,6 +22,13 @@ private:
     ///     the index of the first part as given by file_offset.
     void push(const data_chunk& chunk);
 
+    /// Append the complete content of the current file to the packed chunk.
+    /// @returns false if the file size differs from `file_size`, the file is not packed in that case.
+    bool read_packed_file(const fs::path& file_path, std::size_t file_size);
+
+    /// Push the packed chunk to the consumers if it holds any files.
+    void push_packed_chunk();
+
     std::size_t piece_index_ = 0;
     // size of the current chunk, less then chunk_size_ for files smaller then `chunk_size_`
     std::size_t current_chunk_size_ = 0;
@@ -28,6 +36,10 @@ private:
     std::size_t file_index_ = 0;
     // the current file being read, disable read buffer
     std::ifstream f_;
+    // chunk with small files and the ranges of these files in the chunk
+    std::shared_ptr<data_type> packed_chunk_ {};
+    std::shared_ptr<std::vector<data_chunk_part>> packed_parts_ {};
+    std::size_t packed_size_ = 0;
 };
 
 }
\ No newline at end of file
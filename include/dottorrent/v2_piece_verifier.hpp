@@ -4,6 +4,7 @@
 #include "dottorrent/hashed_piece_verifier.hpp"
 #include "dottorrent/concurrent_queue_processor.hpp"
 #include "dottorrent/file_storage.hpp"
+#include "dottorrent/streaming_merkle_tree.hpp"
 
 namespace dottorrent
 {
@@ -29,6 +30,10 @@ public:
 
     bool done() const noexcept override;
 
+    void set_executor(std::shared_ptr<executor> executor) override;
+
+    void notify() override;
+
     std::shared_ptr<v1_piece_queue_type> get_v1_queue() override;
 
     std::shared_ptr<v2_piece_queue_type> get_v2_queue() override;
@@ -41,19 +46,25 @@ protected:
     void initialize_offsets_and_trees();
 
     void verify_finished_piece(const v2_hashed_piece& finished_piece);
-    template <typename HasherType>
-    void verify_piece_layers_and_root(HasherType& hasher, std::size_t file_index);
+
+    /// Compare the hash of a piece with the piece layer, or with the root for files smaller than a piece.
+    void verify_piece(std::size_t file_index, std::size_t piece_index, const sha256_hash& hash);
+
+    /// Return true for files with a tree taller than a piece subtree but without a piece layer,
+    /// these are verified against the root when all their leaves are hashed.
+    bool requires_root(std::size_t file_index) const noexcept;
 
 private:
     std::reference_wrapper<file_storage> storage_;
-    std::vector<merkle_tree<hash_function::sha256>> merkle_trees_ {};
-    /// Vector with the count of 16 KiB blocks_hashed per file
-    std::vector<std::atomic<std::size_t>> file_blocks_hashed_ {};
+    // only the piece layer of each file is computed, pieces are verified as they complete
+    std::vector<streaming_merkle_tree> merkle_trees_ {};
 
     std::vector<std::uint8_t> piece_map_;
     std::vector<std::size_t> file_offsets_;
+    // files with a piece layer that does not match their pieces root, their pieces are failed in start()
+    std::vector<std::size_t> untrusted_files_ {};
 
-    concurrent_queue_processor<v2_hashed_piece> processor_;
+    concurrent_queue_processor<v2_hashed_piece_batch> processor_;
 };
 
 }
\ No newline at end of file
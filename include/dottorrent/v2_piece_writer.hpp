@@ -5,7 +5,8 @@
 #include <mutex>
 #include <gsl-lite/gsl-lite.hpp>
 
-#include "dottorrent/merkle_tree.hpp"
+#include "dottorrent/streaming_merkle_tree.hpp"
+#include "dottorrent/hash_checkpoint.hpp"
 #include "dottorrent/file_storage.hpp"
 #include "dottorrent/hash_function.hpp"
 
@@ -44,16 +45,28 @@ public:
 
     bool done() const noexcept override;
 
+    void set_executor(std::shared_ptr<executor> executor) override;
+
+    void notify() override;
+
     std::shared_ptr<v1_piece_queue_type> get_v1_queue() override;
 
     std::shared_ptr<v2_piece_queue_type> get_v2_queue() override;
 
+    /// Add every finished piece of the piece layers, and of the v1 pieces for hybrid torrents, to a checkpoint.
+    /// @remark Not thread-safe, must be set before starting the writer.
+    void set_checkpoint(std::shared_ptr<hash_checkpoint> checkpoint);
+
+    /// Set the hash of a piece of a file that was hashed before, the leaves of the piece will not be published.
+    /// Completes the piece layer and root of the file when all its pieces are set.
+    /// @remark Not thread-safe, must be called before starting the writer.
+    void restore_piece(std::size_t file_index, std::size_t piece_index, const sha256_hash& hash);
+
 protected:
     void initialize_trees(const file_storage& storage);
 
 
-    template <typename HasherType>
-    void set_piece_layers_and_root(file_storage& storage, HasherType& hasher, std::size_t file_index);
+    void set_piece_layers_and_root(file_storage& storage, std::size_t file_index);
 
     void set_finished_piece(const v1_hashed_piece& finished_piece);
 
@@ -61,13 +74,14 @@ protected:
 
 private:
     std::reference_wrapper<file_storage> storage_;
-    std::vector<merkle_tree<hash_function::sha256>> merkle_trees_ {};
+    std::vector<streaming_merkle_tree> merkle_trees_ {};
     /// Vector with the count of 16 KiB blocks_hashed per file
     std::vector<std::atomic<std::size_t>> file_blocks_hashed_ {};
+    std::shared_ptr<hash_checkpoint> checkpoint_ {};
     bool add_v1_compatibility_ = false;
 
-    concurrent_queue_processor<v1_hashed_piece> v1_processor_;
-    concurrent_queue_processor<v2_hashed_piece> v2_processor_;
+    concurrent_queue_processor<v1_hashed_piece_batch> v1_processor_;
+    concurrent_queue_processor<v2_hashed_piece_batch> v2_processor_;
 };
 
 
@@ -0,0 +1,230 @@
+#include "dottorrent/checksum_hasher.hpp"
+
+#include <algorithm>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+namespace dottorrent {
+
+checksum_hasher::checksum_hasher(file_storage& storage, hash_function f, std::size_t capacity,
+                                 std::size_t thread_count, [[maybe_unused]] bool enable_multi_buffer_hashing)
+        : chunk_processor_base(storage, {f}, capacity, thread_count)
+        , enable_multi_buffer_hashing_(false)
+{
+#ifdef DOTTORRENT_USE_ISAL
+    enable_multi_buffer_hashing_ = enable_multi_buffer_hashing &&
+                                   isal_multi_buffer_hasher::supported_algorithms().contains(f);
+#endif
+}
+
+void checksum_hasher::start()
+{
+    slots_.resize(threads_.size());
+    chunk_processor_base::start();
+}
+
+void checksum_hasher::set_checkpoint(std::shared_ptr<hash_checkpoint> checkpoint)
+{
+    file_storage& storage = storage_;
+    checkpoint_ = std::move(checkpoint);
+    restored_files_.assign(storage.file_count(), false);
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        if (auto checksum = checkpoint_->get_checksum(i, hash_functions_.front())) {
+            storage[i].add_checksum(std::move(checksum));
+            restored_files_[i] = true;
+        }
+    }
+}
+
+void checksum_hasher::run(std::stop_token stop_token, int thread_idx)
+{
+    Expects(stop_token.stop_possible());
+    Expects(done_[thread_idx] == false);
+
+    auto& state = get_slot_state(thread_idx);
+
+    data_chunk item {};
+
+    // Process tasks until stopped is set
+    while (!stop_token.stop_requested() && stop_token.stop_possible()) {
+        queue_->pop(item);
+        // check if the data_chunk is valid or a stop wake-up signal
+        if (item.data == nullptr &&
+                item.piece_index == std::numeric_limits<std::uint32_t>::max() &&
+                item.file_index == std::numeric_limits<std::uint32_t>::max())
+        {
+            Ensures(stop_token.stop_requested());
+            break;
+        }
+
+        hash_chunk(state, item);
+        item.data.reset();
+    }
+
+    // finish pending tasks if the hasher is not cancelled,
+    // otherwise discard all remaining work
+    if (!cancelled_.load(std::memory_order_relaxed)) {
+        while (queue_->try_pop(item)) {
+            if (item.data == nullptr &&
+                    item.piece_index == std::numeric_limits<std::uint32_t>::max() &&
+                    item.file_index == std::numeric_limits<std::uint32_t>::max())
+            {
+                break;
+            }
+            hash_chunk(state, item);
+            item.data.reset();
+        }
+    }
+
+    done_[thread_idx] = true;
+}
+
+void checksum_hasher::drain(std::size_t slot)
+{
+    auto& state = get_slot_state(slot);
+    data_chunk item {};
+
+    for (std::size_t i = 0; i < max_items_per_task && queue_->try_pop(item); ++i) {
+        // discard remaining work when cancelled
+        if (!cancelled_.load(std::memory_order_relaxed)) {
+            hash_chunk(state, item);
+        }
+        item.data.reset();
+    }
+}
+
+void checksum_hasher::hash_chunk(slot_state& state, const data_chunk& chunk)
+{
+    // pieces of missing files
+    if (chunk.data == nullptr) return;
+
+    const file_storage& storage = storage_;
+
+    state.ranges.clear();
+    state.complete_files.clear();
+    split_chunk(chunk, state.ranges);
+
+    for (auto range : state.ranges) {
+        const auto file_size = storage[range.file_index].file_size();
+
+        if (!restored_files_.empty() && restored_files_[range.file_index]) continue;
+
+        // ignore data of files that grew after they were added to the storage
+        if (range.file_offset >= file_size && range.file_offset != 0) continue;
+        range.data = range.data.first(std::min(range.data.size(), file_size - range.file_offset));
+
+        if (state.mb_hasher && range.file_offset == 0 && range.data.size() == file_size) {
+            state.complete_files.push_back(range);
+        }
+        else {
+            hash_file_data(range, chunk.data);
+        }
+    }
+
+    for (std::size_t i = 0; i < state.complete_files.size(); i += multi_buffer_lanes) {
+        auto n = std::min(multi_buffer_lanes, state.complete_files.size() - i);
+        hash_complete_files(*state.mb_hasher, std::span(state.complete_files).subspan(i, n));
+    }
+}
+
+void checksum_hasher::hash_file_data(const file_data_range& range,
+                                     const std::shared_ptr<data_chunk::data_type>& buffer)
+{
+    const file_storage& storage = storage_;
+    const auto file_size = storage[range.file_index].file_size();
+
+    file_state& state = get_file_state(range.file_index);
+    std::unique_lock lck{state.mutex};
+    state.pending.emplace(range.file_offset, pending_range{buffer, range.data});
+
+    // the thread that is hashing this file will pick up the data
+    if (state.busy) return;
+    state.busy = true;
+
+    while (!state.pending.empty() && state.pending.begin()->first == state.next_offset) {
+        auto node = state.pending.extract(state.pending.begin());
+        lck.unlock();
+
+        auto data = node.mapped().data;
+        state.hasher->update(data);
+        bytes_hashed_.fetch_add(data.size(), std::memory_order_relaxed);
+        bytes_done_.fetch_add(data.size(), std::memory_order_relaxed);
+        // return the buffer to the reader before taking the lock
+        node.mapped().buffer.reset();
+
+        lck.lock();
+        state.next_offset += data.size();
+    }
+    state.busy = false;
+
+    if (state.next_offset != file_size) return;
+
+    Ensures(state.pending.empty());
+    lck.unlock();
+    // no other thread can receive data of this file anymore
+    finalize_file(range.file_index, *state.hasher);
+}
+
+void checksum_hasher::hash_complete_files(multi_buffer_hasher& hasher, std::span<const file_data_range> files)
+{
+    file_storage& storage = storage_;
+
+    if (hasher.job_count() < files.size()) {
+        hasher.resize(files.size());
+    }
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        hasher.submit(i, files[i].data);
+    }
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        auto checksum = make_checksum(hash_functions_.front());
+        hasher.finalize_to(i, checksum->value());
+        if (checkpoint_) {
+            checkpoint_->add_checksum(files[i].file_index, *checksum);
+        }
+        storage[files[i].file_index].add_checksum(std::move(checksum));
+
+        bytes_hashed_.fetch_add(files[i].data.size(), std::memory_order_relaxed);
+        bytes_done_.fetch_add(files[i].data.size(), std::memory_order_relaxed);
+    }
+}
+
+checksum_hasher::slot_state& checksum_hasher::get_slot_state(std::size_t slot)
+{
+    Expects(slot < slots_.size());
+    auto& state = slots_[slot];
+
+    if (enable_multi_buffer_hashing_ && !state.mb_hasher) {
+        state.mb_hasher = make_multi_buffer_hasher(hash_functions_.front());
+    }
+    return state;
+}
+
+checksum_hasher::file_state& checksum_hasher::get_file_state(std::size_t file_index)
+{
+    std::unique_lock lck{states_mutex_};
+    auto& state = states_[file_index];
+
+    if (!state) {
+        state = std::make_unique<file_state>();
+        state->hasher = make_hasher(hash_functions_.front());
+    }
+    return *state;
+}
+
+void checksum_hasher::finalize_file(std::size_t file_index, single_buffer_hasher& hasher)
+{
+    file_storage& storage = storage_;
+
+    auto checksum = make_checksum(hash_functions_.front());
+    hasher.finalize_to(checksum->value());
+    if (checkpoint_) {
+        checkpoint_->add_checksum(file_index, *checksum);
+    }
+    storage[file_index].add_checksum(std::move(checksum));
+
+    std::unique_lock lck{states_mutex_};
+    states_.erase(file_index);
+}
+
+} // namespace dottorrent
@@ -2,16 +2,18 @@
 
 namespace dottorrent {
 
+void chunk_hasher_single_buffer::start()
+{
+    slot_hashers_.resize(threads_.size());
+    chunk_processor_base::start();
+}
+
 void chunk_hasher_single_buffer::run(std::stop_token stop_token, int thread_idx)
 {
     Expects(stop_token.stop_possible());
     Expects(done_[thread_idx] == false);
 
-    // copy the global hasher object to a per-thread hasher
-    std::vector<std::unique_ptr<single_buffer_hasher>> hashers {};
-    for (const auto f : hash_functions_) {
-        hashers.push_back(std::move(make_hasher(f)));
-    }
+    auto& hashers = slot_hashers(thread_idx);
 
     data_chunk item {};
 
@@ -49,4 +51,31 @@ void chunk_hasher_single_buffer::run(std::stop_token stop_token, int thread_idx)
     done_[thread_idx] = true;
 }
 
+void chunk_hasher_single_buffer::drain(std::size_t slot)
+{
+    auto& hashers = slot_hashers(slot);
+    data_chunk item {};
+
+    for (std::size_t i = 0; i < max_items_per_task && queue_->try_pop(item); ++i) {
+        // discard remaining work when cancelled
+        if (!cancelled_.load(std::memory_order_relaxed)) {
+            hash_chunk(hashers, item);
+        }
+        item.data.reset();
+    }
+}
+
+std::vector<std::unique_ptr<single_buffer_hasher>>& chunk_hasher_single_buffer::slot_hashers(std::size_t slot)
+{
+    Expects(slot < slot_hashers_.size());
+    auto& hashers = slot_hashers_[slot];
+
+    if (hashers.empty()) {
+        for (const auto f : hash_functions_) {
+            hashers.push_back(make_hasher(f));
+        }
+    }
+    return hashers;
+}
+
 } // namespace dottorrent
\ No newline at end of file
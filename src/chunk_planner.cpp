@@ -0,0 +1,185 @@
+#include "dottorrent/chunk_planner.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace dottorrent {
+
+chunk_planner::chunk_planner(file_storage& storage, protocol protocol_version, std::size_t chunk_size)
+        : storage_(storage)
+        , file_paths_(absolute_file_paths(storage))
+        , file_exists_(storage.file_count(), false)
+        , v1_layout_(protocol_version == protocol::v1)
+        , chunk_size_(chunk_size)
+        , piece_size_(storage.piece_size())
+{
+    Expects(piece_size_ > 0);
+    Expects(chunk_size_ % piece_size_ == 0);
+}
+
+std::optional<chunk_descriptor> chunk_planner::next()
+{
+    const auto file_count = storage_.get().file_count();
+
+    while (ready_.empty()) {
+        if (file_index_ == file_count) {
+            // last possibly partial chunk
+            if (v1_layout_ && chunk_offset_ != 0) {
+                emit_current(chunk_offset_);
+                continue;
+            }
+            return std::nullopt;
+        }
+        if (v1_layout_) {
+            plan_next_file_v1();
+        }
+        else {
+            plan_next_file_v2();
+        }
+    }
+
+    auto chunk = std::move(ready_.front());
+    ready_.pop_front();
+    return chunk;
+}
+
+std::size_t chunk_planner::take_skipped_bytes() noexcept
+{
+    return std::exchange(skipped_bytes_, 0);
+}
+
+bool chunk_planner::file_exists(std::size_t file_index) const noexcept
+{
+    Expects(file_index < file_exists_.size());
+    return file_exists_[file_index];
+}
+
+void chunk_planner::plan_next_file_v1()
+{
+    const file_entry& entry = storage_.get().at(file_index_);
+
+    // handle pieces if the file does not exists. Used when verifying torrents.
+    if (entry.is_padding_file() || !check_file(file_index_)) [[unlikely]] {
+        plan_missing_file_v1(entry.file_size());
+        ++file_index_;
+        return;
+    }
+
+    const auto file_size = entry.file_size();
+    std::size_t file_offset = 0;
+
+    while (file_offset < file_size) {
+        auto n = std::min(chunk_size_ - chunk_offset_, file_size - file_offset);
+        add_segment({static_cast<std::uint32_t>(file_index_), file_offset, chunk_offset_, n});
+        file_offset += n;
+
+        if (chunk_offset_ == chunk_size_) [[likely]] {
+            emit_current(chunk_size_);
+        }
+    }
+    ++file_index_;
+}
+
+void chunk_planner::plan_missing_file_v1(std::size_t file_size)
+{
+    const auto file_index = static_cast<std::uint32_t>(file_index_);
+    std::size_t missing_size = file_size;
+
+    // fill the remaining data of the current chunk with zero bytes
+    if (chunk_offset_ != 0) {
+        auto bytes_to_fill = std::min(chunk_size_ - chunk_offset_, missing_size);
+        add_segment({file_index, 0, chunk_offset_, bytes_to_fill, true});
+        missing_size -= bytes_to_fill;
+
+        if (chunk_offset_ == chunk_size_) {
+            emit_current(chunk_size_);
+        }
+    }
+
+    // pieces that only contain data of the missing file are published without data
+    auto first_new_piece_index = piece_index_ + missing_size / piece_size_;
+    missing_size -= piece_size_ * (first_new_piece_index - piece_index_);
+
+    for (; piece_index_ < first_new_piece_index; ++piece_index_) {
+        ready_.push_back({static_cast<std::uint32_t>(piece_index_), file_index, piece_size_, false});
+    }
+
+    // the remaining bytes are the start of a new chunk
+    if (missing_size != 0) {
+        add_segment({file_index, file_size - missing_size, chunk_offset_, missing_size, true});
+    }
+}
+
+void chunk_planner::plan_next_file_v2()
+{
+    const file_entry& entry = storage_.get().at(file_index_);
+    const auto file_index = static_cast<std::uint32_t>(file_index_);
+    const auto file_size = entry.file_size();
+    ++file_index_;
+
+    if (entry.is_padding_file()) {
+        skipped_bytes_ += file_size;
+        return;
+    }
+
+    // handle pieces if the file does not exists. Used when verifying torrents.
+    if (!check_file(file_index)) {
+        ready_.push_back({0, file_index, file_size, false});
+        skipped_bytes_ += file_size;
+        return;
+    }
+
+    // empty files are published as a single chunk without bytes
+    if (file_size == 0) {
+        ready_.push_back({0, file_index, 0, true});
+        return;
+    }
+
+    // piece index is per file for v2!
+    for (std::size_t file_offset = 0; file_offset < file_size; file_offset += chunk_size_) {
+        auto n = std::min(chunk_size_, file_size - file_offset);
+        ready_.push_back({
+                static_cast<std::uint32_t>(file_offset / piece_size_),
+                file_index,
+                n,
+                true,
+                {{file_index, file_offset, 0, n}}
+        });
+    }
+}
+
+void chunk_planner::add_segment(const chunk_segment& segment)
+{
+    if (current_.segments.empty()) {
+        current_.file_index = segment.file_index;
+    }
+    current_.segments.push_back(segment);
+    chunk_offset_ += segment.size;
+}
+
+void chunk_planner::emit_current(std::size_t size)
+{
+    current_.piece_index = static_cast<std::uint32_t>(piece_index_);
+    current_.size = size;
+    current_.has_data = true;
+    ready_.push_back(std::move(current_));
+
+    piece_index_ += (size + piece_size_ - 1) / piece_size_;
+    chunk_offset_ = 0;
+    current_ = {};
+}
+
+bool chunk_planner::check_file(std::size_t file_index)
+{
+    const auto& path = file_paths_[file_index];
+    bool exists = fs::exists(path);
+    file_exists_[file_index] = exists;
+
+    if (exists) {
+        // set last modified date in the file entry of the storage
+        storage_.get().set_last_modified_time(file_index, fs::last_write_time(path));
+    }
+    return exists;
+}
+
+} // namespace dottorrent
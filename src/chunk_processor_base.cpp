@@ -17,6 +17,17 @@ void chunk_processor_base::start() {
     Ensures(!started());
     Ensures(!cancelled());
 
+    if (executor_) {
+        for (auto& d : done_) { d = false; }
+        runner_ = std::make_unique<bounded_task_runner>(
+                executor_, threads_.size(),
+                [this]() { return queue_->size() != 0; },
+                [this](std::size_t slot) { drain(slot); });
+        started_.store(true, std::memory_order_release);
+        runner_->schedule();
+        return;
+    }
+
     for (std::size_t i = 0; i < threads_.size(); ++i) {
         done_[i] = false;
         threads_[i] = std::jthread([=, this](std::stop_token st) { run(std::move(st), i); });
@@ -36,7 +47,29 @@ void chunk_processor_base::request_cancellation() {
 void chunk_processor_base::wait() {
     if (!started()) return;
 
-    for (auto i = 0; i < threads_.size(); ++i) {
+    // producers are finished, complete the remaining work
+    if (runner_) {
+        runner_->wait_idle();
+        for (auto& d : done_) { d = true; }
+        return;
+    }
+
+    // cancelled workers leave the remaining work in the queue and can exit without taking a stop signal,
+    // discard the work so that the stop signals for the workers blocked on an empty queue do not block on a full queue
+    if (cancelled()) {
+        data_chunk item {};
+        while (!std::all_of(done_.begin(), done_.end(), [](auto& b) { return b.load(std::memory_order_relaxed); })) {
+            while (queue_->try_pop(item)) {}
+            queue_->try_push({
+                    std::numeric_limits<std::uint32_t>::max(),
+                    std::numeric_limits<std::uint32_t>::max(),
+                    nullptr
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    for (auto i = 0; !cancelled() && i < threads_.size(); ++i) {
         queue_->push({
                 std::numeric_limits<std::uint32_t>::max(),
                 std::numeric_limits<std::uint32_t>::max(),
@@ -97,6 +130,36 @@ void chunk_processor_base::register_v1_hashed_piece_queue(const std::shared_ptr<
 void chunk_processor_base::register_v2_hashed_piece_queue(const std::shared_ptr<v2_hashed_piece_queue>& queue)
 { v2_hashed_piece_queue_ = queue; }
 
+void chunk_processor_base::publish(v1_hashed_piece_batch&& batch)
+{
+    if (batch.empty()) return;
+    Expects(v1_hashed_piece_queue_);
+    v1_hashed_piece_queue_->push(std::move(batch));
+    if (publish_callback_) publish_callback_();
+}
+
+void chunk_processor_base::publish(v2_hashed_piece_batch&& batch)
+{
+    if (batch.empty()) return;
+    Expects(v2_hashed_piece_queue_);
+    v2_hashed_piece_queue_->push(std::move(batch));
+    if (publish_callback_) publish_callback_();
+}
+
+void chunk_processor_base::register_publish_callback(std::function<void()> callback)
+{ publish_callback_ = std::move(callback); }
+
+void chunk_processor_base::set_executor(std::shared_ptr<executor> executor)
+{
+    Expects(!started());
+    executor_ = std::move(executor);
+}
+
+void chunk_processor_base::notify()
+{
+    if (runner_) runner_->schedule();
+}
+
 chunk_processor_base::~chunk_processor_base()
 {
     if (started() && !done()) {
@@ -7,6 +7,7 @@ namespace dottorrent {
 chunk_reader::chunk_reader(file_storage& storage, std::size_t block_size, std::size_t capacity)
         : storage_(storage)
         , chunk_size_(block_size)
+        , capacity_(capacity)
         , pool_(capacity)
 {
     Expects(storage.piece_size() >= 16_KiB);
@@ -25,6 +26,24 @@ void chunk_reader::register_checksum_queue(std::shared_ptr<checksum_queue> q)
     checksum_queues_.push_back(std::move(q));
 }
 
+void chunk_reader::register_push_callback(std::function<void()> callback)
+{
+    push_callbacks_.push_back(std::move(callback));
+}
+
+void chunk_reader::push(const data_chunk& chunk)
+{
+    for (auto& queue : hash_queues_) {
+        queue->push(chunk);
+    }
+    for (auto& queue : checksum_queues_) {
+        queue->push(chunk);
+    }
+    for (auto& callback : push_callbacks_) {
+        callback();
+    }
+}
+
 void chunk_reader::start() {
     if (started()) return;
 
@@ -61,6 +80,19 @@ bool chunk_reader::cancelled() const noexcept
     return cancelled_.load(std::memory_order_acquire);
 }
 
+const fs::path* chunk_reader::next_file_path(const std::vector<fs::path>& file_paths,
+                                             std::size_t file_index) const
+{
+    const file_storage& storage = storage_;
+
+    for (++file_index; file_index < file_paths.size(); ++file_index) {
+        if (!storage[file_index].is_padding_file()) {
+            return &file_paths[file_index];
+        }
+    }
+    return nullptr;
+}
+
 std::size_t chunk_reader::bytes_read() const noexcept
 {
     return bytes_read_.load(std::memory_order_relaxed);
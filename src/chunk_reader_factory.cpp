@@ -0,0 +1,58 @@
+#include "dottorrent/chunk_reader_factory.hpp"
+
+#include <stdexcept>
+
+#include "dottorrent/v1_chunk_reader.hpp"
+#include "dottorrent/v2_chunk_reader.hpp"
+#include "dottorrent/direct_chunk_reader.hpp"
+#include "dottorrent/io_uring_chunk_reader.hpp"
+#include "dottorrent/mmap_chunk_reader.hpp"
+#include "dottorrent/parallel_chunk_reader.hpp"
+
+namespace dottorrent {
+
+std::unique_ptr<chunk_reader> make_chunk_reader(
+        file_storage& storage,
+        protocol protocol_version,
+        std::size_t block_size,
+        std::size_t capacity,
+        const chunk_reader_options& options)
+{
+    switch (options.type) {
+    case reader_type::sequential: {
+        if (protocol_version == protocol::v1) {
+            return std::make_unique<v1_chunk_reader>(storage, block_size, capacity);
+        }
+        return std::make_unique<v2_chunk_reader>(storage, block_size, capacity);
+    }
+    case reader_type::io_uring: {
+#ifdef DOTTORRENT_USE_IO_URING
+        return std::make_unique<io_uring_chunk_reader>(
+                storage, protocol_version, block_size, capacity, options.queue_depth);
+#else
+        throw std::invalid_argument("io_uring reader is not supported on this platform");
+#endif
+    }
+    case reader_type::parallel: {
+        return std::make_unique<parallel_chunk_reader>(
+                storage, protocol_version, block_size, capacity, options.threads);
+    }
+    case reader_type::mmap: {
+#ifdef DOTTORRENT_USE_MMAP
+        return std::make_unique<mmap_chunk_reader>(storage, protocol_version, block_size, capacity);
+#else
+        throw std::invalid_argument("mmap reader is not supported on this platform");
+#endif
+    }
+    case reader_type::direct: {
+#ifdef DOTTORRENT_USE_DIRECT_IO
+        return std::make_unique<direct_chunk_reader>(storage, protocol_version, block_size, capacity);
+#else
+        throw std::invalid_argument("direct I/O reader is not supported on this platform");
+#endif
+    }
+    }
+    throw std::invalid_argument("unrecognised reader type");
+}
+
+} // namespace dottorrent
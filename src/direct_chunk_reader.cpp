@@ -0,0 +1,183 @@
+#include "dottorrent/direct_chunk_reader.hpp"
+
+#ifdef DOTTORRENT_USE_DIRECT_IO
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace dottorrent {
+
+namespace {
+
+constexpr std::size_t align_down(std::size_t value) noexcept
+{
+    return value & ~(direct_chunk_reader::alignment - 1);
+}
+
+constexpr std::size_t align_up(std::size_t value) noexcept
+{
+    return align_down(value + direct_chunk_reader::alignment - 1);
+}
+
+/// File opened for unbuffered reading.
+class direct_file
+{
+public:
+    direct_file() = default;
+
+    direct_file(const direct_file&) = delete;
+    direct_file& operator=(const direct_file&) = delete;
+
+    ~direct_file()
+    { close(); }
+
+    void open(const fs::path& path)
+    {
+        close();
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+        direct_ = fd_ >= 0;
+
+        // the file system does not support O_DIRECT
+        if (fd_ < 0 && errno == EINVAL) {
+            fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::system_category(), "open");
+        }
+        if (!direct_) {
+            ::posix_fadvise(fd_, 0, 0, POSIX_FADV_NOREUSE);
+        }
+    }
+
+    void close() noexcept
+    {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    /// Read `size` bytes starting at `offset` into `out`.
+    /// `out`, `size` and `offset` must be aligned to direct_chunk_reader::alignment.
+    /// @returns the number of bytes read, less than `size` only when the end of the file is reached.
+    std::size_t read(std::byte* out, std::size_t size, std::size_t offset)
+    {
+        std::size_t bytes_done = 0;
+
+        while (bytes_done < size) {
+            auto ret = ::pread(fd_, out + bytes_done, size - bytes_done,
+                               static_cast<off_t>(offset + bytes_done));
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::system_category(), "pread");
+            }
+            if (ret == 0) break;
+            bytes_done += static_cast<std::size_t>(ret);
+
+            // a short read that is not block aligned only happens at the end of the file
+            if (bytes_done % direct_chunk_reader::alignment != 0) break;
+        }
+
+        // data read without O_DIRECT should not stay in the page cache
+        if (!direct_ && bytes_done != 0) {
+            ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(bytes_done), POSIX_FADV_DONTNEED);
+        }
+        return bytes_done;
+    }
+
+private:
+    int fd_ = -1;
+    bool direct_ = false;
+};
+
+} // namespace
+
+
+direct_chunk_reader::direct_chunk_reader(file_storage& storage,
+                                         protocol protocol_version,
+                                         std::size_t block_size,
+                                         std::size_t capacity)
+        : chunk_reader(storage, block_size, capacity)
+        , protocol_(protocol_version)
+{
+    Expects(chunk_size_ % alignment == 0);
+}
+
+void direct_chunk_reader::run()
+{
+    file_storage& storage = storage_;
+    const auto file_paths = absolute_file_paths(storage);
+    chunk_planner planner(storage, protocol_, chunk_size_);
+
+    direct_file file {};
+    std::uint32_t open_file_index = std::numeric_limits<std::uint32_t>::max();
+
+    // unaligned segments are read in the bounce buffer and copied to the chunk
+    data_type bounce_buffer {};
+    bounce_buffer.resize(chunk_size_ + alignment, alignment);
+
+    auto read_segment = [&](data_type& chunk, const chunk_segment& segment) {
+        if (segment.file_index != open_file_index) {
+            open_file_index = std::numeric_limits<std::uint32_t>::max();
+            file.open(file_paths[segment.file_index]);
+            open_file_index = segment.file_index;
+        }
+
+        const auto offset = align_down(segment.file_offset);
+        const auto lead = segment.file_offset - offset;
+        const auto length = align_up(lead + segment.size);
+        auto* out = std::next(chunk.data(), segment.chunk_offset);
+
+        // Reading in place may overwrite the bytes after the segment up to the next block boundary.
+        // These belong to the next segment, which is read later, or to the padding of the buffer.
+        const bool in_place = lead == 0 && segment.chunk_offset % alignment == 0;
+        auto* target = in_place ? out : bounce_buffer.data();
+
+        if (file.read(target, length, offset) < lead + segment.size) {
+            throw std::runtime_error("unexpected end of file");
+        }
+        if (!in_place) {
+            std::memcpy(out, std::next(bounce_buffer.data(), lead), segment.size);
+        }
+        bytes_read_.fetch_add(segment.size, std::memory_order_relaxed);
+    };
+
+    while (!cancelled_.load(std::memory_order_relaxed)) {
+        auto descriptor = planner.next();
+        bytes_read_.fetch_add(planner.take_skipped_bytes(), std::memory_order_relaxed);
+        if (!descriptor) break;
+
+        if (!descriptor->has_data) {
+            push({descriptor->piece_index, descriptor->file_index, nullptr});
+            continue;
+        }
+
+        auto data = pool_.get();
+        data->resize(descriptor->size, alignment);
+
+        for (const auto& segment : descriptor->segments) {
+            if (segment.zero_fill) {
+                std::fill_n(std::next(data->data(), segment.chunk_offset), segment.size, std::byte(0));
+                continue;
+            }
+            try {
+                read_segment(*data, segment);
+            }
+            catch (const std::exception& err) {
+                throw std::runtime_error(fmt::format("I/O error reading: {}: {}",
+                        storage[segment.file_index].path().string(), err.what()));
+            }
+        }
+
+        push({descriptor->piece_index, descriptor->file_index, std::move(data)});
+    }
+}
+
+} // namespace dottorrent
+
+#endif
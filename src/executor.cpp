@@ -0,0 +1,190 @@
+#include "dottorrent/executor.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+namespace dottorrent {
+
+namespace {
+
+/// Executor and worker index of the calling thread, nullptr for threads that are not a worker.
+thread_local const executor* current_executor = nullptr;
+thread_local std::size_t current_worker_index = 0;
+
+/// A worker checks the injection queue before its own queue once every `injection_interval` tasks,
+/// so that tasks submitted by other threads are not starved by tasks that resubmit themselves.
+constexpr std::size_t injection_interval = 16;
+
+} // namespace
+
+
+executor::executor(std::size_t thread_count)
+{
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<task_queue>());
+    }
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this, i](std::stop_token st) { run(std::move(st), i); });
+    }
+}
+
+executor::~executor()
+{
+    for (auto& w : workers_) {
+        w.request_stop();
+    }
+    {
+        std::unique_lock lck{park_mutex_};
+        park_cv_.notify_all();
+    }
+    workers_.clear();
+}
+
+void executor::submit(task_type task)
+{
+    task_queue& queue = (current_executor == this) ? *queues_[current_worker_index] : injection_queue_;
+    {
+        std::unique_lock lck{queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+    pending_.fetch_add(1, std::memory_order_seq_cst);
+
+    if (parked_.load(std::memory_order_seq_cst) != 0) {
+        std::unique_lock lck{park_mutex_};
+        park_cv_.notify_one();
+    }
+}
+
+void executor::run(std::stop_token stop_token, std::size_t index)
+{
+    current_executor = this;
+    current_worker_index = index;
+
+    task_type task {};
+    std::size_t tick = 0;
+
+    while (!stop_token.stop_requested()) {
+        if (try_take(index, tick++, task)) {
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lck{park_mutex_};
+        parked_.fetch_add(1, std::memory_order_seq_cst);
+        park_cv_.wait(lck, stop_token, [this] { return pending_.load(std::memory_order_seq_cst) != 0; });
+        parked_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+bool executor::try_take(std::size_t index, std::size_t tick, task_type& task)
+{
+    if (tick % injection_interval == 0 && try_pop_front(injection_queue_, task)) {
+        return true;
+    }
+    // newest local task first, its data is most likely still in cache
+    if (try_pop_back(*queues_[index], task)) {
+        return true;
+    }
+    if (try_pop_front(injection_queue_, task)) {
+        return true;
+    }
+    // steal the oldest task of another worker
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+        if (try_pop_front(*queues_[(index + i) % queues_.size()], task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool executor::try_pop_front(task_queue& queue, task_type& task)
+{
+    std::unique_lock lck{queue.mutex};
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool executor::try_pop_back(task_queue& queue, task_type& task)
+{
+    std::unique_lock lck{queue.mutex};
+    if (queue.tasks.empty()) return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+
+bounded_task_runner::bounded_task_runner(std::shared_ptr<executor> executor,
+                                         std::size_t concurrency,
+                                         has_work_function has_work,
+                                         drain_function drain)
+        : executor_(std::move(executor))
+        , has_work_(std::move(has_work))
+        , drain_(std::move(drain))
+{
+    Expects(executor_);
+    Expects(concurrency > 0);
+
+    // hand out low slot indices first
+    for (std::size_t i = concurrency; i > 0; --i) {
+        free_slots_.push_back(i - 1);
+    }
+}
+
+void bounded_task_runner::schedule()
+{
+    std::size_t slot;
+    {
+        std::unique_lock lck{mutex_};
+        if (free_slots_.empty() || !has_work_()) return;
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        ++active_;
+    }
+    executor_->submit([this, slot] { run(slot); });
+}
+
+void bounded_task_runner::run(std::size_t slot)
+{
+    drain_(slot);
+    {
+        std::unique_lock lck{mutex_};
+        // Keep the slot when items were pushed after the drain function returned.
+        // The slot is released while holding the lock, so a producer
+        // that does not find a free slot will have its items picked up here.
+        if (!has_work_()) {
+            free_slots_.push_back(slot);
+            if (--active_ == 0) {
+                idle_cv_.notify_all();
+            }
+            return;
+        }
+    }
+    executor_->submit([this, slot] { run(slot); });
+}
+
+void bounded_task_runner::wait_idle()
+{
+    // producers schedule a task after every push, the last active task signals when the work is done
+    std::unique_lock lck{mutex_};
+    idle_cv_.wait(lck, [this] { return active_ == 0 && !has_work_(); });
+}
+
+bounded_task_runner::~bounded_task_runner()
+{
+    // tasks reference this object
+    std::unique_lock lck{mutex_};
+    idle_cv_.wait(lck, [this] { return active_ == 0; });
+}
+
+} // namespace dottorrent
@@ -0,0 +1,98 @@
+#include "dottorrent/file_readahead.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef DOTTORRENT_USE_FADVISE
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace dottorrent {
+
+namespace {
+
+int open_for_advice([[maybe_unused]] const fs::path& path) noexcept
+{
+#ifdef DOTTORRENT_USE_FADVISE
+    return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#else
+    return -1;
+#endif
+}
+
+void close_for_advice(int& fd) noexcept
+{
+#ifdef DOTTORRENT_USE_FADVISE
+    if (fd >= 0) ::close(fd);
+#endif
+    fd = -1;
+}
+
+void will_need([[maybe_unused]] int fd, [[maybe_unused]] std::size_t offset, [[maybe_unused]] std::size_t size) noexcept
+{
+#ifdef DOTTORRENT_USE_FADVISE
+    if (fd >= 0) {
+        ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
+} // namespace
+
+
+file_readahead::file_readahead(std::size_t window_size)
+        : window_size_(window_size)
+{
+    Expects(window_size_ > 0);
+}
+
+file_readahead::~file_readahead()
+{
+    close();
+    close_for_advice(next_fd_);
+}
+
+void file_readahead::open(const fs::path& path, std::size_t file_size, const fs::path* next_path)
+{
+    close();
+    file_size_ = file_size;
+    prefetched_until_ = 0;
+
+    // the first window was already requested when this file was prefetched
+    if (next_prefetched_ && next_fd_ >= 0 && next_path_ == path) {
+        fd_ = std::exchange(next_fd_, -1);
+        prefetched_until_ = std::min(window_size_, file_size_);
+    }
+    else {
+        close_for_advice(next_fd_);
+        fd_ = open_for_advice(path);
+    }
+
+    next_path_ = next_path ? *next_path : fs::path{};
+    next_prefetched_ = false;
+    advance(0);
+}
+
+void file_readahead::advance(std::size_t offset)
+{
+    // extend the requested range when less than half a window is left ahead of the read position
+    if (prefetched_until_ < file_size_ && offset + window_size_ / 2 > prefetched_until_) {
+        auto end = std::min(file_size_, offset + window_size_);
+        will_need(fd_, prefetched_until_, end - prefetched_until_);
+        prefetched_until_ = end;
+    }
+
+    if (!next_prefetched_ && !next_path_.empty() && file_size_ - std::min(offset, file_size_) <= window_size_) {
+        next_fd_ = open_for_advice(next_path_);
+        will_need(next_fd_, 0, window_size_);
+        next_prefetched_ = true;
+    }
+}
+
+void file_readahead::close() noexcept
+{
+    close_for_advice(fd_);
+}
+
+} // namespace dottorrent
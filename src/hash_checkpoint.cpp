@@ -0,0 +1,536 @@
+#include "dottorrent/hash_checkpoint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <string>
+
+#include <fmt/format.h>
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "dottorrent/utils.hpp"
+
+namespace dottorrent {
+
+namespace {
+
+constexpr std::array<char, 8> checkpoint_magic = {'D', 'T', 'C', 'K', 'P', 'T', '0', '1'};
+
+/// Little-endian serialization of the checkpoint fields.
+class checkpoint_writer
+{
+public:
+    void write_u64(std::uint64_t value)
+    {
+        for (std::size_t i = 0; i < 8; ++i) {
+            buffer_.push_back(static_cast<char>(value >> (8 * i)));
+        }
+    }
+
+    void write_bytes(std::span<const std::byte> bytes)
+    {
+        std::ranges::transform(bytes, std::back_inserter(buffer_), [](std::byte b) { return static_cast<char>(b); });
+    }
+
+    void write_string(std::string_view s)
+    {
+        write_u64(s.size());
+        buffer_.append(s);
+    }
+
+    const std::string& buffer() const noexcept
+    { return buffer_; }
+
+private:
+    std::string buffer_ {};
+};
+
+class checkpoint_reader
+{
+public:
+    explicit checkpoint_reader(std::string buffer)
+            : buffer_(std::move(buffer))
+    {}
+
+    std::uint64_t read_u64()
+    {
+        const auto bytes = take(8);
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i < 8; ++i) {
+            value |= std::uint64_t(static_cast<unsigned char>(bytes[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    void read_bytes(std::span<std::byte> out)
+    {
+        const auto bytes = take(out.size());
+        std::ranges::transform(bytes, out.begin(), [](char c) { return static_cast<std::byte>(c); });
+    }
+
+    std::string_view read_string()
+    {
+        return take(read_u64());
+    }
+
+    bool at_end() const noexcept
+    { return offset_ == buffer_.size(); }
+
+private:
+    std::string_view take(std::size_t n)
+    {
+        if (buffer_.size() - offset_ < n) {
+            throw std::runtime_error("truncated checkpoint file");
+        }
+        auto result = std::string_view(buffer_).substr(offset_, n);
+        offset_ += n;
+        return result;
+    }
+
+    std::string buffer_;
+    std::size_t offset_ = 0;
+};
+
+std::int64_t to_ticks(fs::file_time_type time)
+{
+    return static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+std::int64_t last_write_ticks(const fs::path& path)
+{
+    std::error_code ec {};
+    auto time = fs::last_write_time(path, ec);
+    if (ec) {
+        return 0;
+    }
+    return to_ticks(time);
+}
+
+constexpr auto padding_segment = std::numeric_limits<std::size_t>::max();
+
+/// Bytes of a file in a v1 piece, consecutive padding files are a single segment of zeros.
+struct piece_segment
+{
+    std::size_t file_index;
+    std::size_t file_offset;
+    std::size_t size;
+};
+
+std::vector<std::size_t> file_offsets(const file_storage& storage)
+{
+    std::vector<std::size_t> offsets {};
+    offsets.reserve(storage.file_count());
+    std::size_t offset = 0;
+    for (const auto& entry : storage) {
+        offsets.push_back(offset);
+        offset += entry.file_size();
+    }
+    return offsets;
+}
+
+std::vector<piece_segment> piece_segments(const file_storage& storage,
+                                          const std::vector<std::size_t>& offsets,
+                                          std::size_t piece_index)
+{
+    const auto first_byte = piece_index * storage.piece_size();
+    const auto last_byte = std::min(first_byte + storage.piece_size(), storage.total_file_size());
+    std::vector<piece_segment> segments {};
+
+    // last file that starts before the piece, empty files are skipped below
+    auto it = std::upper_bound(offsets.begin(), offsets.end(), first_byte);
+    for (auto i = std::size_t(std::distance(offsets.begin(), it)) - 1;
+         i < storage.file_count() && offsets[i] < last_byte; ++i) {
+        const auto& entry = storage[i];
+        const auto begin = std::max(first_byte, offsets[i]);
+        const auto end = std::min(last_byte, offsets[i] + entry.file_size());
+        if (begin >= end) continue;
+
+        if (!entry.is_padding_file()) {
+            segments.push_back({i, begin - offsets[i], end - begin});
+        }
+        else if (!segments.empty() && segments.back().file_index == padding_segment) {
+            segments.back().size += end - begin;
+        }
+        else {
+            segments.push_back({padding_segment, 0, end - begin});
+        }
+    }
+    return segments;
+}
+
+} // namespace
+
+
+hash_checkpoint::hash_checkpoint(const file_storage& storage, protocol protocol_version)
+        : protocol_(protocol_version)
+        , piece_size_(storage.piece_size())
+{
+    Expects(piece_size_ > 0);
+    const auto file_paths = absolute_file_paths(storage);
+
+    std::size_t v1_offset = 0;
+    std::size_t v2_offset = 0;
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage[i];
+        file_sizes_.push_back(entry.file_size());
+        file_mtimes_.push_back(entry.is_padding_file() ? 0 : last_write_ticks(file_paths[i]));
+
+        v1_file_offsets_.push_back(v1_offset);
+        v1_offset += entry.file_size();
+        v2_file_offsets_.push_back(v2_offset);
+        v2_offset += v2_piece_count(i);
+    }
+
+    if (protocol_ == protocol::v1 || protocol_ == protocol::hybrid) {
+        v1_pieces_.resize(storage.piece_count());
+        v1_done_.resize(storage.piece_count(), false);
+    }
+    if (protocol_ == protocol::v2 || protocol_ == protocol::hybrid) {
+        v2_pieces_.resize(v2_offset);
+        v2_done_.resize(v2_offset, false);
+    }
+    checksums_.resize(storage.file_count());
+}
+
+void hash_checkpoint::load(const fs::path& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        throw std::runtime_error(fmt::format("could not open checkpoint file: {}", path.string()));
+    }
+    auto reader = checkpoint_reader(std::string(std::istreambuf_iterator<char>(f), {}));
+
+    std::array<char, checkpoint_magic.size()> magic {};
+    reader.read_bytes(std::as_writable_bytes(std::span(magic)));
+    if (magic != checkpoint_magic) {
+        throw std::runtime_error(fmt::format("not a checkpoint file: {}", path.string()));
+    }
+
+    const auto protocol_version = static_cast<protocol>(reader.read_u64());
+    const auto piece_size = reader.read_u64();
+    const auto file_count = reader.read_u64();
+    if (protocol_version != protocol_ || piece_size != piece_size_ || file_count != file_sizes_.size()) {
+        throw std::invalid_argument("checkpoint was created for a different protocol, piece size or file list");
+    }
+
+    std::vector<bool> changed(file_count, false);
+    for (std::size_t i = 0; i < file_count; ++i) {
+        const auto size = reader.read_u64();
+        const auto mtime = static_cast<std::int64_t>(reader.read_u64());
+        if (size != file_sizes_[i]) {
+            throw std::invalid_argument("checkpoint was created for a different protocol, piece size or file list");
+        }
+        changed[i] = (mtime != file_mtimes_[i]);
+    }
+
+    std::unique_lock lck{mutex_};
+
+    for (auto n = reader.read_u64(); n > 0; --n) {
+        const auto index = reader.read_u64();
+        sha1_hash hash {};
+        reader.read_bytes(hash);
+        if (index >= v1_pieces_.size()) {
+            throw std::runtime_error("invalid piece index in checkpoint file");
+        }
+        v1_pieces_[index] = hash;
+        v1_done_[index] = true;
+    }
+
+    for (auto n = reader.read_u64(); n > 0; --n) {
+        const auto file_index = reader.read_u64();
+        const auto piece_index = reader.read_u64();
+        sha256_hash hash {};
+        reader.read_bytes(hash);
+        if (file_index >= file_count || piece_index >= v2_piece_count(file_index) || v2_pieces_.empty()) {
+            throw std::runtime_error("invalid piece index in checkpoint file");
+        }
+        v2_pieces_[v2_file_offsets_[file_index] + piece_index] = hash;
+        v2_done_[v2_file_offsets_[file_index] + piece_index] = true;
+    }
+
+    for (auto n = reader.read_u64(); n > 0; --n) {
+        const auto file_index = reader.read_u64();
+        const auto name = reader.read_string();
+        const auto value = reader.read_string();
+        if (file_index >= file_count) {
+            throw std::runtime_error("invalid file index in checkpoint file");
+        }
+        checksums_[file_index].push_back(make_checksum(name, std::as_bytes(std::span(value))));
+    }
+
+    if (!reader.at_end()) {
+        throw std::runtime_error(fmt::format("not a checkpoint file: {}", path.string()));
+    }
+
+    for (std::size_t i = 0; i < file_count; ++i) {
+        if (changed[i]) {
+            discard_file(i);
+        }
+    }
+}
+
+void hash_checkpoint::save(const fs::path& path) const
+{
+    checkpoint_writer writer {};
+    writer.write_bytes(std::as_bytes(std::span(checkpoint_magic)));
+    writer.write_u64(static_cast<std::uint64_t>(protocol_));
+    writer.write_u64(piece_size_);
+    writer.write_u64(file_sizes_.size());
+    for (std::size_t i = 0; i < file_sizes_.size(); ++i) {
+        writer.write_u64(file_sizes_[i]);
+        writer.write_u64(static_cast<std::uint64_t>(file_mtimes_[i]));
+    }
+
+    {
+        std::unique_lock lck{mutex_};
+
+        writer.write_u64(std::count(v1_done_.begin(), v1_done_.end(), true));
+        for (std::size_t i = 0; i < v1_done_.size(); ++i) {
+            if (!v1_done_[i]) continue;
+            writer.write_u64(i);
+            writer.write_bytes(v1_pieces_[i]);
+        }
+
+        writer.write_u64(std::count(v2_done_.begin(), v2_done_.end(), true));
+        for (std::size_t file_index = 0; file_index < file_sizes_.size() && !v2_done_.empty(); ++file_index) {
+            const auto first = v2_file_offsets_[file_index];
+            for (std::size_t i = 0; i < v2_piece_count(file_index); ++i) {
+                if (!v2_done_[first + i]) continue;
+                writer.write_u64(file_index);
+                writer.write_u64(i);
+                writer.write_bytes(v2_pieces_[first + i]);
+            }
+        }
+
+        std::size_t checksum_count = 0;
+        for (const auto& checksums : checksums_) {
+            checksum_count += checksums.size();
+        }
+        writer.write_u64(checksum_count);
+        for (std::size_t file_index = 0; file_index < checksums_.size(); ++file_index) {
+            for (const auto& c : checksums_[file_index]) {
+                writer.write_u64(file_index);
+                writer.write_string(c->name());
+                const auto value = c->value();
+                writer.write_string(std::string_view(reinterpret_cast<const char*>(value.data()), value.size()));
+            }
+        }
+    }
+
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream f(tmp_path, std::ios::binary | std::ios::trunc);
+        f.write(writer.buffer().data(), static_cast<std::streamsize>(writer.buffer().size()));
+        f.flush();
+        if (!f) {
+            throw std::runtime_error(fmt::format("could not write checkpoint file: {}", tmp_path.string()));
+        }
+    }
+    fs::rename(tmp_path, path);
+}
+
+std::size_t hash_checkpoint::add_unchanged_files(const file_storage& storage,
+                                                const file_storage& previous,
+                                                std::optional<fs::file_time_type> unchanged_since)
+{
+    Expects(storage.file_count() == file_sizes_.size());
+    if (previous.piece_size() != piece_size_) {
+        throw std::invalid_argument("previous storage has a different piece size");
+    }
+
+    std::map<fs::path, std::size_t> previous_files {};
+    for (std::size_t i = 0; i < previous.file_count(); ++i) {
+        if (!previous[i].is_padding_file()) {
+            previous_files.emplace(previous[i].path(), i);
+        }
+    }
+
+    // index in the previous storage of each unchanged file
+    std::vector<std::optional<std::size_t>> unchanged(storage.file_count());
+    std::size_t unchanged_count = 0;
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage[i];
+        // files that do not exist on disk do not have a modification time
+        if (entry.is_padding_file() || file_mtimes_[i] == 0) continue;
+
+        auto it = previous_files.find(entry.path());
+        if (it == previous_files.end()) continue;
+        const auto& previous_entry = previous[it->second];
+        if (previous_entry.file_size() != entry.file_size()) continue;
+
+        if (auto mtime = previous_entry.last_modified_time(); mtime) {
+            if (to_ticks(*mtime) != file_mtimes_[i]) continue;
+        }
+        else if (!unchanged_since || file_mtimes_[i] > to_ticks(*unchanged_since)) {
+            continue;
+        }
+        unchanged[i] = it->second;
+        ++unchanged_count;
+    }
+
+    std::unique_lock lck{mutex_};
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        if (!unchanged[i]) continue;
+        const auto& previous_entry = previous[*unchanged[i]];
+
+        for (const auto& [name, value] : previous_entry.checksums()) {
+            std::erase_if(checksums_[i], [&](const auto& c) { return c->name() == name; });
+            checksums_[i].push_back(make_checksum(value->name(), value->value()));
+        }
+
+        // empty files do not have a pieces root
+        if (v2_done_.empty() || !previous_entry.has_v2_data() || file_sizes_[i] == 0) continue;
+
+        const auto first = v2_file_offsets_[i];
+        if (file_sizes_[i] <= piece_size_) {
+            // the only piece of a file that fits in a piece is its root
+            v2_pieces_[first] = previous_entry.pieces_root();
+            v2_done_[first] = true;
+        }
+        else if (const auto layer = previous_entry.piece_layer(); layer.size() == v2_piece_count(i)) {
+            std::copy(layer.begin(), layer.end(), std::next(v2_pieces_.begin(), first));
+            std::fill_n(std::next(v2_done_.begin(), first), layer.size(), true);
+        }
+    }
+
+    if (v1_done_.empty() || previous.pieces().size() != previous.piece_count()) {
+        return unchanged_count;
+    }
+
+    // a v1 piece can be reused when the previous storage has a piece with the same bytes of the same files,
+    // files that moved by a multiple of the piece size keep their pieces
+    const auto offsets = file_offsets(storage);
+    const auto previous_offsets = file_offsets(previous);
+
+    for (std::size_t piece = 0; piece < v1_pieces_.size(); ++piece) {
+        const auto segments = piece_segments(storage, offsets, piece);
+
+        std::size_t position = 0;
+        std::optional<std::size_t> previous_piece {};
+        bool reusable = true;
+
+        for (const auto& segment : segments) {
+            if (segment.file_index != padding_segment) {
+                const auto& previous_index = unchanged[segment.file_index];
+                if (!previous_index) {
+                    reusable = false;
+                    break;
+                }
+                const auto previous_position = previous_offsets[*previous_index] + segment.file_offset;
+                if (!previous_piece) {
+                    if (previous_position < position || (previous_position - position) % piece_size_ != 0) {
+                        reusable = false;
+                        break;
+                    }
+                    previous_piece = (previous_position - position) / piece_size_;
+                }
+            }
+            position += segment.size;
+        }
+        if (!reusable || !previous_piece || *previous_piece >= previous.piece_count()) continue;
+
+        const auto previous_segments = piece_segments(previous, previous_offsets, *previous_piece);
+        const bool equal = std::ranges::equal(segments, previous_segments, [&](const auto& a, const auto& b) {
+            if (a.file_index == padding_segment || b.file_index == padding_segment) {
+                return a.file_index == b.file_index && a.size == b.size;
+            }
+            return unchanged[a.file_index] == b.file_index && a.file_offset == b.file_offset && a.size == b.size;
+        });
+        if (equal) {
+            v1_pieces_[piece] = previous.get_piece_hash(*previous_piece);
+            v1_done_[piece] = true;
+        }
+    }
+    return unchanged_count;
+}
+
+void hash_checkpoint::add_v1_piece(std::size_t index, const sha1_hash& hash)
+{
+    std::unique_lock lck{mutex_};
+    Expects(index < v1_pieces_.size());
+    v1_pieces_[index] = hash;
+    v1_done_[index] = true;
+}
+
+void hash_checkpoint::add_v2_piece(std::size_t file_index, std::size_t piece_index, const sha256_hash& hash)
+{
+    std::unique_lock lck{mutex_};
+    Expects(file_index < v2_file_offsets_.size());
+    Expects(piece_index < v2_piece_count(file_index));
+    v2_pieces_[v2_file_offsets_[file_index] + piece_index] = hash;
+    v2_done_[v2_file_offsets_[file_index] + piece_index] = true;
+}
+
+void hash_checkpoint::add_checksum(std::size_t file_index, const checksum& value)
+{
+    std::unique_lock lck{mutex_};
+    Expects(file_index < checksums_.size());
+    auto& checksums = checksums_[file_index];
+    std::erase_if(checksums, [&](const auto& c) { return c->name() == value.name(); });
+    checksums.push_back(make_checksum(value.name(), value.value()));
+}
+
+std::optional<sha1_hash> hash_checkpoint::v1_piece(std::size_t index) const
+{
+    std::unique_lock lck{mutex_};
+    if (index >= v1_done_.size() || !v1_done_[index]) {
+        return std::nullopt;
+    }
+    return v1_pieces_[index];
+}
+
+std::optional<sha256_hash> hash_checkpoint::v2_piece(std::size_t file_index, std::size_t piece_index) const
+{
+    std::unique_lock lck{mutex_};
+    if (v2_done_.empty() || file_index >= v2_file_offsets_.size() || piece_index >= v2_piece_count(file_index)) {
+        return std::nullopt;
+    }
+    const auto index = v2_file_offsets_[file_index] + piece_index;
+    if (!v2_done_[index]) {
+        return std::nullopt;
+    }
+    return v2_pieces_[index];
+}
+
+std::unique_ptr<checksum> hash_checkpoint::get_checksum(std::size_t file_index, hash_function algorithm) const
+{
+    std::unique_lock lck{mutex_};
+    Expects(file_index < checksums_.size());
+    for (const auto& c : checksums_[file_index]) {
+        if (c->algorithm() == algorithm) {
+            return make_checksum(c->name(), c->value());
+        }
+    }
+    return nullptr;
+}
+
+std::size_t hash_checkpoint::v2_piece_count(std::size_t file_index) const noexcept
+{
+    Expects(file_index < file_sizes_.size());
+    return std::max<std::size_t>(1, detail::div_ceil(file_sizes_[file_index], piece_size_));
+}
+
+void hash_checkpoint::discard_file(std::size_t file_index)
+{
+    // v1 pieces that contain data of the file
+    if (!v1_done_.empty() && file_sizes_[file_index] != 0) {
+        const auto first = v1_file_offsets_[file_index] / piece_size_;
+        const auto last = detail::div_ceil(v1_file_offsets_[file_index] + file_sizes_[file_index], piece_size_);
+        std::fill(std::next(v1_done_.begin(), first), std::next(v1_done_.begin(), last), false);
+    }
+    if (!v2_done_.empty()) {
+        const auto first = v2_file_offsets_[file_index];
+        std::fill(std::next(v2_done_.begin(), first),
+                  std::next(v2_done_.begin(), first + v2_piece_count(file_index)), false);
+    }
+    checksums_[file_index].clear();
+}
+
+} // namespace dottorrent
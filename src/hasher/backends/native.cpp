@@ -0,0 +1,564 @@
+#include "dottorrent/hasher/backends/native.hpp"
+#include "native_kernels.hpp"
+
+#if defined(DOTTORRENT_NATIVE_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace dottorrent::native {
+
+namespace kernels {
+
+namespace {
+
+constexpr std::size_t block_size = 64;
+
+constexpr std::uint32_t rotl(std::uint32_t x, int n) noexcept
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+constexpr std::uint32_t rotr(std::uint32_t x, int n) noexcept
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+constexpr std::uint64_t rotr64(std::uint64_t x, int n) noexcept
+{
+    return (x >> n) | (x << (64 - n));
+}
+
+inline std::uint32_t load_be32(const std::byte* p) noexcept
+{
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) |
+           (std::uint32_t(p[2]) << 8)  |  std::uint32_t(p[3]);
+}
+
+inline std::uint32_t load_le32(const std::byte* p) noexcept
+{
+    return (std::uint32_t(p[3]) << 24) | (std::uint32_t(p[2]) << 16) |
+           (std::uint32_t(p[1]) << 8)  |  std::uint32_t(p[0]);
+}
+
+inline std::uint64_t load_be64(const std::byte* p) noexcept
+{
+    return (std::uint64_t(load_be32(p)) << 32) | load_be32(p + 4);
+}
+
+constexpr std::uint32_t md5_round_constants[64] = {
+    0xD76AA478, 0xE8C7B756, 0x242070DB, 0xC1BDCEEE, 0xF57C0FAF, 0x4787C62A, 0xA8304613, 0xFD469501,
+    0x698098D8, 0x8B44F7AF, 0xFFFF5BB1, 0x895CD7BE, 0x6B901122, 0xFD987193, 0xA679438E, 0x49B40821,
+    0xF61E2562, 0xC040B340, 0x265E5A51, 0xE9B6C7AA, 0xD62F105D, 0x02441453, 0xD8A1E681, 0xE7D3FBC8,
+    0x21E1CDE6, 0xC33707D6, 0xF4D50D87, 0x455A14ED, 0xA9E3E905, 0xFCEFA3F8, 0x676F02D9, 0x8D2A4C8A,
+    0xFFFA3942, 0x8771F681, 0x6D9D6122, 0xFDE5380C, 0xA4BEEA44, 0x4BDECFA9, 0xF6BB4B60, 0xBEBFBC70,
+    0x289B7EC6, 0xEAA127FA, 0xD4EF3085, 0x04881D05, 0xD9D4D039, 0xE6DB99E5, 0x1FA27CF8, 0xC4AC5665,
+    0xF4292244, 0x432AFF97, 0xAB9423A7, 0xFC93A039, 0x655B59C3, 0x8F0CCC92, 0xFFEFF47D, 0x85845DD1,
+    0x6FA87E4F, 0xFE2CE6E0, 0xA3014314, 0x4E0811A1, 0xF7537E82, 0xBD3AF235, 0x2AD7D2BB, 0xEB86D391,
+};
+
+constexpr int md5_shifts[4][4] = {
+    {7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21},
+};
+
+constexpr std::uint64_t sha512_round_constants[80] = {
+    0x428A2F98D728AE22, 0x7137449123EF65CD, 0xB5C0FBCFEC4D3B2F, 0xE9B5DBA58189DBBC,
+    0x3956C25BF348B538, 0x59F111F1B605D019, 0x923F82A4AF194F9B, 0xAB1C5ED5DA6D8118,
+    0xD807AA98A3030242, 0x12835B0145706FBE, 0x243185BE4EE4B28C, 0x550C7DC3D5FFB4E2,
+    0x72BE5D74F27B896F, 0x80DEB1FE3B1696B1, 0x9BDC06A725C71235, 0xC19BF174CF692694,
+    0xE49B69C19EF14AD2, 0xEFBE4786384F25E3, 0x0FC19DC68B8CD5B5, 0x240CA1CC77AC9C65,
+    0x2DE92C6F592B0275, 0x4A7484AA6EA6E483, 0x5CB0A9DCBD41FBD4, 0x76F988DA831153B5,
+    0x983E5152EE66DFAB, 0xA831C66D2DB43210, 0xB00327C898FB213F, 0xBF597FC7BEEF0EE4,
+    0xC6E00BF33DA88FC2, 0xD5A79147930AA725, 0x06CA6351E003826F, 0x142929670A0E6E70,
+    0x27B70A8546D22FFC, 0x2E1B21385C26C926, 0x4D2C6DFC5AC42AED, 0x53380D139D95B3DF,
+    0x650A73548BAF63DE, 0x766A0ABB3C77B2A8, 0x81C2C92E47EDAEE6, 0x92722C851482353B,
+    0xA2BFE8A14CF10364, 0xA81A664BBC423001, 0xC24B8B70D0F89791, 0xC76C51A30654BE30,
+    0xD192E819D6EF5218, 0xD69906245565A910, 0xF40E35855771202A, 0x106AA07032BBD1B8,
+    0x19A4C116B8D2D0C8, 0x1E376C085141AB53, 0x2748774CDF8EEB99, 0x34B0BCB5E19B48A8,
+    0x391C0CB3C5C95A63, 0x4ED8AA4AE3418ACB, 0x5B9CCA4F7763E373, 0x682E6FF3D6B2B8A3,
+    0x748F82EE5DEFB2FC, 0x78A5636F43172F60, 0x84C87814A1F0AB72, 0x8CC702081A6439EC,
+    0x90BEFFFA23631E28, 0xA4506CEBDE82BDE9, 0xBEF9A3F7B2C67915, 0xC67178F2E372532B,
+    0xCA273ECEEA26619C, 0xD186B8C721C0C207, 0xEADA7DD6CDE0EB1E, 0xF57D4F7FEE6ED178,
+    0x06F067AA72176FBA, 0x0A637DC5A2C898A6, 0x113F9804BEF90DAE, 0x1B710B35131C471B,
+    0x28DB77F523047D84, 0x32CAAB7B40C72493, 0x3C9EBE0A15C9BEBC, 0x431D67C49C100D4C,
+    0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A, 0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817,
+};
+
+constexpr std::uint32_t sha256_round_constants[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+} // namespace
+
+void md5_compress_portable(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    std::uint32_t m[16];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk, blocks += block_size) {
+        for (int i = 0; i < 16; ++i) {
+            m[i] = load_le32(blocks + 4 * i);
+        }
+
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+        for (int t = 0; t < 64; ++t) {
+            std::uint32_t f;
+            int g;
+            if (t < 16)      { f = d ^ (b & (c ^ d)); g = t; }
+            else if (t < 32) { f = c ^ (d & (b ^ c)); g = (5 * t + 1) & 15; }
+            else if (t < 48) { f = b ^ c ^ d;         g = (3 * t + 5) & 15; }
+            else             { f = c ^ (b | ~d);      g = (7 * t) & 15; }
+
+            const std::uint32_t tmp = d;
+            d = c;
+            c = b;
+            b = b + rotl(a + f + md5_round_constants[t] + m[g], md5_shifts[t / 16][t % 4]);
+            a = tmp;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    }
+}
+
+void sha1_compress_portable(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    std::uint32_t w[16];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk, blocks += block_size) {
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+        for (int t = 0; t < 80; ++t) {
+            if (t < 16) {
+                w[t] = load_be32(blocks + 4 * t);
+            }
+            else {
+                w[t & 15] = rotl(w[(t - 3) & 15] ^ w[(t - 8) & 15] ^ w[(t - 14) & 15] ^ w[t & 15], 1);
+            }
+
+            std::uint32_t f, k;
+            if (t < 20)      { f = d ^ (b & (c ^ d));       k = 0x5A827999; }
+            else if (t < 40) { f = b ^ c ^ d;               k = 0x6ED9EBA1; }
+            else if (t < 60) { f = (b & c) | (d & (b | c)); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;               k = 0xCA62C1D6; }
+
+            const std::uint32_t tmp = rotl(a, 5) + f + e + k + w[t & 15];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = tmp;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+    }
+}
+
+void sha256_compress_portable(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    std::uint32_t w[16];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk, blocks += block_size) {
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int t = 0; t < 64; ++t) {
+            if (t < 16) {
+                w[t] = load_be32(blocks + 4 * t);
+            }
+            else {
+                const auto w15 = w[(t - 15) & 15];
+                const auto w2  = w[(t - 2) & 15];
+                const auto s0 = rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3);
+                const auto s1 = rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10);
+                w[t & 15] += s0 + w[(t - 7) & 15] + s1;
+            }
+
+            const auto t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + (g ^ (e & (f ^ g)))
+                          + sha256_round_constants[t] + w[t & 15];
+            const auto t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) | (c & (a | b)));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+void sha512_compress_portable(std::uint64_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    std::uint64_t w[16];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk, blocks += 2 * block_size) {
+        std::uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+        std::uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int t = 0; t < 80; ++t) {
+            if (t < 16) {
+                w[t] = load_be64(blocks + 8 * t);
+            }
+            else {
+                const auto w15 = w[(t - 15) & 15];
+                const auto w2  = w[(t - 2) & 15];
+                const auto s0 = rotr64(w15, 1) ^ rotr64(w15, 8) ^ (w15 >> 7);
+                const auto s1 = rotr64(w2, 19) ^ rotr64(w2, 61) ^ (w2 >> 6);
+                w[t & 15] += s0 + w[(t - 7) & 15] + s1;
+            }
+
+            const auto t1 = h + (rotr64(e, 14) ^ rotr64(e, 18) ^ rotr64(e, 41)) + (g ^ (e & (f ^ g)))
+                          + sha512_round_constants[t] + w[t & 15];
+            const auto t2 = (rotr64(a, 28) ^ rotr64(a, 34) ^ rotr64(a, 39)) + ((a & b) | (c & (a | b)));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+namespace {
+
+inline void store_be32(std::uint32_t x, std::byte* p) noexcept
+{
+    p[0] = std::byte(x >> 24);
+    p[1] = std::byte(x >> 16);
+    p[2] = std::byte(x >> 8);
+    p[3] = std::byte(x);
+}
+
+/// Last block of every message of `message_size` bytes, a multiple of the block size:
+/// the terminating bit, zeros and the message length in bits.
+constexpr std::array<std::byte, block_size> make_padding_block(std::size_t message_size) noexcept
+{
+    std::array<std::byte, block_size> block {};
+    const std::uint64_t bit_length = message_size * 8;
+    block[0] = std::byte(0x80);
+    for (std::size_t i = 0; i < 8; ++i) {
+        block[block_size - 1 - i] = std::byte((bit_length >> (8 * i)) & 0xFF);
+    }
+    return block;
+}
+
+template <std::size_t MessageSize>
+constexpr std::array<std::byte, block_size> padding_block = make_padding_block(MessageSize);
+
+void store_sha256_digest(const std::uint32_t* state, std::byte* out) noexcept
+{
+    for (std::size_t k = 0; k < 8; ++k) {
+        store_be32(state[k], out + 4 * k);
+    }
+}
+
+template <std::size_t MessageSize, typename Compress>
+void fixed_size_single(Compress compress, const std::byte* data, std::size_t count, std::byte* out) noexcept
+{
+    for (std::size_t i = 0; i < count; ++i, data += MessageSize, out += 32) {
+        auto state = sha256_traits::initial_state;
+        compress(state.data(), data, MessageSize / block_size);
+        compress(state.data(), padding_block<MessageSize>.data(), 1);
+        store_sha256_digest(state.data(), out);
+    }
+}
+
+/// Hash the messages in batches of `Lanes` messages.
+/// A last batch with less than `min_active_lanes` messages is hashed one message at a time with `single_compress`.
+template <std::size_t MessageSize, std::size_t Lanes, typename Compress, typename SingleCompress>
+void fixed_size_lanes(Compress compress, SingleCompress single_compress, std::size_t min_active_lanes,
+                      const std::byte* data, std::size_t count, std::byte* out) noexcept
+{
+    std::array<std::array<std::uint32_t, 8>, Lanes> states;
+    std::array<std::uint32_t*, Lanes> state_ptrs;
+    std::array<const std::byte*, Lanes> message_ptrs;
+    std::array<const std::byte*, Lanes> padding_ptrs;
+    for (std::size_t l = 0; l < Lanes; ++l) {
+        state_ptrs[l] = states[l].data();
+        padding_ptrs[l] = padding_block<MessageSize>.data();
+    }
+
+    for (std::size_t i = 0; i < count; i += Lanes) {
+        const auto n = std::min(Lanes, count - i);
+        if (n < min_active_lanes) {
+            fixed_size_single<MessageSize>(single_compress, data + i * MessageSize, n, out + i * 32);
+            break;
+        }
+
+        // idle lanes of the last batch hash the last message again
+        for (std::size_t l = 0; l < Lanes; ++l) {
+            states[l] = sha256_traits::initial_state;
+            message_ptrs[l] = data + (i + std::min(l, n - 1)) * MessageSize;
+        }
+        compress(state_ptrs.data(), message_ptrs.data(), MessageSize / block_size);
+        compress(state_ptrs.data(), padding_ptrs.data(), 1);
+
+        for (std::size_t l = 0; l < n; ++l) {
+            store_sha256_digest(states[l].data(), out + (i + l) * 32);
+        }
+    }
+}
+
+template <std::size_t MessageSize>
+void sha256_fixed_size(batch_kernel kernel, const std::byte* data, std::size_t count, std::byte* out) noexcept
+{
+    switch (kernel) {
+#if defined(DOTTORRENT_NATIVE_X86)
+    case batch_kernel::sha_ni:
+        fixed_size_single<MessageSize>(sha256_compress_sha_ni, data, count, out);
+        return;
+    case batch_kernel::avx2_x8:
+        fixed_size_lanes<MessageSize, 8>(sha256_compress_x8_avx2, sha256_compress_portable, 2, data, count, out);
+        return;
+    case batch_kernel::avx512_x16:
+        // 16 lanes hash about as fast as 11 messages with SHA-NI
+        if (detected_cpu_features().sha_ni) {
+            fixed_size_lanes<MessageSize, 16>(
+                    sha256_compress_x16_avx512, sha256_compress_sha_ni, 11, data, count, out);
+        }
+        else {
+            fixed_size_lanes<MessageSize, 16>(
+                    sha256_compress_x16_avx512, sha256_compress_portable, 2, data, count, out);
+        }
+        return;
+#endif
+    default:
+        fixed_size_single<MessageSize>(sha256_compress_portable, data, count, out);
+        return;
+    }
+}
+
+} // namespace
+
+void sha256_leaf_blocks(batch_kernel kernel, const std::byte* data, std::size_t block_count, std::byte* out) noexcept
+{
+    sha256_fixed_size<leaf_block_size>(kernel, data, block_count, out);
+}
+
+void sha256_inner_nodes(batch_kernel kernel, const std::byte* children, std::size_t node_count,
+                        std::byte* out) noexcept
+{
+    sha256_fixed_size<2 * 32>(kernel, children, node_count, out);
+}
+
+} // namespace kernels
+
+
+namespace {
+
+cpu_features detect_cpu_features() noexcept
+{
+    cpu_features features {};
+
+#if defined(DOTTORRENT_NATIVE_X86)
+    unsigned int leaf1[4] {};
+    unsigned int leaf7[4] {};
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    const auto max_leaf = static_cast<unsigned int>(regs[0]);
+    __cpuid(regs, 1);
+    for (int i = 0; i < 4; ++i) leaf1[i] = static_cast<unsigned int>(regs[i]);
+    if (max_leaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        for (int i = 0; i < 4; ++i) leaf7[i] = static_cast<unsigned int>(regs[i]);
+    }
+#else
+    const auto max_leaf = __get_cpuid_max(0, nullptr);
+    __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+    if (max_leaf >= 7) {
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+    }
+#endif
+
+    const bool ssse3  = leaf1[2] & (1u << 9);
+    const bool sse41  = leaf1[2] & (1u << 19);
+    const bool osxsave = leaf1[2] & (1u << 27);
+    const bool avx    = leaf1[2] & (1u << 28);
+
+    // the operating system must save the ymm registers on context switches
+    bool ymm_enabled = false;
+    bool zmm_enabled = false;
+    if (osxsave && avx) {
+#if defined(_MSC_VER)
+        const auto xcr0 = _xgetbv(0);
+#else
+        unsigned int eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        const std::uint64_t xcr0 = (std::uint64_t(edx) << 32) | eax;
+#endif
+        ymm_enabled = (xcr0 & 0x6) == 0x6;
+        // and the opmask and zmm registers
+        zmm_enabled = (xcr0 & 0xE6) == 0xE6;
+    }
+
+    features.sha_ni = kernels::sha_ni_compiled && ssse3 && sse41 && (leaf7[1] & (1u << 29));
+    features.avx2   = kernels::avx2_compiled && ymm_enabled && (leaf7[1] & (1u << 5));
+    features.avx512 = kernels::avx512_compiled && zmm_enabled && (leaf7[1] & (1u << 16));
+#endif
+
+    return features;
+}
+
+using compress_function = void(*)(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+struct dispatch_table
+{
+    compress_function sha1;
+    compress_function sha256;
+    lanes_compress_function sha1_lanes;
+    lanes_compress_function sha256_lanes;
+    kernels::batch_kernel sha256_batch;
+};
+
+dispatch_table make_dispatch_table() noexcept
+{
+    dispatch_table table {
+        kernels::sha1_compress_portable,
+        kernels::sha256_compress_portable,
+        nullptr,
+        nullptr,
+        kernels::batch_kernel::portable,
+    };
+
+#if defined(DOTTORRENT_NATIVE_X86)
+    const auto& features = detected_cpu_features();
+    if (features.sha_ni) {
+        table.sha1 = kernels::sha1_compress_sha_ni;
+        table.sha256 = kernels::sha256_compress_sha_ni;
+    }
+    else if (features.avx2) {
+        table.sha1_lanes = kernels::sha1_compress_x8_avx2;
+        table.sha256_lanes = kernels::sha256_compress_x8_avx2;
+    }
+
+    // unlike single messages, batches of leaf blocks and inner nodes are faster in AVX-512 lanes than with SHA-NI
+    if (features.avx512) {
+        table.sha256_batch = kernels::batch_kernel::avx512_x16;
+    }
+    else if (features.sha_ni) {
+        table.sha256_batch = kernels::batch_kernel::sha_ni;
+    }
+    else if (features.avx2) {
+        table.sha256_batch = kernels::batch_kernel::avx2_x8;
+    }
+#endif
+
+    return table;
+}
+
+const dispatch_table& get_dispatch_table() noexcept
+{
+    static const dispatch_table table = make_dispatch_table();
+    return table;
+}
+
+} // namespace
+
+
+const cpu_features& detected_cpu_features() noexcept
+{
+    static const cpu_features features = detect_cpu_features();
+    return features;
+}
+
+std::string selected_kernels()
+{
+    const auto& table = get_dispatch_table();
+
+    std::string description = "portable";
+#if defined(DOTTORRENT_NATIVE_X86)
+    if (table.sha1 == kernels::sha1_compress_sha_ni) {
+        description = "sha-ni";
+    }
+    else if (table.sha1_lanes != nullptr) {
+        description = "portable, avx2 x8";
+    }
+    if (table.sha256_batch == kernels::batch_kernel::avx512_x16) {
+        description += ", avx-512 x16 batches";
+    }
+#endif
+    return description;
+}
+
+void md5_compress(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    kernels::md5_compress_portable(state, blocks, block_count);
+}
+
+void sha1_compress(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    get_dispatch_table().sha1(state, blocks, block_count);
+}
+
+void sha256_compress(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    get_dispatch_table().sha256(state, blocks, block_count);
+}
+
+void sha512_compress(std::uint64_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    kernels::sha512_compress_portable(state, blocks, block_count);
+}
+
+lanes_compress_function sha1_lanes_compress() noexcept
+{
+    return get_dispatch_table().sha1_lanes;
+}
+
+lanes_compress_function sha256_lanes_compress() noexcept
+{
+    return get_dispatch_table().sha256_lanes;
+}
+
+void sha256_leaf_blocks(std::span<const std::byte> data, std::span<sha256_hash> out)
+{
+    Expects(data.size() == out.size() * leaf_block_size);
+    static_assert(sizeof(sha256_hash) == sha256_hash::size_bytes);
+
+    kernels::sha256_leaf_blocks(get_dispatch_table().sha256_batch, data.data(), out.size(),
+                                reinterpret_cast<std::byte*>(out.data()));
+}
+
+void sha256_inner_nodes(std::span<const sha256_hash> children, std::span<sha256_hash> out)
+{
+    Expects(children.size() == 2 * out.size());
+
+    kernels::sha256_inner_nodes(get_dispatch_table().sha256_batch,
+                                reinterpret_cast<const std::byte*>(children.data()), out.size(),
+                                reinterpret_cast<std::byte*>(out.data()));
+}
+
+bool sha256_batches_accelerated() noexcept
+{
+    return get_dispatch_table().sha256_batch != kernels::batch_kernel::portable;
+}
+
+template class hasher_impl<md5_traits>;
+template class hasher_impl<sha1_traits>;
+template class hasher_impl<sha256_traits>;
+template class hasher_impl<sha512_traits>;
+template class multi_buffer_hasher_impl<sha1_traits>;
+template class multi_buffer_hasher_impl<sha256_traits>;
+
+} // namespace dottorrent::native
@@ -0,0 +1,271 @@
+// SHA-1 and SHA-256 of 8 independent messages, one message per 32-bit lane of the AVX2 registers.
+// This file is compiled with -mavx2 and must only be called after checking CPU support.
+// Do not include headers that define inline functions used by other translation units,
+// the linker could keep the copy of this file.
+#include "native_kernels.hpp"
+
+#if defined(DOTTORRENT_NATIVE_X86) && (defined(__AVX2__) || defined(_MSC_VER))
+#define DOTTORRENT_NATIVE_AVX2
+#include <immintrin.h>
+#endif
+
+namespace dottorrent::native::kernels {
+
+#if defined(DOTTORRENT_NATIVE_AVX2)
+
+const bool avx2_compiled = true;
+
+namespace {
+
+constexpr std::size_t lanes = 8;
+
+constexpr std::uint32_t sha256_round_constants[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+template <int N>
+inline __m256i rotl(__m256i x)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, N), _mm256_srli_epi32(x, 32 - N));
+}
+
+template <int N>
+inline __m256i rotr(__m256i x)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+}
+
+inline __m256i add(__m256i a, __m256i b)
+{
+    return _mm256_add_epi32(a, b);
+}
+
+/// Load 8 big-endian words at `offset` of every lane and transpose them,
+/// so that out[i] holds word i of all lanes.
+inline void load_transposed(const std::byte* const* data, std::size_t offset, __m256i* out)
+{
+    const __m256i byte_swap = _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    __m256i r[lanes];
+    for (std::size_t i = 0; i < lanes; ++i) {
+        r[i] = _mm256_shuffle_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data[i] + offset)), byte_swap);
+    }
+
+    const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+    const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    out[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    out[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    out[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    out[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    out[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    out[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    out[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    out[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+template <std::size_t N>
+inline void load_states(std::uint32_t* const* states, __m256i* out)
+{
+    for (std::size_t k = 0; k < N; ++k) {
+        out[k] = _mm256_setr_epi32(
+                static_cast<int>(states[0][k]), static_cast<int>(states[1][k]),
+                static_cast<int>(states[2][k]), static_cast<int>(states[3][k]),
+                static_cast<int>(states[4][k]), static_cast<int>(states[5][k]),
+                static_cast<int>(states[6][k]), static_cast<int>(states[7][k]));
+    }
+}
+
+template <std::size_t N>
+inline void store_states(std::uint32_t* const* states, const __m256i* in)
+{
+    alignas(32) std::uint32_t words[lanes];
+    for (std::size_t k = 0; k < N; ++k) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(words), in[k]);
+        for (std::size_t i = 0; i < lanes; ++i) {
+            states[i][k] = words[i];
+        }
+    }
+}
+
+} // namespace
+
+void sha1_compress_x8_avx2(std::uint32_t* const* states, const std::byte* const* data,
+                           std::size_t block_count) noexcept
+{
+    const __m256i k0 = _mm256_set1_epi32(0x5A827999);
+    const __m256i k1 = _mm256_set1_epi32(0x6ED9EBA1);
+    const __m256i k2 = _mm256_set1_epi32(static_cast<int>(0x8F1BBCDC));
+    const __m256i k3 = _mm256_set1_epi32(static_cast<int>(0xCA62C1D6));
+
+    const std::byte* p[lanes];
+    for (std::size_t i = 0; i < lanes; ++i) p[i] = data[i];
+
+    __m256i s[5];
+    load_states<5>(states, s);
+
+    __m256i w[16];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk) {
+        load_transposed(p, 0, w);
+        load_transposed(p, 32, w + 8);
+
+        __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4];
+
+        for (int t = 0; t < 80; ++t) {
+            if (t >= 16) {
+                w[t & 15] = rotl<1>(_mm256_xor_si256(
+                        _mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15]),
+                        _mm256_xor_si256(w[(t - 14) & 15], w[t & 15])));
+            }
+
+            __m256i f, k;
+            if (t < 20) {
+                f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+                k = k0;
+            }
+            else if (t < 40) {
+                f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+                k = k1;
+            }
+            else if (t < 60) {
+                f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+                k = k2;
+            }
+            else {
+                f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+                k = k3;
+            }
+
+            const __m256i tmp = add(add(rotl<5>(a), f), add(add(e, k), w[t & 15]));
+            e = d;
+            d = c;
+            c = rotl<30>(b);
+            b = a;
+            a = tmp;
+        }
+
+        s[0] = add(s[0], a);
+        s[1] = add(s[1], b);
+        s[2] = add(s[2], c);
+        s[3] = add(s[3], d);
+        s[4] = add(s[4], e);
+
+        for (std::size_t i = 0; i < lanes; ++i) p[i] += 64;
+    }
+
+    store_states<5>(states, s);
+}
+
+void sha256_compress_x8_avx2(std::uint32_t* const* states, const std::byte* const* data,
+                             std::size_t block_count) noexcept
+{
+    const std::byte* p[lanes];
+    for (std::size_t i = 0; i < lanes; ++i) p[i] = data[i];
+
+    __m256i s[8];
+    load_states<8>(states, s);
+
+    __m256i w[16];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk) {
+        load_transposed(p, 0, w);
+        load_transposed(p, 32, w + 8);
+
+        __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+        __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+        for (int t = 0; t < 64; ++t) {
+            if (t >= 16) {
+                const __m256i w15 = w[(t - 15) & 15];
+                const __m256i w2 = w[(t - 2) & 15];
+                const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr<7>(w15), rotr<18>(w15)),
+                                                    _mm256_srli_epi32(w15, 3));
+                const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr<17>(w2), rotr<19>(w2)),
+                                                    _mm256_srli_epi32(w2, 10));
+                w[t & 15] = add(add(w[t & 15], s0), add(w[(t - 7) & 15], s1));
+            }
+
+            const __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr<6>(e), rotr<11>(e)), rotr<25>(e));
+            const __m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+            const __m256i k = _mm256_set1_epi32(static_cast<int>(sha256_round_constants[t]));
+            const __m256i t1 = add(add(add(h, sigma1), add(ch, k)), w[t & 15]);
+
+            const __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr<2>(a), rotr<13>(a)), rotr<22>(a));
+            const __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+            const __m256i t2 = add(sigma0, maj);
+
+            h = g;
+            g = f;
+            f = e;
+            e = add(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = add(t1, t2);
+        }
+
+        s[0] = add(s[0], a);
+        s[1] = add(s[1], b);
+        s[2] = add(s[2], c);
+        s[3] = add(s[3], d);
+        s[4] = add(s[4], e);
+        s[5] = add(s[5], f);
+        s[6] = add(s[6], g);
+        s[7] = add(s[7], h);
+
+        for (std::size_t i = 0; i < lanes; ++i) p[i] += 64;
+    }
+
+    store_states<8>(states, s);
+}
+
+#elif defined(DOTTORRENT_NATIVE_X86)
+
+// compiler without support for AVX2, never selected at runtime
+const bool avx2_compiled = false;
+
+void sha1_compress_x8_avx2(std::uint32_t* const* states, const std::byte* const* data,
+                           std::size_t block_count) noexcept
+{
+    for (std::size_t i = 0; i < 8; ++i) {
+        sha1_compress_portable(states[i], data[i], block_count);
+    }
+}
+
+void sha256_compress_x8_avx2(std::uint32_t* const* states, const std::byte* const* data,
+                             std::size_t block_count) noexcept
+{
+    for (std::size_t i = 0; i < 8; ++i) {
+        sha256_compress_portable(states[i], data[i], block_count);
+    }
+}
+
+#endif
+
+} // namespace dottorrent::native::kernels
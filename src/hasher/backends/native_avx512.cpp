@@ -0,0 +1,192 @@
+// SHA-256 of 16 independent messages, one message per 32-bit lane of the AVX-512 registers.
+// This file is compiled with -mavx512f and must only be called after checking CPU support.
+// Do not include headers that define inline functions used by other translation units,
+// the linker could keep the copy of this file.
+#include "native_kernels.hpp"
+
+#if defined(DOTTORRENT_NATIVE_X86) && (defined(__AVX512F__) || defined(_MSC_VER))
+#define DOTTORRENT_NATIVE_AVX512
+#include <immintrin.h>
+#endif
+
+namespace dottorrent::native::kernels {
+
+#if defined(DOTTORRENT_NATIVE_AVX512)
+
+const bool avx512_compiled = true;
+
+namespace {
+
+constexpr std::size_t lanes = 16;
+
+constexpr std::uint32_t sha256_round_constants[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+inline __m512i add(__m512i a, __m512i b)
+{
+    return _mm512_add_epi32(a, b);
+}
+
+// ternary logic functions of (a, b, c)
+constexpr int xor3 = 0x96;
+constexpr int choose = 0xCA;    // a ? b : c
+constexpr int majority = 0xE8;
+
+/// Byte swap every 32-bit word without the AVX512BW byte shuffle.
+inline __m512i byte_swap(__m512i x)
+{
+    const __m512i mask = _mm512_set1_epi32(static_cast<int>(0xFF00FF00));
+    return _mm512_ternarylogic_epi32(mask, _mm512_ror_epi32(x, 8), _mm512_rol_epi32(x, 8), choose);
+}
+
+/// Load the 16 big-endian words of the current block of every lane and transpose them,
+/// so that out[i] holds word i of all lanes.
+inline void load_transposed(const std::byte* const* data, __m512i* out)
+{
+    __m512i r[lanes];
+    for (std::size_t i = 0; i < lanes; ++i) {
+        r[i] = _mm512_loadu_si512(data[i]);
+    }
+
+    // t[2k], t[2k+1]: interleaved words of rows 2k and 2k+1
+    __m512i t[lanes];
+    for (std::size_t k = 0; k < lanes / 2; ++k) {
+        t[2 * k] = _mm512_unpacklo_epi32(r[2 * k], r[2 * k + 1]);
+        t[2 * k + 1] = _mm512_unpackhi_epi32(r[2 * k], r[2 * k + 1]);
+    }
+
+    // u[4m+j]: word 4l+j of rows 4m..4m+3 in 128-bit lane l
+    __m512i u[lanes];
+    for (std::size_t m = 0; m < lanes / 4; ++m) {
+        u[4 * m + 0] = _mm512_unpacklo_epi64(t[4 * m], t[4 * m + 2]);
+        u[4 * m + 1] = _mm512_unpackhi_epi64(t[4 * m], t[4 * m + 2]);
+        u[4 * m + 2] = _mm512_unpacklo_epi64(t[4 * m + 1], t[4 * m + 3]);
+        u[4 * m + 3] = _mm512_unpackhi_epi64(t[4 * m + 1], t[4 * m + 3]);
+    }
+
+    // gather the 128-bit lanes holding the same word
+    for (std::size_t j = 0; j < 4; ++j) {
+        const __m512i a = _mm512_shuffle_i32x4(u[j], u[4 + j], 0x44);
+        const __m512i b = _mm512_shuffle_i32x4(u[j], u[4 + j], 0xEE);
+        const __m512i c = _mm512_shuffle_i32x4(u[8 + j], u[12 + j], 0x44);
+        const __m512i d = _mm512_shuffle_i32x4(u[8 + j], u[12 + j], 0xEE);
+
+        out[j]      = byte_swap(_mm512_shuffle_i32x4(a, c, 0x88));
+        out[4 + j]  = byte_swap(_mm512_shuffle_i32x4(a, c, 0xDD));
+        out[8 + j]  = byte_swap(_mm512_shuffle_i32x4(b, d, 0x88));
+        out[12 + j] = byte_swap(_mm512_shuffle_i32x4(b, d, 0xDD));
+    }
+}
+
+inline void load_states(std::uint32_t* const* states, __m512i* out)
+{
+    alignas(64) std::uint32_t words[lanes];
+    for (std::size_t k = 0; k < 8; ++k) {
+        for (std::size_t i = 0; i < lanes; ++i) {
+            words[i] = states[i][k];
+        }
+        out[k] = _mm512_load_si512(words);
+    }
+}
+
+inline void store_states(std::uint32_t* const* states, const __m512i* in)
+{
+    alignas(64) std::uint32_t words[lanes];
+    for (std::size_t k = 0; k < 8; ++k) {
+        _mm512_store_si512(words, in[k]);
+        for (std::size_t i = 0; i < lanes; ++i) {
+            states[i][k] = words[i];
+        }
+    }
+}
+
+} // namespace
+
+void sha256_compress_x16_avx512(std::uint32_t* const* states, const std::byte* const* data,
+                                std::size_t block_count) noexcept
+{
+    const std::byte* p[lanes];
+    for (std::size_t i = 0; i < lanes; ++i) p[i] = data[i];
+
+    __m512i s[8];
+    load_states(states, s);
+
+    __m512i w[16];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk) {
+        load_transposed(p, w);
+
+        __m512i a = s[0], b = s[1], c = s[2], d = s[3];
+        __m512i e = s[4], f = s[5], g = s[6], h = s[7];
+
+        for (int t = 0; t < 64; ++t) {
+            if (t >= 16) {
+                const __m512i w15 = w[(t - 15) & 15];
+                const __m512i w2 = w[(t - 2) & 15];
+                const __m512i s0 = _mm512_ternarylogic_epi32(
+                        _mm512_ror_epi32(w15, 7), _mm512_ror_epi32(w15, 18), _mm512_srli_epi32(w15, 3), xor3);
+                const __m512i s1 = _mm512_ternarylogic_epi32(
+                        _mm512_ror_epi32(w2, 17), _mm512_ror_epi32(w2, 19), _mm512_srli_epi32(w2, 10), xor3);
+                w[t & 15] = add(add(w[t & 15], s0), add(w[(t - 7) & 15], s1));
+            }
+
+            const __m512i sigma1 = _mm512_ternarylogic_epi32(
+                    _mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11), _mm512_ror_epi32(e, 25), xor3);
+            const __m512i ch = _mm512_ternarylogic_epi32(e, f, g, choose);
+            const __m512i k = _mm512_set1_epi32(static_cast<int>(sha256_round_constants[t]));
+            const __m512i t1 = add(add(add(h, sigma1), add(ch, k)), w[t & 15]);
+
+            const __m512i sigma0 = _mm512_ternarylogic_epi32(
+                    _mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13), _mm512_ror_epi32(a, 22), xor3);
+            const __m512i maj = _mm512_ternarylogic_epi32(a, b, c, majority);
+            const __m512i t2 = add(sigma0, maj);
+
+            h = g;
+            g = f;
+            f = e;
+            e = add(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = add(t1, t2);
+        }
+
+        s[0] = add(s[0], a);
+        s[1] = add(s[1], b);
+        s[2] = add(s[2], c);
+        s[3] = add(s[3], d);
+        s[4] = add(s[4], e);
+        s[5] = add(s[5], f);
+        s[6] = add(s[6], g);
+        s[7] = add(s[7], h);
+
+        for (std::size_t i = 0; i < lanes; ++i) p[i] += 64;
+    }
+
+    store_states(states, s);
+}
+
+#elif defined(DOTTORRENT_NATIVE_X86)
+
+// compiler without support for AVX-512, never selected at runtime
+const bool avx512_compiled = false;
+
+void sha256_compress_x16_avx512(std::uint32_t* const* states, const std::byte* const* data,
+                                std::size_t block_count) noexcept
+{
+    for (std::size_t i = 0; i < 16; ++i) {
+        sha256_compress_portable(states[i], data[i], block_count);
+    }
+}
+
+#endif
+
+} // namespace dottorrent::native::kernels
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Compression functions of the native hash backend.
+/// The dispatching entry points are declared in dottorrent/hasher/backends/native.hpp.
+///
+/// All functions process `block_count` consecutive blocks and update `state` in place.
+/// The multi-lane functions process `block_count` blocks of 8 or 16 independent messages,
+/// `states[i]` and `data[i]` belong to lane i.
+
+namespace dottorrent::native::kernels {
+
+void md5_compress_portable(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+void sha1_compress_portable(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+void sha256_compress_portable(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+void sha512_compress_portable(std::uint64_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+/// Compression functions used to hash batches of messages with the same length.
+enum class batch_kernel
+{
+    portable,
+    sha_ni,
+    avx2_x8,
+    avx512_x16,
+};
+
+/// Write the SHA-256 digests of `block_count` consecutive 16 KiB blocks to `out`, 32 bytes per block.
+void sha256_leaf_blocks(batch_kernel kernel, const std::byte* data, std::size_t block_count, std::byte* out) noexcept;
+
+/// Write the SHA-256 digests of `node_count` consecutive pairs of 32 byte child nodes to `out`, 32 bytes per node.
+void sha256_inner_nodes(batch_kernel kernel, const std::byte* children, std::size_t node_count,
+                        std::byte* out) noexcept;
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DOTTORRENT_NATIVE_X86
+
+/// True when the SHA-NI kernels were compiled with support for the SHA extensions.
+extern const bool sha_ni_compiled;
+
+void sha1_compress_sha_ni(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+void sha256_compress_sha_ni(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept;
+
+/// True when the AVX2 kernels were compiled with support for AVX2.
+extern const bool avx2_compiled;
+
+void sha1_compress_x8_avx2(std::uint32_t* const* states, const std::byte* const* data,
+                           std::size_t block_count) noexcept;
+
+void sha256_compress_x8_avx2(std::uint32_t* const* states, const std::byte* const* data,
+                             std::size_t block_count) noexcept;
+
+/// True when the AVX-512 kernels were compiled with support for AVX-512F.
+extern const bool avx512_compiled;
+
+void sha256_compress_x16_avx512(std::uint32_t* const* states, const std::byte* const* data,
+                                std::size_t block_count) noexcept;
+#endif
+
+} // namespace dottorrent::native::kernels
@@ -0,0 +1,184 @@
+// SHA-1 and SHA-256 with the Intel SHA extensions.
+// This file is compiled with -msha -msse4.1 and must only be called after checking CPU support.
+// Do not include headers that define inline functions used by other translation units,
+// the linker could keep the copy of this file.
+#include "native_kernels.hpp"
+
+#if defined(DOTTORRENT_NATIVE_X86) && (defined(__SHA__) || defined(_MSC_VER))
+#define DOTTORRENT_NATIVE_SHA_NI
+#include <immintrin.h>
+#include <utility>
+#endif
+
+namespace dottorrent::native::kernels {
+
+#if defined(DOTTORRENT_NATIVE_SHA_NI)
+
+const bool sha_ni_compiled = true;
+
+namespace {
+
+alignas(16) constexpr std::uint32_t sha256_round_constants[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+/// Four rounds of SHA-1, `G` is the index of the group of rounds.
+/// The message schedule runs ahead of the rounds, msg[G % 4] holds the words of this group.
+template <int G>
+inline void sha1_rounds(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i (&msg)[4])
+{
+    constexpr int function = G / 5;
+
+    if constexpr (G == 0) {
+        e0 = _mm_add_epi32(e0, msg[0]);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, function);
+    }
+    else if constexpr (G % 2 == 1) {
+        e1 = _mm_sha1nexte_epu32(e1, msg[G % 4]);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, function);
+    }
+    else {
+        e0 = _mm_sha1nexte_epu32(e0, msg[G % 4]);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, function);
+    }
+
+    if constexpr (G >= 3 && G <= 18) {
+        msg[(G + 1) % 4] = _mm_sha1msg2_epu32(msg[(G + 1) % 4], msg[G % 4]);
+    }
+    if constexpr (G >= 1 && G <= 16) {
+        msg[(G + 3) % 4] = _mm_sha1msg1_epu32(msg[(G + 3) % 4], msg[G % 4]);
+    }
+    if constexpr (G >= 2 && G <= 17) {
+        msg[(G + 2) % 4] = _mm_xor_si128(msg[(G + 2) % 4], msg[G % 4]);
+    }
+}
+
+template <int... G>
+inline void sha1_all_rounds(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i (&msg)[4],
+                            std::integer_sequence<int, G...>)
+{
+    (sha1_rounds<G>(abcd, e0, e1, msg), ...);
+}
+
+/// Four rounds of SHA-256, `G` is the index of the group of rounds.
+template <int G>
+inline void sha256_rounds(__m128i& state0, __m128i& state1, __m128i (&msg)[4])
+{
+    __m128i m = _mm_add_epi32(msg[G % 4],
+            _mm_load_si128(reinterpret_cast<const __m128i*>(sha256_round_constants + 4 * G)));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+
+    if constexpr (G >= 3 && G <= 14) {
+        const __m128i tmp = _mm_alignr_epi8(msg[G % 4], msg[(G + 3) % 4], 4);
+        msg[(G + 1) % 4] = _mm_add_epi32(msg[(G + 1) % 4], tmp);
+        msg[(G + 1) % 4] = _mm_sha256msg2_epu32(msg[(G + 1) % 4], msg[G % 4]);
+    }
+
+    m = _mm_shuffle_epi32(m, 0x0E);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, m);
+
+    if constexpr (G >= 1 && G <= 12) {
+        msg[(G + 3) % 4] = _mm_sha256msg1_epu32(msg[(G + 3) % 4], msg[G % 4]);
+    }
+}
+
+template <int... G>
+inline void sha256_all_rounds(__m128i& state0, __m128i& state1, __m128i (&msg)[4],
+                              std::integer_sequence<int, G...>)
+{
+    (sha256_rounds<G>(state0, state1, msg), ...);
+}
+
+} // namespace
+
+void sha1_compress_sha_ni(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+    __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+    __m128i e1 = _mm_setzero_si128();
+    __m128i msg[4];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk, blocks += 64) {
+        const __m128i abcd_save = abcd;
+        const __m128i e0_save = e0;
+
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16 * i)), byte_swap);
+        }
+
+        sha1_all_rounds(abcd, e0, e1, msg, std::make_integer_sequence<int, 20>{});
+
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = static_cast<std::uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+void sha256_compress_sha_ni(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // reorder the state words to the ABEF and CDGH layout of sha256rnds2
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    __m128i msg[4];
+
+    for (std::size_t blk = 0; blk < block_count; ++blk, blocks += 64) {
+        const __m128i abef_save = state0;
+        const __m128i cdgh_save = state1;
+
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16 * i)), byte_swap);
+        }
+
+        sha256_all_rounds(state0, state1, msg, std::make_integer_sequence<int, 16>{});
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+#elif defined(DOTTORRENT_NATIVE_X86)
+
+// compiler without support for the SHA extensions, never selected at runtime
+const bool sha_ni_compiled = false;
+
+void sha1_compress_sha_ni(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    sha1_compress_portable(state, blocks, block_count);
+}
+
+void sha256_compress_sha_ni(std::uint32_t* state, const std::byte* blocks, std::size_t block_count) noexcept
+{
+    sha256_compress_portable(state, blocks, block_count);
+}
+
+#endif
+
+} // namespace dottorrent::native::kernels
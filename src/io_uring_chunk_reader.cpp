@@ -0,0 +1,340 @@
+#include "dottorrent/io_uring_chunk_reader.hpp"
+
+#ifdef DOTTORRENT_USE_IO_URING
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <system_error>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace dottorrent {
+
+namespace {
+
+/// Minimal io_uring submission and completion queue pair used for file reads.
+class io_ring
+{
+public:
+    explicit io_ring(unsigned entries)
+    {
+        io_uring_params params {};
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::system_category(), "io_uring_setup");
+        }
+        entries_ = params.sq_entries;
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        single_mmap_ = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap_) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap_ ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+        auto* sq = static_cast<std::byte*>(sq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto* cq = static_cast<std::byte*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    io_ring(const io_ring&) = delete;
+    io_ring& operator=(const io_ring&) = delete;
+
+    ~io_ring()
+    {
+        if (sqes_) ::munmap(sqes_, sqes_size_);
+        if (cq_ring_ && !single_mmap_) ::munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_) ::munmap(sq_ring_, sq_ring_size_);
+        ::close(fd_);
+    }
+
+    /// Maximum number of requests that can be in flight.
+    unsigned capacity() const noexcept
+    { return entries_; }
+
+    /// Queue a read request. The caller must make sure no more than `capacity()` requests are in flight.
+    void prepare_read(int fd, std::byte* buffer, std::size_t size, std::size_t offset, std::uint64_t user_data)
+    {
+        unsigned tail = *sq_tail_;
+        unsigned index = tail & sq_mask_;
+
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(buffer);
+        sqe.len = static_cast<std::uint32_t>(size);
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array_[index] = index;
+
+        std::atomic_ref(*sq_tail_).store(tail + 1, std::memory_order_release);
+        ++unsubmitted_;
+    }
+
+    /// Submit all queued requests and block until at least `min_complete` requests completed.
+    void submit_and_wait(unsigned min_complete)
+    {
+        for (;;) {
+            auto ret = ::syscall(__NR_io_uring_enter, fd_, unsubmitted_, min_complete,
+                                 min_complete ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (ret >= 0) {
+                unsubmitted_ -= static_cast<unsigned>(ret);
+                return;
+            }
+            if (errno != EINTR) {
+                throw std::system_error(errno, std::system_category(), "io_uring_enter");
+            }
+        }
+    }
+
+    /// Invoke `f(user_data, result)` for all completed requests.
+    template <typename Function>
+    void consume_completions(Function&& f)
+    {
+        unsigned head = *cq_head_;
+        unsigned tail = std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            f(cqe.user_data, cqe.res);
+        }
+        std::atomic_ref(*cq_head_).store(head, std::memory_order_release);
+    }
+
+private:
+    void* map(std::size_t size, off_t offset)
+    {
+        void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        if (ptr == MAP_FAILED) {
+            throw std::system_error(errno, std::system_category(), "io_uring mmap");
+        }
+        return ptr;
+    }
+
+    int fd_ = -1;
+    unsigned entries_ = 0;
+    unsigned unsubmitted_ = 0;
+    bool single_mmap_ = false;
+
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+    std::size_t sqes_size_ = 0;
+
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+struct pending_chunk;
+
+/// Read of a single chunk_segment, possibly resubmitted after a short read.
+struct read_request
+{
+    pending_chunk* chunk;
+    const chunk_segment* segment;
+    std::size_t bytes_done = 0;
+};
+
+struct pending_chunk
+{
+    chunk_descriptor descriptor;
+    std::shared_ptr<data_chunk::data_type> data {};
+    std::vector<read_request> requests {};
+    std::size_t reads_remaining = 0;
+};
+
+} // namespace
+
+
+io_uring_chunk_reader::io_uring_chunk_reader(file_storage& storage,
+                                             protocol protocol_version,
+                                             std::size_t block_size,
+                                             std::size_t capacity,
+                                             std::size_t queue_depth)
+        : chunk_reader(storage, block_size, capacity)
+        , protocol_(protocol_version)
+        , queue_depth_(queue_depth)
+{
+    Expects(queue_depth_ > 0);
+}
+
+void io_uring_chunk_reader::run()
+{
+    file_storage& storage = storage_;
+    const auto file_paths = absolute_file_paths(storage);
+    chunk_planner planner(storage, protocol_, chunk_size_);
+
+    io_ring ring(static_cast<unsigned>(queue_depth_));
+
+    // Keep at least one pool buffer available to the consumers to guarantee progress.
+    const auto max_chunks_in_flight = std::max(std::size_t(1), std::min(queue_depth_, capacity_ - 1));
+
+    std::deque<std::unique_ptr<pending_chunk>> window {};
+    std::deque<read_request*> backlog {};
+    std::unordered_map<std::uint32_t, int> open_files {};
+    std::size_t reads_in_flight = 0;
+    bool plan_done = false;
+    std::exception_ptr error {};
+
+    auto get_file_descriptor = [&](std::uint32_t file_index) {
+        if (auto it = open_files.find(file_index); it != open_files.end()) {
+            return it->second;
+        }
+        int fd = ::open(file_paths[file_index].c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::system_category(),
+                    fmt::format("I/O error reading: {}", storage[file_index].path().string()));
+        }
+        open_files.emplace(file_index, fd);
+        return fd;
+    };
+
+    auto close_file = [&](std::uint32_t file_index) {
+        if (auto it = open_files.find(file_index); it != open_files.end()) {
+            ::close(it->second);
+            open_files.erase(it);
+        }
+    };
+
+    for (;;) {
+        const bool stop = cancelled_.load(std::memory_order_relaxed) || error;
+
+        try {
+            // plan new chunks and acquire a buffer for them
+            while (!stop && !plan_done && window.size() < max_chunks_in_flight) {
+                auto descriptor = planner.next();
+                bytes_read_.fetch_add(planner.take_skipped_bytes(), std::memory_order_relaxed);
+                if (!descriptor) {
+                    plan_done = true;
+                    break;
+                }
+
+                auto& chunk = window.emplace_back(std::make_unique<pending_chunk>(std::move(*descriptor)));
+                if (!chunk->descriptor.has_data) continue;
+
+                chunk->data = pool_.get();
+                chunk->data->resize(chunk->descriptor.size);
+                chunk->requests.reserve(chunk->descriptor.segments.size());
+
+                for (const auto& segment : chunk->descriptor.segments) {
+                    if (segment.zero_fill) {
+                        std::fill_n(std::next(chunk->data->data(), segment.chunk_offset),
+                                    segment.size, std::byte(0));
+                        continue;
+                    }
+                    auto& request = chunk->requests.emplace_back(read_request{chunk.get(), &segment});
+                    backlog.push_back(&request);
+                }
+                chunk->reads_remaining = chunk->requests.size();
+            }
+
+            // submit reads for the planned chunks
+            while (!stop && !backlog.empty() && reads_in_flight < ring.capacity()) {
+                auto* request = backlog.front();
+                const auto& segment = *request->segment;
+                auto fd = get_file_descriptor(segment.file_index);
+
+                ring.prepare_read(fd,
+                        std::next(request->chunk->data->data(), segment.chunk_offset + request->bytes_done),
+                        segment.size - request->bytes_done,
+                        segment.file_offset + request->bytes_done,
+                        reinterpret_cast<std::uint64_t>(request));
+                backlog.pop_front();
+                ++reads_in_flight;
+            }
+
+            // publish completed chunks in order
+            while (!stop && !window.empty() && window.front()->reads_remaining == 0) {
+                auto& chunk = *window.front();
+                push({chunk.descriptor.piece_index, chunk.descriptor.file_index, std::move(chunk.data)});
+
+                // all reads of previous chunks are completed so files that end in this chunk can be closed
+                for (const auto& segment : chunk.descriptor.segments) {
+                    if (segment.file_offset + segment.size == storage[segment.file_index].file_size()) {
+                        close_file(segment.file_index);
+                    }
+                }
+                window.pop_front();
+            }
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        if (reads_in_flight == 0) {
+            if (stop || error || (plan_done && window.empty())) break;
+            continue;
+        }
+
+        // wait for outstanding reads, these must complete before buffers can be released
+        ring.submit_and_wait(1);
+        ring.consume_completions([&](std::uint64_t user_data, std::int32_t result) {
+            --reads_in_flight;
+            auto* request = reinterpret_cast<read_request*>(user_data);
+            const auto& segment = *request->segment;
+
+            if (result <= 0) {
+                if (!error) {
+                    auto message = fmt::format("I/O error reading: {}", storage[segment.file_index].path().string());
+                    error = std::make_exception_ptr(result < 0
+                            ? std::system_error(-result, std::system_category(), message)
+                            : std::system_error(std::make_error_code(std::errc::io_error), message));
+                }
+                return;
+            }
+
+            bytes_read_.fetch_add(result, std::memory_order_relaxed);
+            request->bytes_done += result;
+
+            // resubmit the remaining part of short reads
+            if (request->bytes_done < segment.size) {
+                backlog.push_front(request);
+            }
+            else {
+                --request->chunk->reads_remaining;
+            }
+        });
+    }
+
+    for (auto [file_index, fd] : open_files) {
+        ::close(fd);
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace dottorrent
+
+#endif
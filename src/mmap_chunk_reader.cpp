@@ -0,0 +1,207 @@
+#include "dottorrent/mmap_chunk_reader.hpp"
+
+#ifdef DOTTORRENT_USE_MMAP
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace dottorrent {
+
+namespace {
+
+/// Read-only mapping of a region of a file.
+class file_mapping
+{
+public:
+    file_mapping(int fd, std::size_t offset, std::size_t size)
+            : offset_(offset)
+            , size_(size)
+    {
+        Expects(size_ > 0);
+        address_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(offset_));
+        if (address_ == MAP_FAILED) {
+            throw std::system_error(errno, std::system_category(), "mmap");
+        }
+        // advisory only, failures are ignored
+        ::madvise(address_, size_, MADV_SEQUENTIAL);
+        ::madvise(address_, size_, MADV_WILLNEED);
+    }
+
+    file_mapping(const file_mapping&) = delete;
+    file_mapping& operator=(const file_mapping&) = delete;
+
+    ~file_mapping()
+    {
+        ::munmap(address_, size_);
+    }
+
+    /// Return true if the region [offset, offset+size) of the file is mapped.
+    bool contains(std::size_t offset, std::size_t size) const noexcept
+    {
+        return offset >= offset_ && offset + size <= offset_ + size_;
+    }
+
+    /// Return the mapped bytes of the region [offset, offset+size) of the file.
+    std::span<const std::byte> view(std::size_t offset, std::size_t size) const noexcept
+    {
+        return {static_cast<const std::byte*>(address_) + (offset - offset_), size};
+    }
+
+private:
+    void* address_ = nullptr;
+    std::size_t offset_;
+    std::size_t size_;
+};
+
+/// Owning wrapper for a file descriptor.
+class file_handle
+{
+public:
+    file_handle() = default;
+
+    file_handle(const file_handle&) = delete;
+    file_handle& operator=(const file_handle&) = delete;
+
+    ~file_handle()
+    { close(); }
+
+    void open(const fs::path& path)
+    {
+        close();
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::system_category(), "open");
+        }
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0) {
+            throw std::system_error(errno, std::system_category(), "fstat");
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+    }
+
+    void close() noexcept
+    {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    int fd() const noexcept
+    { return fd_; }
+
+    /// Size of the file on disk when it was opened.
+    std::size_t size() const noexcept
+    { return size_; }
+
+private:
+    int fd_ = -1;
+    std::size_t size_ = 0;
+};
+
+} // namespace
+
+
+mmap_chunk_reader::mmap_chunk_reader(file_storage& storage,
+                                     protocol protocol_version,
+                                     std::size_t block_size,
+                                     std::size_t capacity)
+        : chunk_reader(storage, block_size, capacity)
+        , protocol_(protocol_version)
+{}
+
+void mmap_chunk_reader::run()
+{
+    file_storage& storage = storage_;
+    const auto file_paths = absolute_file_paths(storage);
+    chunk_planner planner(storage, protocol_, chunk_size_);
+
+    const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const auto window_size = std::max(mapping_size, chunk_size_);
+
+    file_handle file {};
+    std::uint32_t open_file_index = std::numeric_limits<std::uint32_t>::max();
+    std::shared_ptr<file_mapping> mapping {};
+
+    // Return the mapping of the window containing segment, map a new window if required.
+    // The previous window stays mapped as long as chunks are viewing it.
+    auto map_segment = [&](const chunk_segment& segment) -> const std::shared_ptr<file_mapping>& {
+        if (segment.file_index != open_file_index) {
+            mapping.reset();
+            open_file_index = std::numeric_limits<std::uint32_t>::max();
+
+            try {
+                file.open(file_paths[segment.file_index]);
+            }
+            catch (const std::system_error& err) {
+                throw std::system_error(err.code(),
+                        fmt::format("I/O error reading: {}", storage[segment.file_index].path().string()));
+            }
+            open_file_index = segment.file_index;
+        }
+
+        // accessing a mapping beyond the end of the file raises SIGBUS
+        if (segment.file_offset + segment.size > file.size()) [[unlikely]] {
+            throw std::runtime_error(
+                    fmt::format("I/O error reading: {}", storage[segment.file_index].path().string()));
+        }
+
+        if (!mapping || !mapping->contains(segment.file_offset, segment.size)) {
+            auto offset = segment.file_offset - segment.file_offset % page_size;
+            auto end = std::min(file.size(), std::max(offset + window_size, segment.file_offset + segment.size));
+            mapping = std::make_shared<file_mapping>(file.fd(), offset, end - offset);
+        }
+        return mapping;
+    };
+
+    while (!cancelled_.load(std::memory_order_relaxed)) {
+        auto descriptor = planner.next();
+        bytes_read_.fetch_add(planner.take_skipped_bytes(), std::memory_order_relaxed);
+        if (!descriptor) break;
+
+        if (!descriptor->has_data) {
+            push({descriptor->piece_index, descriptor->file_index, nullptr});
+            continue;
+        }
+
+        const auto& segments = descriptor->segments;
+        std::shared_ptr<data_type> data;
+
+        if (segments.size() == 1 && !segments.front().zero_fill) {
+            // zero-copy: the chunk views the mapped file region
+            const auto& segment = segments.front();
+            const auto& m = map_segment(segment);
+            data = std::make_shared<data_type>(m->view(segment.file_offset, segment.size), m);
+            bytes_read_.fetch_add(segment.size, std::memory_order_relaxed);
+        }
+        else {
+            data = pool_.get();
+            data->resize(descriptor->size);
+
+            for (const auto& segment : segments) {
+                auto* out = std::next(data->data(), segment.chunk_offset);
+
+                if (segment.zero_fill) {
+                    std::fill_n(out, segment.size, std::byte(0));
+                    continue;
+                }
+                auto in = map_segment(segment)->view(segment.file_offset, segment.size);
+                std::memcpy(out, in.data(), in.size());
+                bytes_read_.fetch_add(segment.size, std::memory_order_relaxed);
+            }
+        }
+
+        push({descriptor->piece_index, descriptor->file_index, std::move(data)});
+    }
+}
+
+} // namespace dottorrent
+
+#endif
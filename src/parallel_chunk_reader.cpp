@@ -0,0 +1,123 @@
+#include "dottorrent/parallel_chunk_reader.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <fmt/format.h>
+
+namespace dottorrent {
+
+parallel_chunk_reader::parallel_chunk_reader(file_storage& storage,
+                                             protocol protocol_version,
+                                             std::size_t block_size,
+                                             std::size_t capacity,
+                                             std::size_t thread_count)
+        : chunk_reader(storage, block_size, capacity)
+        , protocol_(protocol_version)
+        , thread_count_(thread_count)
+{
+    Expects(thread_count_ > 0);
+}
+
+void parallel_chunk_reader::run()
+{
+    planner_.emplace(storage_.get(), protocol_, chunk_size_);
+
+    std::mutex error_mutex {};
+    std::exception_ptr error {};
+    std::vector<std::jthread> workers {};
+
+    for (std::size_t i = 0; i < thread_count_; ++i) {
+        workers.emplace_back([&]() {
+            try {
+                run_worker();
+            }
+            catch (...) {
+                // stop the other workers and report the first error on the reader thread
+                std::unique_lock lck{error_mutex};
+                if (!error) error = std::current_exception();
+                cancelled_.store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void parallel_chunk_reader::run_worker()
+{
+    const file_storage& storage = storage_;
+    const auto file_paths = absolute_file_paths(storage);
+
+    // the file currently opened by this worker
+    std::ifstream f {};
+    std::size_t open_file_index = std::numeric_limits<std::size_t>::max();
+    std::vector<chunk_descriptor> range {};
+
+    while (!cancelled_.load(std::memory_order_relaxed) && claim(range)) {
+        for (const auto& descriptor : range) {
+            if (cancelled_.load(std::memory_order_relaxed)) [[unlikely]] break;
+
+            if (!descriptor.has_data) {
+                push({descriptor.piece_index, descriptor.file_index, nullptr});
+                continue;
+            }
+
+            auto chunk = pool_.get();
+            chunk->resize(descriptor.size);
+
+            for (const auto& segment : descriptor.segments) {
+                auto* out = std::next(chunk->data(), segment.chunk_offset);
+
+                if (segment.zero_fill) {
+                    std::fill_n(out, segment.size, std::byte(0));
+                    continue;
+                }
+                if (segment.file_index != open_file_index) {
+                    f.close();
+                    f.clear();
+                    f.open(file_paths[segment.file_index], std::ios::binary);
+                    f.rdbuf()->pubsetbuf(nullptr, 0);
+                    open_file_index = segment.file_index;
+                }
+
+                f.seekg(static_cast<std::streamoff>(segment.file_offset));
+                f.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(segment.size));
+                bytes_read_.fetch_add(f.gcount(), std::memory_order_relaxed);
+
+                if (static_cast<std::size_t>(f.gcount()) != segment.size) [[unlikely]] {
+                    throw std::runtime_error(
+                            fmt::format("I/O error reading: {}", storage[segment.file_index].path().string()));
+                }
+            }
+            push({descriptor.piece_index, descriptor.file_index, std::move(chunk)});
+        }
+    }
+}
+
+bool parallel_chunk_reader::claim(std::vector<chunk_descriptor>& range)
+{
+    std::unique_lock lck{planner_mutex_};
+    range.clear();
+
+    if (!next_) {
+        next_ = planner_->next();
+    }
+    while (next_) {
+        // v2 chunks are claimed per file
+        if (!range.empty() && protocol_ != protocol::v1 && range.front().file_index != next_->file_index) {
+            break;
+        }
+        range.push_back(std::move(*next_));
+        next_ = (range.size() < max_chunks_per_claim) ? planner_->next() : std::nullopt;
+        if (range.size() == max_chunks_per_claim) break;
+    }
+    bytes_read_.fetch_add(planner_->take_skipped_bytes(), std::memory_order_relaxed);
+    return !range.empty();
+}
+
+} // namespace dottorrent
@@ -0,0 +1,201 @@
+#include "dottorrent/piece_selection.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "dottorrent/utils.hpp"
+
+namespace dottorrent {
+
+double piece_sample_summary::confidence(double corrupt_fraction) const noexcept
+{
+    if (failed != 0 || (verified == piece_count && piece_count != 0)) {
+        return 1;
+    }
+    if (piece_count == 0 || corrupt_fraction <= 0) {
+        return 0;
+    }
+
+    const auto corrupt_pieces = std::max(
+            std::size_t(1), static_cast<std::size_t>(std::ceil(corrupt_fraction * double(piece_count))));
+
+    // probability that none of the verified pieces is one of the corrupt pieces
+    double miss_probability = 1;
+    for (std::size_t i = 0; i < verified; ++i) {
+        if (piece_count - i <= corrupt_pieces) {
+            return 1;
+        }
+        miss_probability *= double(piece_count - corrupt_pieces - i) / double(piece_count - i);
+    }
+    return 1 - miss_probability;
+}
+
+
+piece_selection::piece_selection(const file_storage& storage, protocol protocol_version)
+        : v1_layout_(protocol_version == protocol::v1)
+        , file_failed_(std::make_unique<std::atomic<bool>[]>(storage.file_count()))
+{
+    const auto piece_size = storage.piece_size();
+    file_pieces_.reserve(storage.file_count());
+
+    if (v1_layout_) {
+        // pieces overlapping each file, padding files are part of the pieces of the surrounding files
+        std::size_t offset = 0;
+        for (const auto& entry : storage) {
+            const auto first = offset / piece_size;
+            if (entry.is_padding_file() || entry.file_size() == 0) {
+                file_pieces_.emplace_back(first, first);
+            }
+            else {
+                file_pieces_.emplace_back(first, detail::div_ceil(offset + entry.file_size(), piece_size));
+            }
+            offset += entry.file_size();
+        }
+        selected_.resize(storage.piece_count(), false);
+    }
+    else {
+        // same layout as the result of v2_piece_verifier, files smaller than a piece have a single piece
+        std::size_t offset = 0;
+        for (const auto& entry : storage) {
+            if (entry.is_padding_file()) {
+                file_pieces_.emplace_back(offset, offset);
+                continue;
+            }
+            const auto piece_count = std::max<std::size_t>(1, detail::div_ceil(entry.file_size(), piece_size));
+            file_pieces_.emplace_back(offset, offset + piece_count);
+            offset += piece_count;
+        }
+        selected_.resize(offset, false);
+    }
+}
+
+piece_selection::piece_selection(const file_storage& storage, protocol protocol_version,
+                                 const piece_sampling_options& options)
+        : piece_selection(storage, protocol_version)
+{
+    Expects(options.fraction >= 0 && options.fraction <= 1);
+    options_ = options;
+
+    std::mt19937_64 engine(options.seed ? *options.seed : std::random_device{}());
+    for (const auto& [first, last] : file_pieces_) {
+        select_file_pieces(first, last, engine);
+    }
+}
+
+bool piece_selection::selected(std::size_t index) const noexcept
+{
+    Expects(index < selected_.size());
+    return selected_[index];
+}
+
+bool piece_selection::selected(std::size_t file_index, std::size_t piece_index) const noexcept
+{
+    if (v1_layout_) {
+        return selected(piece_index);
+    }
+
+    Expects(file_index < file_pieces_.size());
+    const auto [first, last] = file_pieces_[file_index];
+    if (first == last) {
+        return false;
+    }
+    // files that fit in a single piece, or a metafile without the piece layer of a file
+    if (last - first == 1) {
+        return selected_[first];
+    }
+    Expects(first + piece_index < last);
+    return selected_[first + piece_index];
+}
+
+void piece_selection::select(std::size_t index) noexcept
+{
+    Expects(index < selected_.size());
+    selected_[index] = true;
+}
+
+std::pair<std::size_t, std::size_t> piece_selection::file_pieces(std::size_t file_index) const noexcept
+{
+    Expects(file_index < file_pieces_.size());
+    return file_pieces_[file_index];
+}
+
+std::size_t piece_selection::selected_count(std::size_t file_index) const noexcept
+{
+    const auto [first, last] = file_pieces(file_index);
+    return std::count(std::next(selected_.begin(), first), std::next(selected_.begin(), last), true);
+}
+
+void piece_selection::mark_failed(std::size_t index) noexcept
+{
+    // ranges are sorted, only the ranges of v1 files that share a piece overlap
+    auto it = std::upper_bound(file_pieces_.begin(), file_pieces_.end(), index,
+                               [](std::size_t i, const auto& range) { return i < range.first; });
+
+    while (it != file_pieces_.begin()) {
+        --it;
+        if (it->first == it->second) {
+            continue;
+        }
+        if (it->second <= index) {
+            break;
+        }
+        file_failed_[std::distance(file_pieces_.begin(), it)].store(true, std::memory_order_relaxed);
+    }
+}
+
+bool piece_selection::file_failed(std::size_t file_index) const noexcept
+{
+    Expects(file_index < file_pieces_.size());
+    return file_failed_[file_index].load(std::memory_order_relaxed);
+}
+
+void piece_selection::select_file_pieces(std::size_t first, std::size_t last, std::mt19937_64& engine)
+{
+    const auto piece_count = last - first;
+    if (piece_count == 0) {
+        return;
+    }
+
+    // the first and last piece are always selected
+    selected_[first] = true;
+    selected_[last - 1] = true;
+    if (piece_count <= 2) {
+        return;
+    }
+
+    const auto target = std::max(options_.count,
+                                 static_cast<std::size_t>(std::ceil(options_.fraction * double(piece_count))));
+    const auto interior_first = first + 1;
+    const auto interior_count = piece_count - 2;
+    const auto sample_count = std::min(interior_count, target > 2 ? target - 2 : 0);
+
+    if (sample_count == 0) {
+        return;
+    }
+
+    if (options_.strategy == sampling_strategy::stratified) {
+        for (std::size_t i = 0; i < sample_count; ++i) {
+            const auto stratum_first = i * interior_count / sample_count;
+            const auto stratum_last = (i + 1) * interior_count / sample_count;
+            std::uniform_int_distribution<std::size_t> dist(stratum_first, stratum_last - 1);
+            selected_[interior_first + dist(engine)] = true;
+        }
+        return;
+    }
+
+    // Floyd's algorithm, draws distinct pieces without a shuffled copy of the range
+    for (std::size_t j = interior_count - sample_count; j < interior_count; ++j) {
+        std::uniform_int_distribution<std::size_t> dist(0, j);
+        const auto t = dist(engine);
+        if (selected_[interior_first + t]) {
+            selected_[interior_first + j] = true;
+        }
+        else {
+            selected_[interior_first + t] = true;
+        }
+    }
+}
+
+} // namespace dottorrent
@@ -0,0 +1,140 @@
+#include "dottorrent/sampled_chunk_reader.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <fmt/format.h>
+
+namespace dottorrent {
+
+sampled_chunk_reader::sampled_chunk_reader(file_storage& storage,
+                                           protocol protocol_version,
+                                           std::size_t block_size,
+                                           std::size_t capacity,
+                                           std::shared_ptr<const piece_selection> selection)
+        : chunk_reader(storage, block_size, capacity)
+        , protocol_(protocol_version)
+        , selection_(std::move(selection))
+{
+    Expects(selection_ != nullptr);
+}
+
+void sampled_chunk_reader::run()
+{
+    const file_storage& storage = storage_;
+    const auto file_paths = absolute_file_paths(storage);
+    const auto piece_size = storage.piece_size();
+    chunk_planner planner(storage_, protocol_, chunk_size_);
+
+    std::ifstream f {};
+    std::size_t open_file_index = std::numeric_limits<std::size_t>::max();
+
+    while (!cancelled_.load(std::memory_order_relaxed)) {
+        auto descriptor = planner.next();
+        if (!descriptor) break;
+
+        if (!descriptor->has_data) {
+            if (selection_->selected(descriptor->file_index, descriptor->piece_index)) {
+                push({descriptor->piece_index, descriptor->file_index, nullptr});
+            }
+            continue;
+        }
+
+        // an empty file [v2] is a chunk without bytes for a single piece
+        const auto piece_count = std::max<std::size_t>(1, detail::div_ceil(descriptor->size, piece_size));
+
+        for (std::size_t first = 0; first < piece_count; ) {
+            if (!selection_->selected(descriptor->file_index, descriptor->piece_index + first)) {
+                ++first;
+                continue;
+            }
+            auto last = first + 1;
+            while (last < piece_count && selection_->selected(descriptor->file_index, descriptor->piece_index + last)) {
+                ++last;
+            }
+
+            const auto run = trim(*descriptor, first, last);
+            first = last;
+            if (skip(run)) {
+                continue;
+            }
+
+            auto chunk = pool_.get();
+            chunk->resize(run.size);
+
+            for (const auto& segment : run.segments) {
+                auto* out = std::next(chunk->data(), segment.chunk_offset);
+
+                if (segment.zero_fill) {
+                    std::fill_n(out, segment.size, std::byte(0));
+                    continue;
+                }
+                if (segment.file_index != open_file_index) {
+                    f.close();
+                    f.clear();
+                    f.open(file_paths[segment.file_index], std::ios::binary);
+                    f.rdbuf()->pubsetbuf(nullptr, 0);
+                    open_file_index = segment.file_index;
+                }
+
+                f.seekg(static_cast<std::streamoff>(segment.file_offset));
+                f.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(segment.size));
+                bytes_read_.fetch_add(f.gcount(), std::memory_order_relaxed);
+
+                if (static_cast<std::size_t>(f.gcount()) != segment.size) [[unlikely]] {
+                    throw std::runtime_error(
+                            fmt::format("I/O error reading: {}", storage[segment.file_index].path().string()));
+                }
+            }
+            push({run.piece_index, run.file_index, std::move(chunk)});
+        }
+    }
+}
+
+chunk_descriptor sampled_chunk_reader::trim(
+        const chunk_descriptor& descriptor, std::size_t first, std::size_t last) const
+{
+    const auto piece_size = storage_.get().piece_size();
+    const auto begin = first * piece_size;
+    const auto end = std::min(last * piece_size, descriptor.size);
+
+    chunk_descriptor run {
+        static_cast<std::uint32_t>(descriptor.piece_index + first),
+        descriptor.file_index,
+        end - begin,
+        true
+    };
+
+    for (const auto& segment : descriptor.segments) {
+        const auto segment_begin = std::max(begin, segment.chunk_offset);
+        const auto segment_end = std::min(end, segment.chunk_offset + segment.size);
+        if (segment_begin >= segment_end) {
+            continue;
+        }
+        if (run.segments.empty()) {
+            run.file_index = segment.file_index;
+        }
+        run.segments.push_back({
+                segment.file_index,
+                segment.file_offset + (segment_begin - segment.chunk_offset),
+                segment_begin - begin,
+                segment_end - segment_begin,
+                segment.zero_fill});
+    }
+    return run;
+}
+
+bool sampled_chunk_reader::skip(const chunk_descriptor& descriptor) const noexcept
+{
+    bool has_file_data = false;
+    for (const auto& segment : descriptor.segments) {
+        if (segment.zero_fill) continue;
+        if (!selection_->file_failed(segment.file_index)) {
+            return false;
+        }
+        has_file_data = true;
+    }
+    return has_file_data || selection_->file_failed(descriptor.file_index);
+}
+
+} // namespace dottorrent
@@ -2,11 +2,10 @@
 // Created by fbdtemme on 9/11/20.
 //
 #include <bit>
+#include <condition_variable>
 
 #include "dottorrent/storage_hasher.hpp"
 
-#include "dottorrent/v1_chunk_reader.hpp"
-#include "dottorrent/v2_chunk_reader.hpp"
 
 #include "dottorrent/v1_chunk_hasher_sb.hpp"
 #include "dottorrent/v1_chunk_hasher_mb.hpp"
@@ -18,6 +17,7 @@
 
 #include <dottorrent/v1_checksum_hasher.hpp>
 #include <dottorrent/v2_checksum_hasher.hpp>
+#include <dottorrent/sampled_chunk_reader.hpp>
 
 
 namespace dottorrent {
@@ -30,6 +30,16 @@ storage_hasher::storage_hasher(file_storage& storage, const storage_hasher_optio
         , io_block_size_()
         , queue_capacity_()
         , enable_multi_buffer_hashing_(options.enable_multi_buffer_hashing)
+        , write_pieces_in_place_(options.write_pieces_in_place)
+        , reader_options_({
+                .type = options.reader,
+                .queue_depth = options.io_queue_depth,
+                .threads = options.reader_threads})
+        , executor_(options.executor)
+        , checkpoint_file_(options.checkpoint_file)
+        , checkpoint_interval_(options.checkpoint_interval)
+        , previous_storage_(options.previous_storage)
+        , unchanged_since_(options.unchanged_since)
 {
     if (storage.piece_size() == 0)
         storage.set_piece_size(choose_piece_size(storage));
@@ -56,6 +66,22 @@ storage_hasher::storage_hasher(file_storage& storage, const storage_hasher_optio
     Expects(protocol_ != dottorrent::protocol::none);
     Expects(std::has_single_bit(storage.piece_size()));    // is a power of 2
 
+    // data of a file that arrives early keeps its chunk buffer until the preceding data is hashed,
+    // which could exhaust the buffers of a reader that reads chunks out of order
+    if (reader_options_.type == reader_type::parallel && !checksums_.empty()) {
+        throw std::invalid_argument("per-file checksums require chunks to be read in order");
+    }
+
+    // pieces that are not restored are read with a reader that seeks to them
+    if ((checkpoint_file_ || previous_storage_) && reader_options_.type != reader_type::sequential) {
+        throw std::invalid_argument("a checkpoint file or previous storage requires the sequential reader");
+    }
+
+    // the checkpoint records the pieces passed to the piece writer
+    if (checkpoint_file_ && write_pieces_in_place_) {
+        throw std::invalid_argument("a checkpoint file requires the pieces to be passed to the piece writer");
+    }
+
     if (protocol_ == protocol::hybrid) {
         // add v1 padding files
         optimize_alignment(storage_);
@@ -96,32 +122,61 @@ void storage_hasher::start() {
 
     auto& storage = storage_.get();
 
-    if (protocol_ == protocol::v1) {
-        reader_ = std::make_unique<v1_chunk_reader>(storage_, io_block_size_, queue_capacity_);
+    // hashes of an interrupted run and of files that did not change since the previous storage was hashed
+    std::shared_ptr<piece_selection> resume_selection {};
+    if (checkpoint_file_ || previous_storage_) {
+        checkpoint_ = std::make_shared<hash_checkpoint>(storage, protocol_);
+        bool restore = false;
+
+        if (checkpoint_file_ && fs::exists(*checkpoint_file_)) {
+            checkpoint_->load(*checkpoint_file_);
+            restore = true;
+        }
+        if (previous_storage_) {
+            unchanged_file_count_ = checkpoint_->add_unchanged_files(storage, *previous_storage_, unchanged_since_);
+            restore = true;
+        }
+        if (restore) {
+            resume_selection = make_resume_selection();
+        }
+    }
+
+    if (resume_selection) {
+        reader_ = std::make_unique<sampled_chunk_reader>(
+                storage, protocol_, io_block_size_, queue_capacity_, resume_selection);
     }
     else {
-        reader_ = std::make_unique<v2_chunk_reader>(storage_, io_block_size_, queue_capacity_);
+        reader_ = make_chunk_reader(storage, protocol_, io_block_size_, queue_capacity_, reader_options_);
     }
 
     if (protocol_ == protocol::v1) {
 #ifdef DOTTORRENT_USE_ISAL
         if (enable_multi_buffer_hashing_)
-            hasher_ = std::make_unique<v1_chunk_hasher_mb>(storage_, queue_capacity_, threads_);
+            hasher_ = std::make_unique<v1_chunk_hasher_mb>(
+                    storage_, queue_capacity_, threads_, write_pieces_in_place_);
         else
-            hasher_ = std::make_unique<v1_chunk_hasher_sb>(storage_, queue_capacity_, threads_);
+            hasher_ = std::make_unique<v1_chunk_hasher_sb>(
+                    storage_, queue_capacity_, threads_, write_pieces_in_place_);
 #else
-        hasher_ = std::make_unique<v1_chunk_hasher_sb>(storage_, queue_capacity_, threads_);
+        hasher_ = std::make_unique<v1_chunk_hasher_sb>(
+                storage_, queue_capacity_, threads_, write_pieces_in_place_);
 #endif
         reader_->register_hash_queue(hasher_->get_queue());
 
         for (auto algo : checksums_) {
-            auto& h = checksum_hashers_.emplace_back(
-                    std::make_unique<v1_checksum_hasher>(storage_, algo, queue_capacity_));
+            auto h = std::make_unique<v1_checksum_hasher>(
+                    storage_, algo, queue_capacity_, threads_, enable_multi_buffer_hashing_);
+            if (checkpoint_) h->set_checkpoint(checkpoint_);
             reader_->register_checksum_queue(h->get_queue());
+            checksum_hashers_.push_back(std::move(h));
         }
 
-        verifier_ = std::make_unique<v1_piece_writer>(storage_, -1, 1);
-        hasher_->register_v1_hashed_piece_queue(verifier_->get_v1_queue());
+        if (!write_pieces_in_place_) {
+            auto writer = std::make_unique<v1_piece_writer>(storage_, -1, 1);
+            if (checkpoint_file_) writer->set_checkpoint(checkpoint_);
+            verifier_ = std::move(writer);
+            hasher_->register_v1_hashed_piece_queue(verifier_->get_v1_queue());
+        }
     }
     else {
 
@@ -139,18 +194,59 @@ void storage_hasher::start() {
         reader_->register_hash_queue(hasher_->get_queue());
 
         for (auto algo : checksums_) {
-            auto& h = checksum_hashers_.emplace_back(
-                    std::make_unique<v2_checksum_hasher>(storage_, algo, queue_capacity_));
+            auto h = std::make_unique<v2_checksum_hasher>(
+                    storage_, algo, queue_capacity_, threads_, enable_multi_buffer_hashing_);
+            if (checkpoint_) h->set_checkpoint(checkpoint_);
             reader_->register_checksum_queue(h->get_queue());
+            checksum_hashers_.push_back(std::move(h));
         }
 
-        verifier_ = std::make_unique<v2_piece_writer>(storage_, -1, protocol_ == protocol::hybrid, 1);
+        auto writer = std::make_unique<v2_piece_writer>(storage_, -1, protocol_ == protocol::hybrid, 1);
+        if (checkpoint_file_) writer->set_checkpoint(checkpoint_);
+        verifier_ = std::move(writer);
         hasher_->register_v1_hashed_piece_queue(verifier_->get_v1_queue());
         hasher_->register_v2_hashed_piece_queue(verifier_->get_v2_queue());
     }
 
+    if (executor_) {
+        hasher_->set_executor(executor_);
+        for (auto& ch : checksum_hashers_) { ch->set_executor(executor_); }
+        reader_->register_push_callback([this]() {
+            hasher_->notify();
+            for (auto& ch : checksum_hashers_) { ch->notify(); }
+        });
+        if (verifier_) {
+            verifier_->set_executor(executor_);
+            hasher_->register_publish_callback([v = verifier_.get()]() { v->notify(); });
+        }
+    }
+
+    if (resume_selection) {
+        restore_checkpoint(*resume_selection);
+    }
+
+    if (checkpoint_file_) {
+        checkpoint_thread_ = std::jthread([this](std::stop_token stop_token) {
+            std::mutex mutex {};
+            std::condition_variable_any cv {};
+            std::unique_lock lck{mutex};
+
+            while (!stop_token.stop_requested()) {
+                // only wakes up early when a stop is requested
+                cv.wait_for(lck, stop_token, checkpoint_interval_, [] { return false; });
+                if (stop_token.stop_requested()) break;
+                try {
+                    checkpoint_->save(*checkpoint_file_);
+                }
+                catch (const std::exception&) {
+                    // the next save retries, a checkpoint is saved again when the hasher is cancelled
+                }
+            }
+        });
+    }
+
     // start all parts
-    verifier_->start();
+    if (verifier_) verifier_->start();
     hasher_->start();
     for (auto& ch : checksum_hashers_) { ch->start(); }
     reader_->start();
@@ -167,20 +263,29 @@ void storage_hasher::cancel() {
         return;
     }
 
-    // cancel all tasks
+    // stop reading first, the reader can be blocked on a full queue until the hashers take its chunks
     reader_->request_cancellation();
+    reader_->wait();
+
+    // cancel all other tasks
     hasher_->request_cancellation();
     for (auto& ch : checksum_hashers_) { ch->request_cancellation(); }
-    verifier_->request_cancellation();
+    if (verifier_) verifier_->request_cancellation();
 
     // wait for all tasks to complete
-    reader_->wait();
     hasher_->wait();
     for (auto& ch : checksum_hashers_) { ch->wait(); }
-    verifier_->wait();
+    if (verifier_) verifier_->wait();
 
+    // all tasks are stopped, even if saving the checkpoint fails
     cancelled_ = true;
     stopped_ = true;
+
+    // all completed hashes are in the checkpoint
+    if (checkpoint_file_) {
+        stop_checkpoint_thread();
+        checkpoint_->save(*checkpoint_file_);
+    }
 }
 
 void storage_hasher::wait()
@@ -202,8 +307,17 @@ void storage_hasher::wait()
     hasher_->wait();
     for (auto& ch : checksum_hashers_) { ch->wait(); }
 
-    verifier_->request_stop();
-    verifier_->wait();
+    if (verifier_) {
+        verifier_->request_stop();
+        verifier_->wait();
+    }
+
+    // all hashes are complete, there is nothing left to resume
+    if (checkpoint_file_) {
+        stop_checkpoint_thread();
+        std::error_code ec {};
+        fs::remove(*checkpoint_file_, ec);
+    }
 
     stopped_ = true;
 }
@@ -235,12 +349,12 @@ std::size_t storage_hasher::bytes_read() const noexcept
 
 std::size_t storage_hasher::bytes_hashed() const noexcept
 {
-    return hasher_->bytes_hashed();
+    return restored_bytes_ + hasher_->bytes_hashed();
 }
 
 std::size_t storage_hasher::bytes_done() const noexcept
 {
-    return hasher_->bytes_done();
+    return restored_bytes_ + hasher_->bytes_done();
 }
 
 
@@ -264,4 +378,125 @@ file_progress_data storage_hasher::current_file_progress() const noexcept
     }
 }
 
+std::size_t storage_hasher::unchanged_file_count() const noexcept
+{
+    return unchanged_file_count_;
+}
+
+void storage_hasher::save_checkpoint() const
+{
+    if (!checkpoint_file_ || !checkpoint_) {
+        throw std::logic_error("no checkpoint file is set or the hasher is not started");
+    }
+    checkpoint_->save(*checkpoint_file_);
+}
+
+std::shared_ptr<piece_selection> storage_hasher::make_resume_selection() const
+{
+    const file_storage& storage = storage_;
+    const auto piece_size = storage.piece_size();
+    auto selection = std::make_shared<piece_selection>(storage, protocol_);
+
+    if (protocol_ == protocol::v1) {
+        // the checksum hashers need all data of files without a complete checksum
+        std::vector<bool> reread(storage.piece_count(), false);
+        for (std::size_t file_index = 0; file_index < storage.file_count(); ++file_index) {
+            if (!missing_checksums(file_index)) continue;
+            const auto [first, last] = selection->file_pieces(file_index);
+            std::fill(std::next(reread.begin(), first), std::next(reread.begin(), last), true);
+        }
+        for (std::size_t i = 0; i < storage.piece_count(); ++i) {
+            if (reread[i] || !checkpoint_->v1_piece(i)) {
+                selection->select(i);
+            }
+        }
+        return selection;
+    }
+
+    // the v1 pieces of a hybrid torrent are aligned to the start of each file
+    std::size_t v1_offset = 0;
+    for (std::size_t file_index = 0; file_index < storage.file_count(); ++file_index) {
+        const auto& entry = storage[file_index];
+        if (entry.is_padding_file()) continue;
+
+        const auto [first, last] = selection->file_pieces(file_index);
+        const bool reread = missing_checksums(file_index);
+        const auto v1_piece_count = detail::div_ceil(entry.file_size(), piece_size);
+
+        for (std::size_t piece_index = 0; piece_index < last - first; ++piece_index) {
+            bool complete = !reread && checkpoint_->v2_piece(file_index, piece_index).has_value();
+            if (complete && protocol_ == protocol::hybrid && piece_index < v1_piece_count) {
+                complete = checkpoint_->v1_piece(v1_offset + piece_index).has_value();
+            }
+            if (!complete) {
+                selection->select(first + piece_index);
+            }
+        }
+        v1_offset += v1_piece_count;
+    }
+    return selection;
+}
+
+void storage_hasher::restore_checkpoint(const piece_selection& selection)
+{
+    file_storage& storage = storage_;
+    const auto piece_size = storage.piece_size();
+
+    // restored pieces are counted like the hashers count the pieces they hash
+    restored_bytes_ = 0;
+
+    if (protocol_ == protocol::v1) {
+        for (std::size_t i = 0; i < storage.piece_count(); ++i) {
+            if (!selection.selected(i)) {
+                storage.set_piece_hash(i, *checkpoint_->v1_piece(i));
+                restored_bytes_ += std::min(piece_size, storage.total_file_size() - i * piece_size);
+            }
+        }
+        return;
+    }
+
+    auto& writer = dynamic_cast<v2_piece_writer&>(*verifier_);
+    std::size_t v1_offset = 0;
+
+    for (std::size_t file_index = 0; file_index < storage.file_count(); ++file_index) {
+        const auto& entry = storage[file_index];
+        if (entry.is_padding_file()) continue;
+
+        const auto [first, last] = selection.file_pieces(file_index);
+        const auto v1_piece_count = detail::div_ceil(entry.file_size(), piece_size);
+
+        for (std::size_t piece_index = 0; piece_index < last - first; ++piece_index) {
+            if (selection.selected(first + piece_index)) continue;
+
+            writer.restore_piece(file_index, piece_index, *checkpoint_->v2_piece(file_index, piece_index));
+            if (const auto offset = piece_index * piece_size; offset < entry.file_size()) {
+                restored_bytes_ += std::min(piece_size, entry.file_size() - offset);
+            }
+            if (protocol_ == protocol::hybrid && piece_index < v1_piece_count) {
+                storage.set_piece_hash(v1_offset + piece_index, *checkpoint_->v1_piece(v1_offset + piece_index));
+            }
+        }
+        v1_offset += v1_piece_count;
+    }
+}
+
+bool storage_hasher::missing_checksums(std::size_t file_index) const
+{
+    const file_storage& storage = storage_;
+    if (storage[file_index].is_padding_file()) {
+        return false;
+    }
+    return std::ranges::any_of(checksums_, [&](hash_function algorithm) {
+        return checkpoint_->get_checksum(file_index, algorithm) == nullptr;
+    });
+}
+
+void storage_hasher::stop_checkpoint_thread()
+{
+    if (checkpoint_thread_.joinable()) {
+        checkpoint_thread_.request_stop();
+        checkpoint_thread_.join();
+    }
+}
+
 } //namespace dottorrent
\ No newline at end of file
@@ -2,8 +2,6 @@
 
 #include "dottorrent/storage_verifier.hpp"
 
-#include "dottorrent/v1_chunk_reader.hpp"
-#include "dottorrent/v2_chunk_reader.hpp"
 
 #include "dottorrent/v1_chunk_hasher_sb.hpp"
 #include "dottorrent/v1_chunk_hasher_mb.hpp"
@@ -11,6 +9,7 @@
 #include "dottorrent/v2_chunk_hasher_mb.hpp"
 #include "dottorrent/v1_piece_verifier.hpp"
 #include "dottorrent/v2_piece_verifier.hpp"
+#include "dottorrent/sampled_chunk_reader.hpp"
 
 
 namespace dottorrent {
@@ -22,6 +21,13 @@ storage_verifier::storage_verifier(file_storage& storage, const storage_verifier
         , io_block_size_()
         , queue_capacity_()
         , enable_multi_buffer_hashing_(options.enable_multi_buffer_hashing)
+        , reader_options_({
+                .type = options.reader,
+                .queue_depth = options.io_queue_depth,
+                .threads = options.reader_threads})
+        , executor_(options.executor)
+        , piece_callback_(options.piece_callback)
+        , sampling_(options.sampling)
 {
     file_storage& st = storage_;
 
@@ -81,11 +87,13 @@ void storage_verifier::start() {
 
     auto& storage = storage_.get();
 
-    if (protocol_ == protocol::v1) {
-        reader_ = std::make_unique<v1_chunk_reader>(storage_, io_block_size_, queue_capacity_);
+    if (sampling_) {
+        selection_ = std::make_shared<piece_selection>(storage, protocol_, *sampling_);
+        reader_ = std::make_unique<sampled_chunk_reader>(
+                storage, protocol_, io_block_size_, queue_capacity_, selection_);
     }
     else {
-        reader_ = std::make_unique<v2_chunk_reader>(storage_, io_block_size_, queue_capacity_);
+        reader_ = make_chunk_reader(storage, protocol_, io_block_size_, queue_capacity_, reader_options_);
     }
 
     if (protocol_ == protocol::v1) {
@@ -122,6 +130,34 @@ void storage_verifier::start() {
         hasher_->register_v2_hashed_piece_queue(verifier_->get_v2_queue());
     }
 
+    if (executor_) {
+        hasher_->set_executor(executor_);
+        verifier_->set_executor(executor_);
+        reader_->register_push_callback([h = hasher_.get()]() { h->notify(); });
+        hasher_->register_publish_callback([v = verifier_.get()]() { v->notify(); });
+    }
+
+    // the selection is laid out by file size, a metafile with piece layers that do not match would
+    // verify different pieces than the ones that are read
+    if (selection_ && selection_->size() != verifier_->result().size()) {
+        throw std::invalid_argument("piece layers do not match the size of the files");
+    }
+
+    if (sampling_ && sampling_->stop_at_first_mismatch) {
+        // the reader skips the remaining pieces of files with a failed piece
+        verifier_->set_piece_callback([s = selection_, callback = piece_callback_](std::size_t index, bool verified) {
+            if (!verified) {
+                s->mark_failed(index);
+            }
+            if (callback) {
+                callback(index, verified);
+            }
+        });
+    }
+    else if (piece_callback_) {
+        verifier_->set_piece_callback(piece_callback_);
+    }
+
     // start all parts
     verifier_->start();
     hasher_->start();
@@ -239,6 +275,11 @@ const std::vector<std::uint8_t>& storage_verifier::result() const noexcept
     return verifier_->result();
 }
 
+const piece_state_map& storage_verifier::piece_states() const noexcept
+{
+    return verifier_->piece_states();
+}
+
 double storage_verifier::percentage(std::size_t file_index) const noexcept
 {
     return verifier_->percentage(file_index);
@@ -255,6 +296,40 @@ double storage_verifier::percentage(const file_entry& entry) const
     return verifier_->percentage(file_index);
 }
 
+bool storage_verifier::sampled() const noexcept
+{
+    return sampling_.has_value();
+}
+
+const piece_selection& storage_verifier::selection() const
+{
+    if (!selection_) {
+        throw std::logic_error("sampling is not enabled or the verifier is not started");
+    }
+    return *selection_;
+}
+
+piece_sample_summary storage_verifier::sample_summary(std::size_t file_index) const
+{
+    const auto& selection = this->selection();
+    const auto& states = piece_states();
+    const auto [first, last] = selection.file_pieces(file_index);
+
+    piece_sample_summary summary {};
+    summary.piece_count = last - first;
+    for (std::size_t i = first; i < last; ++i) {
+        if (!selection.selected(i)) continue;
+        ++summary.sampled;
+
+        switch (states.state(i)) {
+        case piece_state::verified: ++summary.verified; break;
+        case piece_state::failed:   ++summary.failed; break;
+        case piece_state::pending:  break;
+        }
+    }
+    return summary;
+}
+
 storage_verifier::~storage_verifier()
 {
     if (started() && !done()) {
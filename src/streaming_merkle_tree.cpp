@@ -0,0 +1,261 @@
+#include "dottorrent/streaming_merkle_tree.hpp"
+
+#include <bit>
+#include <memory>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "dottorrent/merkle_tree.hpp"
+#include "dottorrent/utils.hpp"
+#include "dottorrent/hasher/factory.hpp"
+#include "dottorrent/hasher/backends/native.hpp"
+
+namespace dottorrent {
+
+namespace {
+
+/// Hash pairs of children into their parents.
+void hash_layer(std::span<const sha256_hash> children, std::span<sha256_hash> parents)
+{
+    if (native::sha256_batches_accelerated()) {
+        native::sha256_inner_nodes(children, parents);
+        return;
+    }
+
+    thread_local auto hasher = make_hasher(hash_function::sha256);
+    for (std::size_t i = 0; i < parents.size(); ++i) {
+        hasher->update(children[2*i]);
+        hasher->update(children[2*i+1]);
+        hasher->finalize_to(parents[i]);
+    }
+}
+
+const sha256_hash& padding_root(std::size_t height)
+{
+    return merkle_tree<hash_function::sha256>::padding_root(height);
+}
+
+/// Return the root of a subtree with the given leaves, the number of leaves must be a power of two.
+/// Leaves after the first `data_leaf_count` are zero padding, their subtrees are taken from the padding table.
+sha256_hash reduce_subtree(std::span<const sha256_hash> leaves, std::size_t data_leaf_count)
+{
+    Expects(std::has_single_bit(leaves.size()));
+    Expects(data_leaf_count <= leaves.size());
+
+    if (data_leaf_count == 0) {
+        return padding_root(detail::log2_floor(leaves.size()));
+    }
+
+    // scratch layers reused by all pieces hashed on this thread
+    thread_local std::vector<sha256_hash> nodes {};
+    thread_local std::vector<sha256_hash> parents {};
+    nodes.assign(leaves.begin(), std::next(leaves.begin(), data_leaf_count));
+
+    for (std::size_t height = 0; (leaves.size() >> height) > 1; ++height) {
+        // pair the last node with the root of a padding subtree
+        if (nodes.size() % 2 == 1) {
+            nodes.push_back(padding_root(height));
+        }
+        parents.resize(nodes.size() / 2);
+        hash_layer(nodes, parents);
+        std::swap(nodes, parents);
+    }
+    return nodes.front();
+}
+
+sha256_hash hash_pair(const sha256_hash& left, const sha256_hash& right)
+{
+    const std::array<sha256_hash, 2> children {left, right};
+    sha256_hash parent {};
+    hash_layer(children, std::span(&parent, 1));
+    return parent;
+}
+
+} // namespace
+
+
+streaming_merkle_tree::streaming_merkle_tree(std::size_t leaf_count, std::size_t piece_leaf_count)
+        : leaf_count_(leaf_count)
+        // same height as merkle_tree, a tree without leaves has two zero leaves
+        , tree_height_(leaf_count != 0 ? detail::log2_ceil(leaf_count) : 1)
+        , piece_width_(std::min(piece_leaf_count, std::size_t(1) << tree_height_))
+        , top_height_(tree_height_ - detail::log2_floor(piece_width_))
+{
+    Expects(std::has_single_bit(piece_leaf_count));
+
+    const auto piece_count = std::max<std::size_t>(1, detail::div_ceil(leaf_count, piece_width_));
+    slots_ = std::vector<piece_slot>(piece_count);
+    pieces_.resize(piece_count);
+}
+
+streaming_merkle_tree::streaming_merkle_tree(streaming_merkle_tree&& other) noexcept
+        : leaf_count_(other.leaf_count_)
+        , tree_height_(other.tree_height_)
+        , piece_width_(other.piece_width_)
+        , top_height_(other.top_height_)
+        , slots_(std::move(other.slots_))
+        , pieces_(std::move(other.pieces_))
+        , next_piece_(other.next_piece_.load(std::memory_order_relaxed))
+        , frontier_(std::move(other.frontier_))
+        , root_(other.root_)
+        , piece_callback_(std::move(other.piece_callback_))
+{}
+
+streaming_merkle_tree::~streaming_merkle_tree()
+{
+    for (auto& slot : slots_) {
+        delete[] slot.leaves.load(std::memory_order_acquire);
+    }
+}
+
+void streaming_merkle_tree::set_piece_callback(piece_callback callback)
+{
+    piece_callback_ = std::move(callback);
+}
+
+bool streaming_merkle_tree::set_leaf(std::size_t index, const sha256_hash& value)
+{
+    Expects(index < (std::size_t(1) << tree_height_));
+    const auto piece_index = index / piece_width_;
+    Expects(piece_index < slots_.size());
+
+    // a piece of a single leaf is the leaf itself
+    if (piece_width_ == 1) {
+        if (piece_callback_) {
+            piece_callback_(piece_index, value);
+        }
+        return set_piece(piece_index, value);
+    }
+
+    auto& slot = slots_[piece_index];
+
+    auto* leaves = slot.leaves.load(std::memory_order_acquire);
+    if (leaves == nullptr) {
+        // leaves after the end of the file are zero
+        auto buffer = std::make_unique<sha256_hash[]>(piece_width_);
+        if (slot.leaves.compare_exchange_strong(leaves, buffer.get(), std::memory_order_acq_rel)) {
+            leaves = buffer.release();
+        }
+    }
+    leaves[index % piece_width_] = value;
+
+    if (slot.leaves_set.fetch_add(1, std::memory_order_acq_rel) + 1 < leaves_in_piece(piece_index)) {
+        return false;
+    }
+
+    // last leaf of the piece, the writes of all other leaves are visible
+    auto buffer = std::unique_ptr<sha256_hash[]>(slot.leaves.exchange(nullptr, std::memory_order_acquire));
+    const auto hash = reduce_subtree(std::span(buffer.get(), piece_width_), leaves_in_piece(piece_index));
+    if (piece_callback_) {
+        piece_callback_(piece_index, hash);
+    }
+    return set_piece(piece_index, hash);
+}
+
+bool streaming_merkle_tree::set_piece_hash(std::size_t piece_index, const sha256_hash& hash)
+{
+    Expects(piece_index < slots_.size());
+    Expects(slots_[piece_index].leaves_set.load(std::memory_order_relaxed) == 0);
+
+    if (piece_callback_) {
+        piece_callback_(piece_index, hash);
+    }
+    return set_piece(piece_index, hash);
+}
+
+void streaming_merkle_tree::finalize()
+{
+    // pieces with missing leaves
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        auto buffer = std::unique_ptr<sha256_hash[]>(slots_[i].leaves.exchange(nullptr, std::memory_order_acquire));
+        if (buffer) {
+            const auto hash = reduce_subtree(std::span(buffer.get(), piece_width_), leaves_in_piece(i));
+            if (piece_callback_) {
+                piece_callback_(i, hash);
+            }
+            set_piece(i, hash);
+        }
+    }
+
+    const auto piece_height = detail::log2_floor(piece_width_);
+
+    // pieces without any leaves
+    for (std::size_t i = next_piece_; i < pieces_.size(); ++i) {
+        if (!slots_[i].done.load(std::memory_order_relaxed)) {
+            if (piece_callback_) {
+                piece_callback_(i, padding_root(piece_height));
+            }
+            set_piece(i, padding_root(piece_height));
+        }
+    }
+
+    // complete the rightmost subtrees with zero subtrees until a single root is left
+    while (frontier_.size() > 1 || frontier_.back().height < top_height_) {
+        auto node = frontier_.back();
+        frontier_.pop_back();
+        push_frontier(node.height + 1, hash_pair(node.hash, padding_root(piece_height + node.height)));
+    }
+
+    Ensures(frontier_.size() == 1);
+    root_ = frontier_.front().hash;
+    frontier_.clear();
+}
+
+std::span<const sha256_hash> streaming_merkle_tree::piece_layer() const noexcept
+{
+    // files that fit in a single piece do not have a piece layer
+    if (top_height_ == 0) {
+        return {};
+    }
+    // an empty file has a zero piece to complete the tree, but no piece hashes
+    return std::span(pieces_).first(detail::div_ceil(leaf_count_, piece_width_));
+}
+
+std::size_t streaming_merkle_tree::leaves_in_piece(std::size_t piece_index) const noexcept
+{
+    // a tree without leaves still has a first leaf that can be set
+    const auto leaf_count = std::max<std::size_t>(leaf_count_, 1);
+    const auto first_leaf = piece_index * piece_width_;
+    if (first_leaf >= leaf_count) {
+        return 0;
+    }
+    return std::min(piece_width_, leaf_count - first_leaf);
+}
+
+bool streaming_merkle_tree::set_piece(std::size_t piece_index, const sha256_hash& hash)
+{
+    Expects(piece_index < pieces_.size());
+    pieces_[piece_index] = hash;
+
+    // Sequentially consistent: either this thread sees that its piece is the first incomplete piece,
+    // or the thread folding the pieces before it sees the done flag after advancing next_piece_.
+    slots_[piece_index].done.store(true);
+    if (next_piece_.load() != piece_index) {
+        return false;
+    }
+
+    std::unique_lock lck{mutex_};
+    auto next = next_piece_.load(std::memory_order_relaxed);
+    if (next == pieces_.size()) {
+        return false;
+    }
+    while (next < pieces_.size() && slots_[next].done.load()) {
+        push_frontier(0, pieces_[next]);
+        next_piece_.store(++next);
+    }
+    return next == pieces_.size();
+}
+
+void streaming_merkle_tree::push_frontier(std::size_t height, const sha256_hash& hash)
+{
+    auto node = frontier_node{height, hash};
+
+    while (!frontier_.empty() && frontier_.back().height == node.height) {
+        node.hash = hash_pair(frontier_.back().hash, node.hash);
+        ++node.height;
+        frontier_.pop_back();
+    }
+    frontier_.push_back(node);
+}
+
+} // namespace dottorrent
@@ -1,59 +1,47 @@
-#include "dottorrent/chunk_hasher_single_buffer.hpp"
 #include "dottorrent/v1_checksum_hasher.hpp"
 
+#include <algorithm>
+
 namespace dottorrent {
 
-v1_checksum_hasher::v1_checksum_hasher(file_storage& storage, hash_function f, std::size_t capacity)
-        : chunk_hasher_single_buffer(storage, {f}, capacity, 1)
+v1_checksum_hasher::v1_checksum_hasher(file_storage& storage, hash_function f, std::size_t capacity,
+                                       std::size_t thread_count, bool enable_multi_buffer_hashing)
+        : checksum_hasher(storage, f, capacity, thread_count, enable_multi_buffer_hashing)
+        , file_end_offsets_(inclusive_file_size_scan_v1(storage))
 {}
 
-void v1_checksum_hasher::hash_chunk(std::vector<std::unique_ptr<single_buffer_hasher>>& hashers, const data_chunk& chunk)
+void v1_checksum_hasher::split_chunk(const data_chunk& chunk, std::vector<file_data_range>& ranges)
 {
-    hash_chunk(*hashers.front(), chunk);
-}
-
-void v1_checksum_hasher::hash_chunk(single_buffer_hasher& hasher, const data_chunk& item) {
-    Expects(item.data != nullptr);
-
-    file_storage& storage = storage_;
+    const file_storage& storage = storage_;
+    const auto data = std::span<const std::byte>(*chunk.data);
+    const auto chunk_begin = std::size_t(chunk.piece_index) * storage.piece_size();
+    const auto chunk_end = chunk_begin + data.size();
+    const auto total_size = file_end_offsets_.empty() ? 0 : file_end_offsets_.back();
 
-    // offset from the start of data where we are currently processing
-    std::size_t chunk_offset = 0;
-    std::size_t chunk_size = item.data->size();
-    std::size_t current_file_size = storage[current_file_index_].file_size();
-    auto data = std::span(*item.data);
+    // first file that ends at or after the start of the chunk
+    auto it = std::lower_bound(file_end_offsets_.begin(), file_end_offsets_.end(), chunk_begin);
 
-    Ensures(current_file_index_ < storage.file_count());
+    for (; it != file_end_offsets_.end(); ++it) {
+        const auto file_index = static_cast<std::size_t>(std::distance(file_end_offsets_.begin(), it));
+        const auto& entry = storage[file_index];
+        const auto file_begin = *it - entry.file_size();
 
-    // Verify that we are receive chunks sequentially
+        // Empty files belong to the chunk that contains their position,
+        // empty files at the end of the torrent to the last chunk.
+        if (file_begin > chunk_end || (file_begin == chunk_end && chunk_end != total_size)) break;
 
-    while (chunk_offset != chunk_size) {
-        auto current_file_data_remaining = current_file_size - current_file_data_hashed_;
-        auto current_chunk_data_remaining = chunk_size-chunk_offset;
-        auto current_file_subchunk_size = std::min(current_file_data_remaining, current_chunk_data_remaining);
+        const auto begin = std::max(file_begin, chunk_begin);
+        const auto end = std::min(*it, chunk_end);
 
-        hasher.update(data.subspan(chunk_offset, current_file_subchunk_size));
-        chunk_offset += current_file_subchunk_size;
+        // file that ends where the chunk starts
+        if (begin == end && entry.file_size() != 0) continue;
 
-        bytes_hashed_.fetch_add(current_file_subchunk_size, std::memory_order_relaxed);
-        bytes_done_.fetch_add(current_file_subchunk_size, std::memory_order_relaxed);
-        current_file_data_hashed_.fetch_add(current_file_subchunk_size, std::memory_order_relaxed);
-
-        // check if we completed a file checksum
-        if (current_file_data_hashed_.load(std::memory_order_relaxed) == current_file_size) {
-            Expects(hash_functions_.size() == 1);
-            auto hash_function = hash_functions_.front();
-            auto checksum = make_checksum(hash_function);
-            hasher.finalize_to(checksum->value());
-            storage[current_file_index_].add_checksum(std::move(checksum));
-
-            current_file_index_.fetch_add(1, std::memory_order_relaxed);
-
-            if (current_file_index_ < storage.file_count()) {
-                current_file_size = storage[current_file_index_].file_size();
-                current_file_data_hashed_.store(0, std::memory_order_relaxed);
-            }
+        if (entry.is_padding_file()) {
+            bytes_done_.fetch_add(end - begin, std::memory_order_relaxed);
+            continue;
         }
+        ranges.push_back({file_index, begin - file_begin, data.subspan(begin - chunk_begin, end - begin)});
     }
 }
+
 } // namespace dottorrent
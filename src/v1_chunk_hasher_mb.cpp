@@ -2,8 +2,10 @@
 
 namespace dottorrent {
 
-v1_chunk_hasher_mb::v1_chunk_hasher_mb(file_storage& storage, std::size_t capacity, std::size_t thread_count)
+v1_chunk_hasher_mb::v1_chunk_hasher_mb(file_storage& storage, std::size_t capacity, std::size_t thread_count,
+        bool write_in_place)
         : base_type(storage, {hash_function::sha1}, capacity, thread_count)
+        , write_in_place_(write_in_place)
 {}
 
 void v1_chunk_hasher_mb::hash_chunk(
@@ -38,23 +40,32 @@ void v1_chunk_hasher_mb::hash_chunk(multi_buffer_hasher& hasher, const data_chun
     hasher.submit(piece_in_block_idx, data.subspan(piece_in_block_idx * piece_size));
 
     sha1_hash piece_hash {};
+    v1_hashed_piece_batch pieces {};
+    pieces.reserve(pieces_in_chunk);
     piece_in_block_idx = 0;
     for (; piece_in_block_idx < pieces_in_chunk; ++piece_in_block_idx) {
         hasher.finalize_to(piece_in_block_idx, piece_hash);
-        process_piece_hash(chunk.piece_index + piece_in_block_idx, chunk.file_index, piece_hash);
+        process_piece_hash(pieces, chunk.piece_index + piece_in_block_idx, chunk.file_index, piece_hash);
     }
+    publish(std::move(pieces));
 
     bytes_done_.fetch_add(data.size(), std::memory_order_relaxed);
     bytes_hashed_.fetch_add(data.size(), std::memory_order_relaxed);
 }
 
 void v1_chunk_hasher_mb::process_piece_hash(
+        v1_hashed_piece_batch& pieces,
         std::size_t piece_idx,
         std::size_t file_idx,
         const sha1_hash& piece_hash)
 {
-    Expects(v1_hashed_piece_queue_);
-    v1_hashed_piece_queue_->push(v1_hashed_piece{.hash=piece_hash, .index=piece_idx});
+    // Each piece index is hashed by exactly one thread, so writes to the preallocated pieces do not race.
+    if (write_in_place_) {
+        file_storage& storage = storage_;
+        storage.set_piece_hash(piece_idx, piece_hash);
+        return;
+    }
+    pieces.push_back(v1_hashed_piece{.hash=piece_hash, .index=piece_idx});
 }
 
 } // namespace dottorrent
@@ -2,8 +2,10 @@
 
 namespace dottorrent
 {
-v1_chunk_hasher_sb::v1_chunk_hasher_sb(file_storage& storage, std::size_t capacity, std::size_t thread_count)
+v1_chunk_hasher_sb::v1_chunk_hasher_sb(file_storage& storage, std::size_t capacity, std::size_t thread_count,
+        bool write_in_place)
         : base_type(storage, {hash_function::sha1}, capacity, thread_count)
+        , write_in_place_(write_in_place)
 {}
 
 void v1_chunk_hasher_sb::hash_chunk(std::vector<std::unique_ptr<single_buffer_hasher>>& hashers, const data_chunk& chunk)
@@ -28,12 +30,14 @@ void v1_chunk_hasher_sb::hash_chunk(single_buffer_hasher& hasher, const data_chu
 
     Expects(pieces_in_chunk >= 1);
     sha1_hash piece_hash{};
+    v1_hashed_piece_batch pieces {};
+    pieces.reserve(pieces_in_chunk);
 
     std::size_t piece_in_block_idx = 0;
     for (; piece_in_block_idx < pieces_in_chunk - 1; ++piece_in_block_idx) {
         hasher.update(data.subspan(piece_size * piece_in_block_idx, piece_size));
         hasher.finalize_to(piece_hash);
-        process_piece_hash(chunk.piece_index + piece_in_block_idx, chunk.file_index, piece_hash);
+        process_piece_hash(pieces, chunk.piece_index + piece_in_block_idx, chunk.file_index, piece_hash);
         bytes_done_.fetch_add(piece_size, std::memory_order_relaxed);
     }
 
@@ -41,19 +45,26 @@ void v1_chunk_hasher_sb::hash_chunk(single_buffer_hasher& hasher, const data_chu
     auto final_piece = data.subspan(piece_in_block_idx * piece_size);
     hasher.update(final_piece);
     hasher.finalize_to(piece_hash);
-    process_piece_hash(chunk.piece_index + piece_in_block_idx, chunk.file_index, piece_hash);
+    process_piece_hash(pieces, chunk.piece_index + piece_in_block_idx, chunk.file_index, piece_hash);
+    publish(std::move(pieces));
     bytes_done_.fetch_add(final_piece.size(), std::memory_order_relaxed);
 
     bytes_hashed_.fetch_add(chunk.data->size(), std::memory_order_relaxed);
 }
 
 void v1_chunk_hasher_sb::process_piece_hash(
+        v1_hashed_piece_batch& pieces,
         std::size_t piece_idx,
         std::size_t file_idx,
         const sha1_hash& piece_hash)
 {
-    Expects(v1_hashed_piece_queue_);
-    v1_hashed_piece_queue_->push(v1_hashed_piece{.hash=piece_hash, .index=piece_idx});
+    // Each piece index is hashed by exactly one thread, so writes to the preallocated pieces do not race.
+    if (write_in_place_) {
+        file_storage& storage = storage_;
+        storage.set_piece_hash(piece_idx, piece_hash);
+        return;
+    }
+    pieces.push_back(v1_hashed_piece{.hash=piece_hash, .index=piece_idx});
 }
 
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "dottorrent/v1_chunk_reader.hpp"
+#include "dottorrent/file_readahead.hpp"
 
 #include <fmt/format.h>
 #include <fstream>
@@ -17,7 +18,10 @@ void v1_chunk_reader::run()
     chunk_ = pool_.get();
     chunk_->resize(chunk_size_);
 
+    file_readahead readahead(std::max(file_readahead::default_window_size, 2 * chunk_size_));
+
     for (const fs::path& file_path: file_paths) {
+        if (cancelled_.load(std::memory_order_relaxed)) [[unlikely]] break;
         const file_entry& file_entry = storage.at(file_index_);
 
         // handle pieces if the file does not exists. Used when verifying torrents.
@@ -31,6 +35,8 @@ void v1_chunk_reader::run()
         storage.set_last_modified_time(file_index_, fs::last_write_time(file_path));
         f_.open(file_path, std::ios::binary);
         f_.rdbuf()->pubsetbuf(nullptr, 0);
+        readahead.open(file_path, file_entry.file_size(), next_file_path(file_paths, file_index_));
+        std::size_t file_offset = 0;
         // increment file index, file_index points to the next file now
         ++ file_index_;
 
@@ -40,7 +46,9 @@ void v1_chunk_reader::run()
             );
             file_offsets_.push_back(chunk_offset_);
             chunk_offset_ += f_.gcount();
+            file_offset += f_.gcount();
             bytes_read_.fetch_add(f_.gcount(), std::memory_order_relaxed);
+            readahead.advance(file_offset);
 
             if (chunk_offset_ == chunk_size_) [[likely]] {
                 // push chunk to consumers
@@ -67,7 +75,14 @@ void v1_chunk_reader::run()
         }
         f_.close();
         f_.clear();
+        readahead.close();
+    }
+    // the last chunk of a cancelled reader is incomplete and its pieces do not have to be hashed
+    if (cancelled_.load(std::memory_order_relaxed)) [[unlikely]] {
+        chunk_.reset();
+        return;
     }
+
     // push last possibly partial chunk
     if (chunk_offset_ != 0) [[likely]] {
         chunk_->resize(chunk_offset_);
@@ -141,13 +156,4 @@ void v1_chunk_reader::handle_missing_file()
 }
 
 
-void v1_chunk_reader::push(const data_chunk& data_chunk) {
-    for (auto& queue : hash_queues_) {
-        queue->push(data_chunk);
-    }
-    for (auto& queue: checksum_queues_) {
-        queue->push(data_chunk);
-    }
-}
-
 } // namespace dottorrent
\ No newline at end of file
@@ -8,7 +8,10 @@ v1_piece_verifier::v1_piece_verifier(
         , processor_(capacity)
         , piece_map_(storage.piece_count(), false)
 {
-    processor_.set_work_function([this](const v1_hashed_piece& p) { this->verify_finished_piece(p); });
+    piece_states_ = piece_state_map(piece_map_.size());
+    processor_.set_work_function([this](const v1_hashed_piece_batch& batch) {
+        for (const auto& p : batch) { this->verify_finished_piece(p); }
+    });
     processor_.set_max_concurrency(max_concurrency);
 }
 
@@ -48,6 +51,16 @@ bool v1_piece_verifier::done() const noexcept
     return processor_.done();
 }
 
+void v1_piece_verifier::set_executor(std::shared_ptr<executor> executor)
+{
+    processor_.set_executor(std::move(executor));
+}
+
+void v1_piece_verifier::notify()
+{
+    processor_.notify();
+}
+
 std::shared_ptr<hashed_piece_processor::v1_piece_queue_type> v1_piece_verifier::get_v1_queue() {
     return processor_.get_queue();
 }
@@ -68,8 +81,7 @@ double v1_piece_verifier::percentage(std::size_t file_index) const noexcept {
     if (number_of_pieces == 0) [[unlikely]]
         return 100;
 
-    auto n_complete_pieces = std::count(std::next(piece_map_.begin(), first),
-            std::next(piece_map_.begin(), last), 1);
+    auto n_complete_pieces = piece_states_.count_verified(first, last);
     return double(n_complete_pieces) / double(number_of_pieces) * 100;
 }
 
@@ -77,7 +89,9 @@ void v1_piece_verifier::verify_finished_piece(const v1_hashed_piece& piece) {
     file_storage& storage = storage_;
     Expects(piece.index < storage.piece_count());
     const auto& real_hash = storage.get_piece_hash(piece.index);
-    piece_map_[piece.index] = (real_hash == piece.hash);
+    const bool verified = (real_hash == piece.hash);
+    piece_map_[piece.index] = verified;
+    publish_piece(piece.index, verified);
 }
 
 }
\ No newline at end of file
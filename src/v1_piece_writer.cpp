@@ -7,7 +7,9 @@ v1_piece_writer::v1_piece_writer(file_storage& storage, std::size_t capacity, st
         , processor_(capacity)
 {
     processor_.set_max_concurrency(max_concurrency);
-    processor_.set_work_function([this](const v1_hashed_piece& p) { this->set_finished_piece(p); });
+    processor_.set_work_function([this](const v1_hashed_piece_batch& batch) {
+        for (const auto& p : batch) { this->set_finished_piece(p); }
+    });
 }
 
 void v1_piece_writer::start() {
@@ -46,6 +48,16 @@ bool v1_piece_writer::done() const noexcept
     return processor_.done();
 }
 
+void v1_piece_writer::set_executor(std::shared_ptr<executor> executor)
+{
+    processor_.set_executor(std::move(executor));
+}
+
+void v1_piece_writer::notify()
+{
+    processor_.notify();
+}
+
 std::shared_ptr<v1_piece_writer::v1_piece_queue_type> v1_piece_writer::get_v1_queue() {
     return processor_.get_queue();
 }
@@ -54,8 +66,16 @@ std::shared_ptr<v1_piece_writer::v2_piece_queue_type> v1_piece_writer::get_v2_qu
     throw std::logic_error("not implemented");
 }
 
+void v1_piece_writer::set_checkpoint(std::shared_ptr<hash_checkpoint> checkpoint)
+{
+    checkpoint_ = std::move(checkpoint);
+}
+
 void v1_piece_writer::set_finished_piece(const v1_hashed_piece& finished_piece) {
     file_storage& storage = storage_.get();
     storage.set_piece_hash(finished_piece.index, finished_piece.hash);
+    if (checkpoint_) {
+        checkpoint_->add_v1_piece(finished_piece.index, finished_piece.hash);
+    }
 }
 }
\ No newline at end of file
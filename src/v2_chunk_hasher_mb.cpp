@@ -1,9 +1,15 @@
+#include <array>
+
 #include <gsl-lite/gsl-lite.hpp>
 #include "dottorrent/hashed_piece.hpp"
+#include "dottorrent/hasher/backends/native.hpp"
 #include "dottorrent/v2_chunk_hasher_mb.hpp"
 
 namespace dottorrent {
 
+// number of leaves hashed per call of the leaf block kernel
+constexpr std::size_t leaf_batch_size = 64;
+
 v2_chunk_hasher_mb::v2_chunk_hasher_mb(file_storage& storage, std::size_t capacity, bool v1_compatible, std::size_t thread_count)
         : chunk_hasher_multi_buffer(storage, {hash_function::sha1, hash_function::sha256}, capacity, thread_count)
         , add_v1_compatibility_(v1_compatible)
@@ -47,99 +53,166 @@ void v2_chunk_hasher_mb::hash_chunk(multi_buffer_hasher& sha256_hasher, multi_bu
         return;
     }
 
-    file_entry& entry = storage[chunk.file_index];
-    const auto piece_size = storage.piece_size();
-    const auto pieces_in_chunk = (chunk.data->size() + piece_size - 1) / piece_size;
-    // number of 16 KiB blocks in a chunk
-    const auto blocks_in_chunk = (chunk.data->size() + v2_block_size -1) / v2_block_size;
-    // index of first 16 KiB block in the per file merkle tree
-    const auto index_offset = chunk.piece_index * piece_size / v2_block_size;
     const auto data = std::span(*chunk.data);
 
-    sha256_hasher.resize(blocks_in_chunk);
+    // chunk with multiple small files, the blocks of all files are hashed in a single batch
+    if (chunk.parts) {
+        std::vector<file_data> files {};
+        files.reserve(chunk.parts->size());
+        for (const auto& part : *chunk.parts) {
+            files.push_back({0, part.file_index, data.subspan(part.offset, part.size)});
+        }
+        hash_file_data(sha256_hasher, sha1_hasher, files);
+        return;
+    }
+
+    const file_data file {chunk.piece_index, chunk.file_index, data};
+    hash_file_data(sha256_hasher, sha1_hasher, std::span(&file, 1));
+}
+
+void v2_chunk_hasher_mb::hash_file_data(multi_buffer_hasher& sha256_hasher, multi_buffer_hasher& sha1_hasher,
+        std::span<const file_data> files)
+{
+    file_storage& storage = storage_.get();
+    const auto piece_size = storage.piece_size();
+
+    // Number of 16 KiB blocks in the data of a file.
+    // An empty file has a single empty block, identical to the single buffer hasher.
+    auto block_count = [](const file_data& file) {
+        return std::max<std::size_t>(1, (file.data.size() + v2_block_size - 1) / v2_block_size);
+    };
+
+    // Complete blocks are hashed in batches by the leaf block kernel when it is accelerated,
+    // only the final partial block of each file is submitted to the multi-buffer hasher.
+    const bool use_leaf_kernel = native::sha256_batches_accelerated();
+    auto batched_block_count = [&](const file_data& file) -> std::size_t {
+        return use_leaf_kernel ? file.data.size() / v2_block_size : 0;
+    };
+
+    std::size_t total_blocks = 0;
+    std::size_t total_jobs = 0;
+    for (const auto& file : files) {
+        total_blocks += block_count(file);
+        total_jobs += block_count(file) - batched_block_count(file);
+    }
 
-    std::size_t block_in_chunk_idx = 0;
-    if (blocks_in_chunk > 0) {
-        for ( ; block_in_chunk_idx < blocks_in_chunk-1; ++block_in_chunk_idx) {
-            sha256_hasher.submit(block_in_chunk_idx, data.subspan(block_in_chunk_idx * v2_block_size, v2_block_size));
+    sha256_hasher.resize(total_jobs);
+
+    std::size_t job_idx = 0;
+    for (const auto& file : files) {
+        // last block can be smaller then v2_block_size
+        for (std::size_t block_idx = batched_block_count(file); block_idx < block_count(file); ++block_idx) {
+            sha256_hasher.submit(job_idx++, file.data.subspan(block_idx * v2_block_size).first(
+                    std::min(v2_block_size, file.data.size() - block_idx * v2_block_size)));
         }
-        // last chunk can be smaller then v2_block_size
-        sha256_hasher.submit(block_in_chunk_idx, data.subspan(block_in_chunk_idx*v2_block_size));
     }
 
+    v2_hashed_piece_batch leaves {};
+    leaves.reserve(total_blocks);
     sha256_hash leaf {};
-    block_in_chunk_idx = 0;
-    for ( ; blocks_in_chunk != 0 && block_in_chunk_idx < blocks_in_chunk; ++block_in_chunk_idx) {
-        sha256_hasher.finalize_to(block_in_chunk_idx, leaf);
-        process_piece_hash(index_offset + block_in_chunk_idx, chunk.file_index, leaf);
-        bytes_hashed_.fetch_add(v2_block_size);
+    std::array<sha256_hash, leaf_batch_size> batch {};
+    job_idx = 0;
+    for (const auto& file : files) {
+        const auto blocks_in_file_data = block_count(file);
+        const auto batched_blocks = batched_block_count(file);
+        // index of first 16 KiB block in the per file merkle tree
+        const auto index_offset = file.piece_index * piece_size / v2_block_size;
+
+        std::size_t block_idx = 0;
+        while (block_idx < batched_blocks) {
+            const auto n = std::min(batch.size(), batched_blocks - block_idx);
+            native::sha256_leaf_blocks(file.data.subspan(block_idx * v2_block_size, n * v2_block_size),
+                                       std::span(batch).first(n));
+            for (std::size_t j = 0; j < n; ++j) {
+                process_piece_hash(leaves, index_offset + block_idx + j, file.file_index, batch[j]);
+            }
+            bytes_hashed_.fetch_add(n * v2_block_size);
+            block_idx += n;
+        }
+
+        for (; block_idx < blocks_in_file_data; ++block_idx) {
+            sha256_hasher.finalize_to(job_idx++, leaf);
+            process_piece_hash(leaves, index_offset + block_idx, file.file_index, leaf);
+            bytes_hashed_.fetch_add(v2_block_size);
+        }
     }
 
-    block_in_chunk_idx = 0;
+    publish(std::move(leaves));
 
     if (add_v1_compatibility_) {
         std::vector<std::byte> padding {};
-        // v1 compatibility data
-        bool needs_padding = chunk.data->size() % piece_size != 0;
-        std::size_t pieces_to_process = 0;
-
-        // process the complete pieces of the chunk
-        if  (!needs_padding) {
-            pieces_to_process = pieces_in_chunk;
-        } else {
-            // last piece needs padding or is the last piece of the file
-            pieces_to_process = pieces_in_chunk != 0 ? pieces_in_chunk-1: 0;
-        }
 
-        sha1_hasher.resize(pieces_in_chunk);
-        std::size_t piece_in_chunk_index = 0;
-        for (; piece_in_chunk_index < pieces_to_process; ++piece_in_chunk_index)
-        {
-            sha1_hasher.submit(piece_in_chunk_index, data.subspan(piece_size * piece_in_chunk_index, piece_size));
+        std::size_t total_pieces = 0;
+        for (const auto& file : files) {
+            total_pieces += (file.data.size() + piece_size - 1) / piece_size;
         }
+        sha1_hasher.resize(total_pieces);
 
-        // we have an incomplete final piece so we have the last piece of a file.
-        // we need to pad with zeros in case it is not the last file in the torrent
-        if (needs_padding) {
-            auto final_piece = data.subspan(piece_in_chunk_index * piece_size);
-
-            if (chunk.file_index+1 < storage.file_count()-1) {
-                const auto& entry = storage.at(chunk.file_index+1);
-                Expects(entry.is_padding_file());
-                // add the final partial piece and pad the rest of the piece
-                padding.resize((piece_size-final_piece.size()), std::byte{0});
-                sha1_hasher.submit_first(piece_in_chunk_index, final_piece);
-                sha1_hasher.submit_last(piece_in_chunk_index, padding);
+        // v1 compatibility data
+        job_idx = 0;
+        for (const auto& file : files) {
+            const auto pieces_in_file_data = (file.data.size() + piece_size - 1) / piece_size;
+            bool needs_padding = file.data.size() % piece_size != 0;
+            // process the complete pieces, the last piece needs padding or is the last piece of the file
+            std::size_t pieces_to_process = needs_padding ? pieces_in_file_data - 1 : pieces_in_file_data;
+
+            std::size_t piece_idx = 0;
+            for (; piece_idx < pieces_to_process; ++piece_idx) {
+                sha1_hasher.submit(job_idx++, file.data.subspan(piece_size * piece_idx, piece_size));
             }
-            else {
-                sha1_hasher.submit(piece_in_chunk_index, final_piece);
+
+            // we have an incomplete final piece so we have the last piece of a file.
+            // we need to pad with zeros in case it is not the last file in the torrent
+            if (needs_padding) {
+                auto final_piece = file.data.subspan(piece_idx * piece_size);
+
+                if (file.file_index+1 < storage.file_count()-1) {
+                    const auto& entry = storage.at(file.file_index+1);
+                    Expects(entry.is_padding_file());
+                    // add the final partial piece and pad the rest of the piece
+                    padding.resize(piece_size, std::byte{0});
+                    sha1_hasher.submit_first(job_idx, final_piece);
+                    sha1_hasher.submit_last(job_idx, std::span(padding).first(piece_size - final_piece.size()));
+                }
+                else {
+                    sha1_hasher.submit(job_idx, final_piece);
+                }
+                ++job_idx;
             }
         }
 
+        v1_hashed_piece_batch pieces {};
+        pieces.reserve(total_pieces);
         sha1_hash piece_hash {};
-        std::size_t total_jobs = pieces_in_chunk;
-        piece_in_chunk_index = 0;
-        for (; piece_in_chunk_index < total_jobs; ++piece_in_chunk_index)
-        {
-            sha1_hasher.finalize_to(piece_in_chunk_index, piece_hash);
-            process_piece_hash(chunk.piece_index + piece_in_chunk_index, chunk.file_index, piece_hash);
+        job_idx = 0;
+        for (const auto& file : files) {
+            const auto pieces_in_file_data = (file.data.size() + piece_size - 1) / piece_size;
+
+            for (std::size_t piece_idx = 0; piece_idx < pieces_in_file_data; ++piece_idx) {
+                sha1_hasher.finalize_to(job_idx++, piece_hash);
+                process_piece_hash(pieces, file.piece_index + piece_idx, file.file_index, piece_hash);
+            }
+            bytes_hashed_.fetch_add(file.data.size(), std::memory_order::relaxed);
         }
-        bytes_hashed_.fetch_add(chunk.data->size(), std::memory_order::relaxed);
+        publish(std::move(pieces));
+    }
+
+    for (const auto& file : files) {
+        bytes_done_.fetch_add(file.data.size(), std::memory_order_relaxed);
     }
-    bytes_done_.fetch_add(chunk.data->size(), std::memory_order_relaxed);
 }
 
-void v2_chunk_hasher_mb::process_piece_hash(std::size_t piece_idx, std::size_t file_index, const sha1_hash& piece_hash)
+void v2_chunk_hasher_mb::process_piece_hash(v1_hashed_piece_batch& pieces, std::size_t piece_idx,
+        std::size_t file_index, const sha1_hash& piece_hash)
 {
-    Expects(v1_hashed_piece_queue_);
     auto global_piece_index = v1_piece_offsets_[file_index] + piece_idx;
-    v1_hashed_piece_queue_->push(v1_hashed_piece{.hash=piece_hash, .index=global_piece_index});
+    pieces.push_back(v1_hashed_piece{.hash=piece_hash, .index=global_piece_index});
 }
 
-void v2_chunk_hasher_mb::process_piece_hash(std::size_t leaf_index, std::size_t file_index, const sha256_hash& piece_hash)
+void v2_chunk_hasher_mb::process_piece_hash(v2_hashed_piece_batch& leaves, std::size_t leaf_index,
+        std::size_t file_index, const sha256_hash& piece_hash)
 {
-    Expects(v2_hashed_piece_queue_);
-    v2_hashed_piece_queue_->push(v2_hashed_piece{.hash=piece_hash, .file_index=file_index, .leaf_index=leaf_index});
+    leaves.push_back(v2_hashed_piece{.hash=piece_hash, .file_index=file_index, .leaf_index=leaf_index});
 }
 
 } // namepspace dottorrent
\ No newline at end of file
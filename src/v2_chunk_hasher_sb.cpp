@@ -1,9 +1,15 @@
+#include <array>
+
 #include <gsl-lite/gsl-lite.hpp>
 #include "dottorrent/hashed_piece.hpp"
+#include "dottorrent/hasher/backends/native.hpp"
 #include "dottorrent/v2_chunk_hasher_sb.hpp"
 
 namespace dottorrent {
 
+// number of leaves hashed per call of the leaf block kernel
+constexpr std::size_t leaf_batch_size = 64;
+
 v2_chunk_hasher_sb::v2_chunk_hasher_sb(file_storage& storage, std::size_t capacity, bool v1_compatible, std::size_t thread_count)
         : chunk_hasher_single_buffer(storage, {hash_function::sha1, hash_function::sha256}, capacity, thread_count)
         , add_v1_compatibility_(v1_compatible)
@@ -47,31 +53,74 @@ void v2_chunk_hasher_sb::hash_chunk(single_buffer_hasher& sha256_hasher, single_
         return;
     }
 
-    file_entry& entry = storage[chunk.file_index];
+    const auto data = std::span(*chunk.data);
+    v1_hashed_piece_batch pieces {};
+    v2_hashed_piece_batch leaves {};
+
+    // chunk with multiple small files
+    if (chunk.parts) {
+        for (const auto& part : *chunk.parts) {
+            hash_file_data(sha256_hasher, sha1_hasher, pieces, leaves,
+                           0, part.file_index, data.subspan(part.offset, part.size));
+        }
+    }
+    else {
+        hash_file_data(sha256_hasher, sha1_hasher, pieces, leaves, chunk.piece_index, chunk.file_index, data);
+    }
+
+    publish(std::move(pieces));
+    publish(std::move(leaves));
+}
+
+void v2_chunk_hasher_sb::hash_file_data(single_buffer_hasher& sha256_hasher, single_buffer_hasher& sha1_hasher,
+        v1_hashed_piece_batch& pieces, v2_hashed_piece_batch& leaves,
+        std::size_t piece_index, std::size_t file_index, std::span<const std::byte> data)
+{
+    file_storage& storage = storage_.get();
     const auto piece_size = storage.piece_size();
-    const auto pieces_in_chunk = detail::div_ceil(chunk.data->size(), piece_size);
+    const auto pieces_in_chunk = detail::div_ceil(data.size(), piece_size);
     // number of 16 KiB blocks in a chunk
-    const auto blocks_in_chunk = detail::div_ceil(chunk.data->size(), v2_block_size);
+    const auto blocks_in_chunk = detail::div_ceil(data.size(), v2_block_size);
     // index of first 16 KiB block in the per file merkle tree
-    const auto index_offset = chunk.piece_index * piece_size / v2_block_size;
-    const auto data = std::span(*chunk.data);
+    const auto index_offset = piece_index * piece_size / v2_block_size;
 
     sha256_hash leaf{};
+    leaves.reserve(leaves.size() + std::max<std::size_t>(blocks_in_chunk, 1));
 
     std::size_t i = 0;
-    for (; blocks_in_chunk != 0 && i < blocks_in_chunk-1; ++i) {
-        sha256_hasher.update(data.subspan(i*v2_block_size, v2_block_size));
-        sha256_hasher.finalize_to(leaf);
-        process_piece_hash(index_offset+i, chunk.file_index, leaf);
-        bytes_hashed_.fetch_add(v2_block_size);
+    if (native::sha256_batches_accelerated()) {
+        // all complete blocks are hashed in batches without per block hasher state
+        const auto complete_blocks = data.size() / v2_block_size;
+        std::array<sha256_hash, leaf_batch_size> batch {};
+
+        while (i < complete_blocks) {
+            const auto n = std::min(batch.size(), complete_blocks-i);
+            native::sha256_leaf_blocks(data.subspan(i*v2_block_size, n*v2_block_size), std::span(batch).first(n));
+            for (std::size_t j = 0; j < n; ++j) {
+                process_piece_hash(leaves, index_offset+i+j, file_index, batch[j]);
+            }
+            bytes_hashed_.fetch_add(n*v2_block_size);
+            i += n;
+        }
+    }
+    else {
+        for (; blocks_in_chunk != 0 && i < blocks_in_chunk-1; ++i) {
+            sha256_hasher.update(data.subspan(i*v2_block_size, v2_block_size));
+            sha256_hasher.finalize_to(leaf);
+            process_piece_hash(leaves, index_offset+i, file_index, leaf);
+            bytes_hashed_.fetch_add(v2_block_size);
+        }
     }
 
     // last block can be smaller then the block size!
-    auto final_block = data.subspan(i*v2_block_size);
-    sha256_hasher.update(final_block);
-    sha256_hasher.finalize_to(leaf);
-    bytes_hashed_.fetch_add(final_block.size());
-    process_piece_hash(index_offset+i, chunk.file_index, leaf);
+    // An empty file has a single empty block.
+    if (i < blocks_in_chunk || blocks_in_chunk == 0) {
+        auto final_block = data.subspan(i*v2_block_size);
+        sha256_hasher.update(final_block);
+        sha256_hasher.finalize_to(leaf);
+        bytes_hashed_.fetch_add(final_block.size());
+        process_piece_hash(leaves, index_offset+i, file_index, leaf);
+    }
 //
 //    // Update per file progress and check if this thread did just finish the last chunk of
 //    // this file. Make sure to propagate memory effects so set_piece_layers sees all
@@ -85,7 +134,7 @@ void v2_chunk_hasher_sb::hash_chunk(single_buffer_hasher& sha256_hasher, single_
         // v1 compatibility data
         sha1_hash piece_hash{};
 
-        bool needs_padding = chunk.data->size() % piece_size != 0;
+        bool needs_padding = data.size() % piece_size != 0;
         std::size_t pieces_to_process = 0;
 
         // process the complete pieces of the chunk
@@ -101,15 +150,15 @@ void v2_chunk_hasher_sb::hash_chunk(single_buffer_hasher& sha256_hasher, single_
         for (; piece_in_chunk_index < pieces_to_process; ++piece_in_chunk_index) {
             sha1_hasher.update(data.subspan(piece_size*piece_in_chunk_index, piece_size));
             sha1_hasher.finalize_to(piece_hash);
-            process_piece_hash(chunk.piece_index+piece_in_chunk_index, chunk.file_index, piece_hash);
+            process_piece_hash(pieces, piece_index+piece_in_chunk_index, file_index, piece_hash);
             bytes_hashed_.fetch_add(piece_size, std::memory_order_relaxed);
         }
 
         // we have an incomplete final piece so we have the last piece of a file.
         // we need to pad with zeros in case it is not the last file in the torrent
         if (needs_padding) {
-            if (chunk.file_index+1 < storage.file_count()-1) {
-                const auto& entry = storage.at(chunk.file_index+1);
+            if (file_index+1 < storage.file_count()-1) {
+                const auto& entry = storage.at(file_index+1);
                 Expects(entry.is_padding_file());
                 // add the final partial piece and pad the rest of the piece
                 auto final_piece = data.subspan(piece_in_chunk_index*piece_size);
@@ -123,32 +172,32 @@ void v2_chunk_hasher_sb::hash_chunk(single_buffer_hasher& sha256_hasher, single_
                 }
 
                 sha1_hasher.finalize_to(piece_hash);
-                process_piece_hash(chunk.piece_index+piece_in_chunk_index, chunk.file_index, piece_hash);
+                process_piece_hash(pieces, piece_index+piece_in_chunk_index, file_index, piece_hash);
                 bytes_hashed_.fetch_add(final_piece.size()+padding_size, std::memory_order::relaxed);
             }
             else {
                 auto final_piece = data.subspan(piece_in_chunk_index*piece_size);
                 sha1_hasher.update(final_piece);
                 sha1_hasher.finalize_to(piece_hash);
-                process_piece_hash(chunk.piece_index+piece_in_chunk_index, chunk.file_index, piece_hash);
+                process_piece_hash(pieces, piece_index+piece_in_chunk_index, file_index, piece_hash);
                 bytes_hashed_.fetch_add(final_piece.size(), std::memory_order::relaxed);
             }
         }
     }
-    bytes_done_.fetch_add(chunk.data->size(), std::memory_order_relaxed);
+    bytes_done_.fetch_add(data.size(), std::memory_order_relaxed);
 }
 
-void v2_chunk_hasher_sb::process_piece_hash(std::size_t piece_idx, std::size_t file_index, const sha1_hash& piece_hash)
+void v2_chunk_hasher_sb::process_piece_hash(v1_hashed_piece_batch& pieces, std::size_t piece_idx,
+        std::size_t file_index, const sha1_hash& piece_hash)
 {
-    Expects(v1_hashed_piece_queue_);
     auto global_piece_index = v1_piece_offsets_[file_index] + piece_idx;
-    v1_hashed_piece_queue_->push(v1_hashed_piece{.hash=piece_hash, .index=global_piece_index});
+    pieces.push_back(v1_hashed_piece{.hash=piece_hash, .index=global_piece_index});
 }
 
-void v2_chunk_hasher_sb::process_piece_hash(std::size_t leaf_index, std::size_t file_index, const sha256_hash& piece_hash)
+void v2_chunk_hasher_sb::process_piece_hash(v2_hashed_piece_batch& leaves, std::size_t leaf_index,
+        std::size_t file_index, const sha256_hash& piece_hash)
 {
-    Expects(v2_hashed_piece_queue_);
-    v2_hashed_piece_queue_->push(v2_hashed_piece{.hash=piece_hash, .file_index=file_index, .leaf_index=leaf_index});
+    leaves.push_back(v2_hashed_piece{.hash=piece_hash, .file_index=file_index, .leaf_index=leaf_index});
 }
 
 } // namepspace dottorrent
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "dottorrent/v2_chunk_reader.hpp"
+#include "dottorrent/file_readahead.hpp"
 
 #include <fstream>
 #include <fmt/format.h>
@@ -16,6 +17,8 @@ void v2_chunk_reader::run()
     auto chunk = pool_.get();
     chunk->resize(chunk_size_);
 
+    file_readahead readahead(std::max(file_readahead::default_window_size, 2 * chunk_size_));
+
     for (const fs::path& file_path: file_paths) {
         const file_entry& file_entry = storage.at(file_index_);
 
@@ -27,6 +30,8 @@ void v2_chunk_reader::run()
 
         // handle pieces if the file does not exists. Used when verifying torrents.
         if (!fs::exists(file_path)) {
+            // keep files in order for the checksum hashers
+            push_packed_chunk();
             auto file_size = file_entry.file_size();
             push({static_cast<std::uint32_t>(0),
                   static_cast<std::uint32_t>(file_index_),
@@ -38,8 +43,23 @@ void v2_chunk_reader::run()
 
         // set last modified date in the file entry of the storage
         storage.set_last_modified_time(file_index_, fs::last_write_time(file_path));
+
+        // Small files are packed together in a single chunk.
+        // They are read with a single read call, readahead would only add an open and close per file.
+        // Files that changed size are read as usual so that their hashes do not match.
+        if (const auto file_size = file_entry.file_size(); file_size < chunk_size_) {
+            if (cancelled_.load(std::memory_order_relaxed)) break;
+
+            if (read_packed_file(file_path, file_size)) {
+                ++file_index_;
+                continue;
+            }
+        }
+        push_packed_chunk();
+
         f_.open(file_path, std::ios::binary);
         f_.rdbuf()->pubsetbuf(nullptr, 0);
+        readahead.open(file_path, file_entry.file_size(), next_file_path(file_paths, file_index_));
         // reset piece index. piece index is per file for v2!
         piece_index_ = 0;
 
@@ -47,8 +67,13 @@ void v2_chunk_reader::run()
             f_.read(reinterpret_cast<char*>(chunk->data()), chunk_size_);
             current_chunk_size_ = f_.gcount();
 
+            // The file size is a multiple of the chunk size and all data has already been pushed.
+            // Only empty files are published as a chunk without bytes.
+            if (current_chunk_size_ == 0 && piece_index_ != 0) [[unlikely]] break;
+
             chunk->resize(current_chunk_size_);
             bytes_read_.fetch_add(current_chunk_size_, std::memory_order_relaxed);
+            readahead.advance(piece_index_ * piece_size + current_chunk_size_);
 
             // push chunk to consumers
             push({static_cast<std::uint32_t>(piece_index_),
@@ -70,21 +95,63 @@ void v2_chunk_reader::run()
         }
         f_.close();
         f_.clear();
+        readahead.close();
         ++file_index_;
     }
+    push_packed_chunk();
 }
 
+bool v2_chunk_reader::read_packed_file(const fs::path& file_path, std::size_t file_size)
+{
+    if (packed_size_ + file_size > chunk_size_) {
+        push_packed_chunk();
+    }
+    if (!packed_chunk_) {
+        packed_chunk_ = pool_.get();
+        packed_chunk_->resize(chunk_size_);
+        packed_parts_ = std::make_shared<std::vector<data_chunk_part>>();
+    }
 
-void v2_chunk_reader::push(const data_chunk& chunk) {
-    Expects(chunk.piece_index < storage_.get().piece_count());
+    f_.open(file_path, std::ios::binary);
+    f_.rdbuf()->pubsetbuf(nullptr, 0);
+    f_.read(reinterpret_cast<char*>(std::next(packed_chunk_->data(), packed_size_)), file_size);
+
+    // the data is only appended when the file ends exactly at `file_size`
+    const bool same_size = static_cast<std::size_t>(f_.gcount()) == file_size
+                        && f_.peek() == std::ifstream::traits_type::eof();
+    f_.close();
+    f_.clear();
+    if (!same_size) return false;
+
+    packed_parts_->push_back({static_cast<std::uint32_t>(file_index_), packed_size_, file_size});
+    packed_size_ += file_size;
+    bytes_read_.fetch_add(file_size, std::memory_order_relaxed);
+    return true;
+}
+
+void v2_chunk_reader::push_packed_chunk()
+{
+    if (!packed_chunk_) return;
+
+    packed_chunk_->resize(packed_size_);
+    const auto first_file_index = packed_parts_->front().file_index;
 
-    // hasher queues
-    for (auto& queue : hash_queues_) {
-        queue->push(chunk);
+    // a single file starts at the beginning of the chunk and is published as a regular chunk
+    if (packed_parts_->size() == 1) {
+        push({0, first_file_index, std::move(packed_chunk_)});
     }
-    for (auto& queue: checksum_queues_) {
-        queue->push(chunk);
+    else {
+        push({0, first_file_index, std::move(packed_chunk_), std::move(packed_parts_)});
     }
+    packed_chunk_.reset();
+    packed_parts_.reset();
+    packed_size_ = 0;
+}
+
+
+void v2_chunk_reader::push(const data_chunk& chunk) {
+    Expects(chunk.piece_index < storage_.get().piece_count());
+    chunk_reader::push(chunk);
 }
 
 }
\ No newline at end of file
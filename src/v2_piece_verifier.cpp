@@ -2,6 +2,29 @@
 
 namespace dottorrent {
 
+namespace {
+
+/// Return true if the piece layer of a file hashes to its pieces root.
+/// Files that fit in a single piece have no piece layer and are checked against the root directly.
+bool piece_layer_matches_root(const file_entry& entry, std::size_t piece_size)
+{
+    const auto layer = entry.piece_layer();
+    if (layer.empty()) {
+        return true;
+    }
+
+    // the piece layer is padded with the roots of piece-sized subtrees of zero leaves
+    const auto piece_height = detail::log2_floor(piece_size / v2_block_size);
+    merkle_tree<hash_function::sha256> tree(layer.size(), merkle_tree<hash_function::sha256>::padding_root(piece_height));
+    for (std::size_t i = 0; i < layer.size(); ++i) {
+        tree.set_leaf(i, layer[i]);
+    }
+    tree.update();
+    return tree.root() == entry.pieces_root();
+}
+
+} // namespace
+
 v2_piece_verifier::v2_piece_verifier(dottorrent::file_storage& storage, std::size_t capacity,
         std::size_t max_concurrency)
         : storage_(storage)
@@ -13,11 +36,21 @@ v2_piece_verifier::v2_piece_verifier(dottorrent::file_storage& storage, std::siz
     initialize_offsets_and_trees();
 
     processor_.set_max_concurrency(max_concurrency);
-    processor_.set_work_function([this](const v2_hashed_piece& p) { this->verify_finished_piece(p); });
+    processor_.set_work_function([this](const v2_hashed_piece_batch& batch) {
+        for (const auto& p : batch) { this->verify_finished_piece(p); }
+    });
 }
 
 void v2_piece_verifier::start()
 {
+    // no piece of a file with an untrusted piece layer is compared, all of them fail
+    for (auto file_index : untrusted_files_) {
+        const auto first_piece = file_offsets_[file_index];
+        const auto piece_count = std::max(std::size_t(1), storage_.get()[file_index].piece_layer().size());
+        for (std::size_t i = first_piece; i < first_piece + piece_count; ++i) {
+            publish_piece(i, false);
+        }
+    }
     processor_.start();
 }
 
@@ -55,6 +88,16 @@ bool v2_piece_verifier::done() const noexcept
     return processor_.done();
 }
 
+void v2_piece_verifier::set_executor(std::shared_ptr<executor> executor)
+{
+    processor_.set_executor(std::move(executor));
+}
+
+void v2_piece_verifier::notify()
+{
+    processor_.notify();
+}
+
 std::shared_ptr<v2_piece_verifier::v1_piece_queue_type> v2_piece_verifier::get_v1_queue() {
     return nullptr;
 }
@@ -90,38 +133,49 @@ double v2_piece_verifier::percentage(std::size_t file_index) const noexcept {
                 return std::max(std::size_t(1), e.piece_layer().size());
             });
 
-    auto n_complete_pieces = std::count(
-            std::next(piece_map_.begin(), first_piece_map_index),
-            std::next(piece_map_.begin(), first_piece_map_index+number_of_pieces), 1);
+    auto n_complete_pieces = piece_states_.count_verified(
+            first_piece_map_index, first_piece_map_index+number_of_pieces);
 
     return double(n_complete_pieces) / double(number_of_pieces) * 100;
 }
 
 void v2_piece_verifier::initialize_offsets_and_trees() {
-    // SHA265 hash of 16 KiB of zero bytes.
     file_storage& storage = storage_;
-    std::size_t file_count = 0;
     std::size_t piece_size = storage.piece_size();
 
     Expects(piece_size >= v2_block_size);
     Expects(piece_size % v2_block_size == 0);
 
+    const auto piece_leaf_count = piece_size / v2_block_size;
+    merkle_trees_.reserve(storage.file_count());
     file_offsets_.push_back(0);
 
     for (const auto& entry : storage) {
-        ++file_count;
         auto block_count = (entry.file_size() + v2_block_size -1) / v2_block_size;
         if (entry.is_padding_file()) {
             // add en empty merkly tree to make sure file_indices match merkle tree indices.
-            merkle_trees_.emplace_back();
+            merkle_trees_.emplace_back(0, piece_leaf_count);
             auto offset = file_offsets_.back();
             file_offsets_.back() = std::numeric_limits<std::size_t>::max();
             file_offsets_.push_back(offset);
         }
         else {
-            auto& m = merkle_trees_.emplace_back(block_count);
+            auto& m = merkle_trees_.emplace_back(block_count, piece_leaf_count);
             auto offset = std::max(std::size_t(1), entry.piece_layer().size());
 
+            // Pieces are compared with the piece layer as soon as their leaves are hashed.
+            // A piece layer that does not match the root cannot be trusted, all pieces of the file fail.
+            // Files larger than a piece without a piece layer can only be verified against the root.
+            const auto file_index = merkle_trees_.size() - 1;
+            if (!piece_layer_matches_root(entry, piece_size)) {
+                untrusted_files_.push_back(file_index);
+            }
+            else if (!requires_root(file_index)) {
+                m.set_piece_callback([this, file_index](std::size_t piece_index, const sha256_hash& hash) {
+                    verify_piece(file_index, piece_index, hash);
+                });
+            }
+
             // get the offset of the last non-padding file
             std::size_t previous_offset = 0;
             // check if last offset is a padding file
@@ -137,8 +191,6 @@ void v2_piece_verifier::initialize_offsets_and_trees() {
         }
     }
 
-    file_blocks_hashed_ = decltype(file_blocks_hashed_)(file_count);
-
     auto piece_map_size = 0;
     for (const auto& entry : storage) {
         if (entry.is_padding_file())
@@ -155,81 +207,54 @@ void v2_piece_verifier::initialize_offsets_and_trees() {
         }
     }
     piece_map_.resize(piece_map_size);
+    piece_states_ = piece_state_map(piece_map_size);
 }
 
 void v2_piece_verifier::verify_finished_piece(const v2_hashed_piece& finished_piece) {
-#ifdef DOTTORRENT_USE_ISAL
-    static thread_local std::unique_ptr<multi_buffer_hasher> hasher = make_multi_buffer_hasher(hash_function::sha256);
-#else
-    static thread_local std::unique_ptr<single_buffer_hasher> hasher = make_hasher(hash_function::sha256);
-#endif
-
     file_storage& storage = storage_;
-    file_entry& entry = storage[finished_piece.file_index];
+    const file_entry& entry = storage[finished_piece.file_index];
     auto& tree = merkle_trees_[finished_piece.file_index];
-    auto& file_progress = file_blocks_hashed_[finished_piece.file_index];
 
-    tree.set_leaf(finished_piece.leaf_index, finished_piece.hash);
+    // the subtree of a piece is hashed and verified when its last leaf is set
+    bool all_pieces_hashed = tree.set_leaf(finished_piece.leaf_index, finished_piece.hash);
 
-    // If this was the last leaf node we can complete this file by setting the piece_layers and root.
-    auto num_blocks_in_file = detail::div_ceil(entry.file_size(), 16_KiB);
-
-    auto tmp = file_progress.fetch_add(1, std::memory_order_acq_rel);
-    if (num_blocks_in_file <= (tmp + 1)) [[unlikely]] {
-        verify_piece_layers_and_root(*hasher, finished_piece.file_index);
+    if (all_pieces_hashed && requires_root(finished_piece.file_index)) [[unlikely]] {
+        tree.finalize();
+        std::size_t entry_index = file_offsets_[finished_piece.file_index];
+        Expects(entry_index < piece_map_.size());
+        const bool verified = (tree.root() == entry.pieces_root());
+        piece_map_[entry_index] = verified;
+        publish_piece(entry_index, verified);
     }
 }
 
-template<typename HasherType>
-void v2_piece_verifier::verify_piece_layers_and_root(HasherType& hasher, std::size_t file_index) {
-    file_storage& storage = storage_;
-    std::size_t piece_size = storage.piece_size();
-
-    auto& tree = merkle_trees_[file_index];
-
-    // complete the merkle tree
-    tree.update(hasher);
-
-    // the depth in the tree of hashes covering blocks of size `piece_size`
-    auto layer_offset = detail::log2_floor(piece_size) - detail::log2_floor(v2_block_size);
-
-    // verify the root hash
-    file_entry& entry = storage.at(file_index);
-    std::size_t entry_index = file_offsets_.at(file_index);
-
-    bool whole_file_complete = entry.pieces_root() == tree.root();
-    bool is_single_piece_file = entry.piece_layer().size() == 0;
-
+bool v2_piece_verifier::requires_root(std::size_t file_index) const noexcept {
+    const file_storage& storage = storage_;
+    const auto& tree = merkle_trees_[file_index];
+    const auto piece_height = detail::log2_floor(storage.piece_size() / v2_block_size);
+    return storage[file_index].piece_layer().empty() && tree.tree_height() > piece_height;
+}
 
-    if (whole_file_complete) {
-        if (is_single_piece_file) {
-            Expects(entry_index < piece_map_.size());
-            piece_map_[entry_index] = 1;
-        }
-        else {
-            std::fill_n(std::next(piece_map_.begin(), entry_index), entry.piece_layer().size(), 1);
-        }
+void v2_piece_verifier::verify_piece(std::size_t file_index, std::size_t piece_index, const sha256_hash& hash) {
+    file_storage& storage = storage_;
+    const file_entry& entry = storage[file_index];
+    std::size_t entry_index = file_offsets_[file_index];
+
+    // files smaller than the piece size have a single piece with the root as hash
+    auto reference_layer = entry.piece_layer();
+    if (reference_layer.empty()) {
+        Expects(entry_index < piece_map_.size());
+        const bool verified = (hash == entry.pieces_root());
+        piece_map_[entry_index] = verified;
+        publish_piece(entry_index, verified);
+        return;
     }
-    else {
-        if (is_single_piece_file) {
-            Expects(entry_index < piece_map_.size());
-            piece_map_[entry_index] = 0;
-        }
-        else {
-
-            // leaf nodes necessary to balance the tree are not included in the piece layers
-            std::size_t layer_depth = tree.tree_height() - layer_offset;
-            auto layer_view = tree.get_layer(layer_depth);
-            auto layer_data_nodes_size = (entry.file_size() + piece_size - 1 ) / piece_size;
-            layer_view = layer_view.subspan(0, layer_data_nodes_size);
-            auto reference_layer_view = entry.piece_layer();
-
-            std::size_t max_offset = std::min(layer_view.size(), reference_layer_view.size());
 
-            for (std::size_t i = 0; i < max_offset; ++i, ++entry_index) {
-                piece_map_[entry_index] = (layer_view[i] == reference_layer_view[i]);
-            }
-        }
+    // leaf nodes necessary to balance the tree are not included in the piece layers
+    if (piece_index < reference_layer.size()) {
+        const bool verified = (hash == reference_layer[piece_index]);
+        piece_map_[entry_index + piece_index] = verified;
+        publish_piece(entry_index + piece_index, verified);
     }
 }
 
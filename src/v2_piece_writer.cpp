@@ -13,10 +13,14 @@ v2_piece_writer::v2_piece_writer(file_storage& storage, std::size_t capacity, bo
     initialize_trees(storage);
     if (add_v1_compatibility_) {
         v1_processor_.set_max_concurrency(max_concurrency);
-        v1_processor_.set_work_function([this](const v1_hashed_piece& p) { this->set_finished_piece(p); });
+        v1_processor_.set_work_function([this](const v1_hashed_piece_batch& batch) {
+            for (const auto& p : batch) { this->set_finished_piece(p); }
+        });
     }
     v2_processor_.set_max_concurrency(max_concurrency);
-    v2_processor_.set_work_function([this](const v2_hashed_piece& p) { this->set_finished_piece(p); });
+    v2_processor_.set_work_function([this](const v2_hashed_piece_batch& batch) {
+        for (const auto& p : batch) { this->set_finished_piece(p); }
+    });
 }
 
 void v2_piece_writer::start() {
@@ -75,6 +79,18 @@ bool v2_piece_writer::done() const noexcept
     return res;
 }
 
+void v2_piece_writer::set_executor(std::shared_ptr<executor> executor)
+{
+    v1_processor_.set_executor(executor);
+    v2_processor_.set_executor(std::move(executor));
+}
+
+void v2_piece_writer::notify()
+{
+    if (add_v1_compatibility_) v1_processor_.notify();
+    v2_processor_.notify();
+}
+
 std::shared_ptr<v2_piece_writer::v1_piece_queue_type> v2_piece_writer::get_v1_queue() {
     if (add_v1_compatibility_) return v1_processor_.get_queue();
     return nullptr;
@@ -84,27 +100,61 @@ std::shared_ptr<v2_piece_writer::v2_piece_queue_type> v2_piece_writer::get_v2_qu
     return v2_processor_.get_queue();
 }
 
+void v2_piece_writer::set_checkpoint(std::shared_ptr<hash_checkpoint> checkpoint)
+{
+    checkpoint_ = std::move(checkpoint);
+    const file_storage& storage = storage_;
+
+    for (std::size_t file_index = 0; file_index < merkle_trees_.size(); ++file_index) {
+        if (storage[file_index].is_padding_file()) continue;
+        merkle_trees_[file_index].set_piece_callback(
+                [c = checkpoint_.get(), file_index](std::size_t piece_index, const sha256_hash& hash) {
+            c->add_v2_piece(file_index, piece_index, hash);
+        });
+    }
+}
+
+void v2_piece_writer::restore_piece(std::size_t file_index, std::size_t piece_index, const sha256_hash& hash)
+{
+    file_storage& storage = storage_;
+    const auto& entry = storage[file_index];
+    auto& tree = merkle_trees_[file_index];
+
+    tree.set_piece_hash(piece_index, hash);
+
+    // the leaves of the piece count as hashed
+    const std::size_t piece_leaf_count = storage.piece_size() / v2_block_size;
+    const std::size_t num_blocks_in_file = detail::div_ceil(entry.file_size(), v2_block_size);
+    const auto first_block = piece_index * piece_leaf_count;
+    const auto blocks_in_piece = std::min(piece_leaf_count, num_blocks_in_file - std::min(first_block, num_blocks_in_file));
+
+    auto tmp = file_blocks_hashed_[file_index].fetch_add(blocks_in_piece, std::memory_order_acq_rel);
+    if (num_blocks_in_file <= tmp + blocks_in_piece) {
+        set_piece_layers_and_root(storage, file_index);
+    }
+}
+
 void v2_piece_writer::initialize_trees(const file_storage& storage) {
     auto piece_size = storage.piece_size();
-    // SHA265 hash of 16 KiB of zero bytes.
+    auto piece_leaf_count = piece_size / v2_block_size;
     std::size_t file_count = 0;
+    merkle_trees_.reserve(storage.file_count());
 
     for (const auto& entry : storage) {
         ++ file_count;
         auto block_count = (entry.file_size() + v2_block_size - 1 ) / v2_block_size;
         if (entry.is_padding_file()) {
             // add en empty merkly tree to make sure file_indices match merkle tree indices.
-            merkle_trees_.emplace_back();
+            merkle_trees_.emplace_back(0, piece_leaf_count);
         }
         else {
-            merkle_trees_.emplace_back(block_count);
+            merkle_trees_.emplace_back(block_count, piece_leaf_count);
         }
     }
     file_blocks_hashed_ = decltype(file_blocks_hashed_)(file_count);
 }
 
-template<typename HasherType>
-void v2_piece_writer::set_piece_layers_and_root(file_storage& storage, HasherType& hasher, std::size_t file_index)
+void v2_piece_writer::set_piece_layers_and_root(file_storage& storage, std::size_t file_index)
 {
     std::size_t piece_size = storage.piece_size();
 
@@ -113,47 +163,27 @@ void v2_piece_writer::set_piece_layers_and_root(file_storage& storage, HasherTyp
 
     auto& tree = merkle_trees_[file_index];
 
-    // complete the merkle tree
-    tree.update(hasher);
-
-    // the depth in the tree of hashes covering blocks of size `piece_size`
-    auto layer_offset = detail::log2_floor(piece_size) - detail::log2_floor(v2_block_size);
+    // fold the last pieces into the root
+    tree.finalize();
 
     // set root hash
     file_entry& entry = storage.at(file_index);
     entry.set_pieces_root(tree.root());
 
-    // files smaller then piece size have empty piece_layers
-    if (layer_offset >= tree.tree_height()) {
-        entry.set_piece_layer({});
-        return;
-    }
-
-    std::size_t layer_depth = tree.tree_height() - layer_offset;
-
+    // files smaller then piece size have empty piece_layers,
     // leaf nodes necessary to balance the tree are not included in the piece layers
-    auto layer_view = tree.get_layer(layer_depth);
-    auto layer_data_nodes_size = (entry.file_size() + piece_size - 1 ) / piece_size;
-
-    if (layer_view.size() != layer_data_nodes_size) {
-        layer_view = layer_view.subspan(0, layer_data_nodes_size);
-    }
-
-    entry.set_piece_layer(layer_view);
+    entry.set_piece_layer(tree.piece_layer());
 }
 
 void v2_piece_writer::set_finished_piece(const v1_hashed_piece& finished_piece) {
     file_storage& storage = storage_.get();
     storage.set_piece_hash(finished_piece.index, finished_piece.hash);
+    if (checkpoint_) {
+        checkpoint_->add_v1_piece(finished_piece.index, finished_piece.hash);
+    }
 }
 
 void v2_piece_writer::set_finished_piece(const v2_hashed_piece& finished_piece) {
-#ifdef DOTTORRENT_USE_ISAL
-    static thread_local std::unique_ptr<multi_buffer_hasher> hasher = make_multi_buffer_hasher(hash_function::sha256);
-#else
-    static thread_local std::unique_ptr<single_buffer_hasher> hasher = make_hasher(hash_function::sha256);
-#endif
-
     file_storage& storage = storage_;
     file_entry& entry = storage[finished_piece.file_index];
     auto& tree = merkle_trees_[finished_piece.file_index];
@@ -166,7 +196,7 @@ void v2_piece_writer::set_finished_piece(const v2_hashed_piece& finished_piece)
 
     auto tmp = file_progress.fetch_add(1, std::memory_order_acq_rel);
     if (num_blocks_in_file <= (tmp + 1)) [[unlikely]] {
-        set_piece_layers_and_root(storage, *hasher, finished_piece.file_index);
+        set_piece_layers_and_root(storage, finished_piece.file_index);
     }
 }
 
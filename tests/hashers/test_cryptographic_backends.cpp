@@ -27,4 +27,7 @@ TEST_CASE("test crypto backends versions")
 #if defined(DOTTORRENT_USE_WINCNG)
     CHECK(versions.contains("wincng"));
 #endif
+#if defined(DOTTORRENT_USE_NATIVE)
+    CHECK(versions.contains("native"));
+#endif
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #include "dottorrent/hasher/factory.hpp"
 #include "dottorrent/hash.hpp"
+#include "dottorrent/checksum.hpp"
 
 namespace dt = dottorrent;
 namespace fs = std::filesystem;
@@ -49,3 +50,31 @@ TEST_CASE("sha1")
 
     CHECK(out1 == reference);
 }
+
+TEST_CASE("multi-buffer digests match single buffer digests")
+{
+    auto algorithm = GENERATE(dt::hash_function::md5, dt::hash_function::sha1,
+                              dt::hash_function::sha256, dt::hash_function::sha512);
+    auto reference_hasher = dt::make_hasher(algorithm);
+    auto h = dt::make_multi_buffer_hasher(algorithm);
+
+    // No multibuffer support
+    if (h == nullptr) return;
+
+    std::ifstream ifs(fs::path(TEST_DIR)/"resources"/"CAMELYON17.torrent", std::ios::binary);
+    std::string buffer(std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{});
+
+    reference_hasher->update(buffer);
+    auto reference = dt::make_checksum(algorithm);
+    reference_hasher->finalize_to(reference->value());
+
+    h->resize(2);
+    h->submit(0, buffer);
+    h->submit(1, std::string_view(buffer).substr(0, 100));
+
+    auto out = dt::make_checksum(algorithm);
+    auto other = dt::make_checksum(algorithm);
+    h->finalize_to(0, out->value());
+    h->finalize_to(1, other->value());
+    CHECK(out->hex_string() == reference->hex_string());
+}
@@ -0,0 +1,325 @@
+#include <array>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include "dottorrent/hasher/factory.hpp"
+#include "dottorrent/hasher/native_hasher.hpp"
+#include "dottorrent/hasher/native_multi_buffer_hasher.hpp"
+#include "dottorrent/hash.hpp"
+#include "dottorrent/checksum.hpp"
+
+#include "hasher/backends/native_kernels.hpp"
+
+namespace dt = dottorrent;
+namespace native = dottorrent::native;
+
+namespace {
+
+std::vector<std::byte> random_bytes(std::size_t size)
+{
+    std::mt19937 rng(size);
+    std::vector<std::byte> data(size);
+    for (auto& b : data) {
+        b = static_cast<std::byte>(rng());
+    }
+    return data;
+}
+
+// lengths around the block boundaries and the position of the message length
+constexpr std::array message_lengths = {
+        0UL, 1UL, 55UL, 56UL, 63UL, 64UL, 65UL, 111UL, 112UL, 127UL, 128UL, 129UL, 1000UL, 16384UL, 100003UL
+};
+
+}
+
+TEST_CASE("native hashers")
+{
+    SECTION("known digests") {
+        std::string_view s = "test";
+        dt::sha1_hash sha1_out;
+        dt::sha256_hash sha256_out;
+        dt::md5_hash md5_out;
+        dt::sha512_hash sha512_out;
+
+        std::unique_ptr<dt::single_buffer_hasher> h = std::make_unique<dt::native_hasher>(dt::hash_function::sha1);
+        h->finalize_to(sha1_out);
+        CHECK(sha1_out.hex_string() == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+
+        h = std::make_unique<dt::native_hasher>(dt::hash_function::sha256);
+        h->update(s);
+        h->finalize_to(sha256_out);
+        CHECK(sha256_out.hex_string() == "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08");
+
+        h = std::make_unique<dt::native_hasher>(dt::hash_function::md5);
+        h->update(s);
+        h->finalize_to(md5_out);
+        CHECK(md5_out.hex_string() == "098f6bcd4621d373cade4e832627b4f6");
+
+        h = std::make_unique<dt::native_hasher>(dt::hash_function::sha512);
+        h->update(std::string_view("abc"));
+        h->finalize_to(sha512_out);
+        CHECK(sha512_out.hex_string() ==
+              "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+              "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f");
+    }
+
+    SECTION("match the configured backend") {
+        auto algorithm = GENERATE(dt::hash_function::md5, dt::hash_function::sha1,
+                                  dt::hash_function::sha256, dt::hash_function::sha512);
+        if (!dt::hasher_supported_algorithms().contains(algorithm)) return;
+
+        auto reference_hasher = dt::make_hasher(algorithm);
+        auto hasher = dt::native_hasher(algorithm);
+        auto data = random_bytes(message_lengths.back());
+
+        for (auto length : message_lengths) {
+            auto message = std::span(data).first(length);
+            auto expected = dt::make_checksum(algorithm);
+            auto result = dt::make_checksum(algorithm);
+
+            reference_hasher->update(message);
+            reference_hasher->finalize_to(expected->value());
+
+            // feed the data in pieces that are not aligned to the block size
+            for (std::size_t pos = 0; pos < length; pos += 37) {
+                hasher.update(message.subspan(pos, std::min<std::size_t>(37, length - pos)));
+            }
+            hasher.finalize_to(result->value());
+
+            CHECK(result->hex_string() == expected->hex_string());
+        }
+    }
+}
+
+TEST_CASE("native compression kernels")
+{
+    auto data = random_bytes(native::lane_count * 64 * 40);
+    const auto& features = native::detected_cpu_features();
+
+    SECTION("sha-ni") {
+#if defined(DOTTORRENT_NATIVE_X86)
+        if (!features.sha_ni) return;
+
+        for (std::size_t blocks : {1, 2, 7, 40}) {
+            auto sha1_expected = native::sha1_traits::initial_state;
+            auto sha1_result = native::sha1_traits::initial_state;
+            native::kernels::sha1_compress_portable(sha1_expected.data(), data.data(), blocks);
+            native::kernels::sha1_compress_sha_ni(sha1_result.data(), data.data(), blocks);
+            CHECK(sha1_result == sha1_expected);
+
+            auto sha256_expected = native::sha256_traits::initial_state;
+            auto sha256_result = native::sha256_traits::initial_state;
+            native::kernels::sha256_compress_portable(sha256_expected.data(), data.data(), blocks);
+            native::kernels::sha256_compress_sha_ni(sha256_result.data(), data.data(), blocks);
+            CHECK(sha256_result == sha256_expected);
+        }
+#endif
+    }
+
+    SECTION("avx2 lanes") {
+#if defined(DOTTORRENT_NATIVE_X86)
+        if (!features.avx2) return;
+
+        for (std::size_t blocks : {1, 3, 5}) {
+            std::array<std::array<std::uint32_t, 5>, native::lane_count> sha1_states {};
+            std::array<std::array<std::uint32_t, 8>, native::lane_count> sha256_states {};
+            std::array<std::uint32_t*, native::lane_count> sha1_ptrs {};
+            std::array<std::uint32_t*, native::lane_count> sha256_ptrs {};
+            std::array<const std::byte*, native::lane_count> lane_data {};
+
+            for (std::size_t i = 0; i < native::lane_count; ++i) {
+                sha1_states[i] = native::sha1_traits::initial_state;
+                sha256_states[i] = native::sha256_traits::initial_state;
+                sha1_ptrs[i] = sha1_states[i].data();
+                sha256_ptrs[i] = sha256_states[i].data();
+                lane_data[i] = data.data() + i * 64 * blocks;
+            }
+
+            native::kernels::sha1_compress_x8_avx2(sha1_ptrs.data(), lane_data.data(), blocks);
+            native::kernels::sha256_compress_x8_avx2(sha256_ptrs.data(), lane_data.data(), blocks);
+
+            for (std::size_t i = 0; i < native::lane_count; ++i) {
+                auto sha1_expected = native::sha1_traits::initial_state;
+                native::kernels::sha1_compress_portable(sha1_expected.data(), lane_data[i], blocks);
+                CHECK(sha1_states[i] == sha1_expected);
+
+                auto sha256_expected = native::sha256_traits::initial_state;
+                native::kernels::sha256_compress_portable(sha256_expected.data(), lane_data[i], blocks);
+                CHECK(sha256_states[i] == sha256_expected);
+            }
+        }
+#endif
+    }
+}
+
+TEST_CASE("native leaf block hashing")
+{
+    // more blocks than lanes, with a partial last batch for the multi-lane kernels
+    constexpr std::size_t block_count = 19;
+    auto data = random_bytes(block_count * native::leaf_block_size);
+
+    std::vector<dt::sha256_hash> expected(block_count);
+    auto reference_hasher = dt::native_hasher(dt::hash_function::sha256);
+    for (std::size_t i = 0; i < block_count; ++i) {
+        reference_hasher.update(std::span(data).subspan(i * native::leaf_block_size, native::leaf_block_size));
+        reference_hasher.finalize_to(expected[i]);
+    }
+
+    SECTION("selected kernel") {
+        std::vector<dt::sha256_hash> result(block_count);
+        native::sha256_leaf_blocks(data, result);
+        CHECK(result == expected);
+
+        native::sha256_leaf_blocks({}, {});
+    }
+
+    SECTION("all kernels") {
+        using native::kernels::batch_kernel;
+        const auto& features = native::detected_cpu_features();
+        std::vector<batch_kernel> kernels {batch_kernel::portable};
+#if defined(DOTTORRENT_NATIVE_X86)
+        if (features.sha_ni) kernels.push_back(batch_kernel::sha_ni);
+        if (features.avx2)   kernels.push_back(batch_kernel::avx2_x8);
+        if (features.avx512) kernels.push_back(batch_kernel::avx512_x16);
+#endif
+
+        for (auto kernel : kernels) {
+            for (std::size_t count : {1UL, 2UL, block_count}) {
+                std::vector<dt::sha256_hash> result(count);
+                native::kernels::sha256_leaf_blocks(
+                        kernel, data.data(), count, reinterpret_cast<std::byte*>(result.data()));
+                CHECK(std::equal(result.begin(), result.end(), expected.begin()));
+            }
+        }
+    }
+}
+
+TEST_CASE("native inner node hashing")
+{
+    constexpr std::size_t node_count = 37;
+    auto data = random_bytes(2 * node_count * dt::sha256_hash::size_bytes);
+    std::vector<dt::sha256_hash> children(2 * node_count);
+    std::memcpy(children.data(), data.data(), data.size());
+
+    std::vector<dt::sha256_hash> expected(node_count);
+    auto reference_hasher = dt::native_hasher(dt::hash_function::sha256);
+    for (std::size_t i = 0; i < node_count; ++i) {
+        reference_hasher.update(children[2 * i]);
+        reference_hasher.update(children[2 * i + 1]);
+        reference_hasher.finalize_to(expected[i]);
+    }
+
+    SECTION("selected kernel") {
+        std::vector<dt::sha256_hash> result(node_count);
+        native::sha256_inner_nodes(children, result);
+        CHECK(result == expected);
+    }
+
+    SECTION("all kernels") {
+        using native::kernels::batch_kernel;
+        const auto& features = native::detected_cpu_features();
+        std::vector<batch_kernel> kernels {batch_kernel::portable};
+#if defined(DOTTORRENT_NATIVE_X86)
+        if (features.sha_ni) kernels.push_back(batch_kernel::sha_ni);
+        if (features.avx2)   kernels.push_back(batch_kernel::avx2_x8);
+        if (features.avx512) kernels.push_back(batch_kernel::avx512_x16);
+#endif
+
+        for (auto kernel : kernels) {
+            for (std::size_t count : {1UL, 3UL, node_count}) {
+                std::vector<dt::sha256_hash> result(count);
+                native::kernels::sha256_inner_nodes(
+                        kernel, data.data(), count, reinterpret_cast<std::byte*>(result.data()));
+                CHECK(std::equal(result.begin(), result.end(), expected.begin()));
+            }
+        }
+    }
+}
+
+namespace {
+
+template <typename Traits>
+void check_multi_buffer_hasher(dt::hash_function algorithm, native::lanes_compress_function lanes_compress)
+{
+    auto data = random_bytes(message_lengths.back());
+    auto h = native::multi_buffer_hasher_impl<Traits>(lanes_compress);
+    auto reference_hasher = dt::native_hasher(algorithm);
+
+    // whole messages, more jobs than lanes with different lengths
+    {
+        h.resize(message_lengths.size());
+        for (std::size_t i = 0; i < message_lengths.size(); ++i) {
+            h.submit(i, std::span(data).first(message_lengths[i]));
+        }
+
+        for (std::size_t i = 0; i < message_lengths.size(); ++i) {
+            auto expected = dt::make_checksum(algorithm);
+            auto result = dt::make_checksum(algorithm);
+            reference_hasher.update(std::span(data).first(message_lengths[i]));
+            reference_hasher.finalize_to(expected->value());
+            h.finalize_to(i, result->value());
+            CHECK(result->hex_string() == expected->hex_string());
+        }
+    }
+
+    // messages submitted in parts
+    {
+        h.reset();
+        constexpr std::size_t jobs = 5;
+        constexpr std::size_t part_size = 1001;
+        h.resize(jobs);
+
+        for (std::size_t i = 0; i < jobs; ++i) {
+            h.submit_first(i, std::span(data).subspan(i, part_size));
+        }
+        for (std::size_t i = 0; i < jobs; ++i) {
+            h.submit_update(i, std::span(data).subspan(i + part_size, part_size));
+        }
+        for (std::size_t i = 0; i < jobs; ++i) {
+            h.submit_last(i, std::span(data).subspan(i + 2 * part_size, part_size * i));
+        }
+
+        for (std::size_t i = 0; i < jobs; ++i) {
+            auto expected = dt::make_checksum(algorithm);
+            auto result = dt::make_checksum(algorithm);
+            reference_hasher.update(std::span(data).subspan(i, part_size * (2 + i)));
+            reference_hasher.finalize_to(expected->value());
+            h.finalize_to(i, result->value());
+            CHECK(result->hex_string() == expected->hex_string());
+        }
+    }
+}
+
+}
+
+TEST_CASE("native multi-buffer hasher")
+{
+    SECTION("selected kernels") {
+        check_multi_buffer_hasher<native::sha1_traits>(dt::hash_function::sha1, native::sha1_lanes_compress());
+        check_multi_buffer_hasher<native::sha256_traits>(dt::hash_function::sha256, native::sha256_lanes_compress());
+    }
+
+    SECTION("avx2 lanes") {
+#if defined(DOTTORRENT_NATIVE_X86)
+        if (!native::detected_cpu_features().avx2) return;
+
+        check_multi_buffer_hasher<native::sha1_traits>(
+                dt::hash_function::sha1, native::kernels::sha1_compress_x8_avx2);
+        check_multi_buffer_hasher<native::sha256_traits>(
+                dt::hash_function::sha256, native::kernels::sha256_compress_x8_avx2);
+#endif
+    }
+
+    SECTION("factory") {
+        std::unique_ptr<multi_buffer_hasher> h =
+                std::make_unique<dt::native_multi_buffer_hasher>(dt::hash_function::sha256);
+        dt::sha256_hash out;
+        h->submit(std::string_view("test"));
+        h->finalize_to(0, out);
+        CHECK(out.hex_string() == "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08");
+    }
+}
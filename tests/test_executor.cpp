@@ -0,0 +1,106 @@
+#include <catch2/catch.hpp>
+
+#include <dottorrent/executor.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+TEST_CASE("Test executor")
+{
+    using namespace dottorrent;
+    auto ex = std::make_shared<executor>(4);
+    CHECK(ex->thread_count() == 4);
+
+    SECTION("all submitted tasks run") {
+        constexpr std::size_t task_count = 10000;
+        std::atomic<std::size_t> counter = 0;
+
+        for (std::size_t i = 0; i < task_count; ++i) {
+            ex->submit([&] { counter.fetch_add(1, std::memory_order_relaxed); });
+        }
+        while (counter.load() != task_count) {
+            std::this_thread::yield();
+        }
+        CHECK(counter == task_count);
+    }
+
+    SECTION("tasks submitted from a worker run") {
+        constexpr std::size_t task_count = 1000;
+        std::atomic<std::size_t> counter = 0;
+
+        ex->submit([&] {
+            for (std::size_t i = 0; i < task_count; ++i) {
+                ex->submit([&] { counter.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+        while (counter.load() != task_count) {
+            std::this_thread::yield();
+        }
+        CHECK(counter == task_count);
+    }
+}
+
+TEST_CASE("Test bounded task runner")
+{
+    using namespace dottorrent;
+    auto ex = std::make_shared<executor>(4);
+
+    std::mutex mutex {};
+    std::vector<std::size_t> items {};
+    std::vector<std::size_t> processed {};
+    std::atomic<std::size_t> active = 0;
+    std::atomic<std::size_t> max_active = 0;
+    std::atomic<std::size_t> max_slot = 0;
+
+    auto has_work = [&] {
+        std::unique_lock lck{mutex};
+        return !items.empty();
+    };
+    auto drain = [&](std::size_t slot) {
+        auto n = active.fetch_add(1) + 1;
+        max_active.store(std::max(max_active.load(), n));
+        max_slot.store(std::max(max_slot.load(), slot));
+        for (std::size_t i = 0; i < 4; ++i) {
+            std::unique_lock lck{mutex};
+            if (items.empty()) break;
+            processed.push_back(items.front());
+            items.erase(items.begin());
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+        active.fetch_sub(1);
+    };
+
+    auto produce = [&](bounded_task_runner& runner) {
+        for (std::size_t i = 0; i < 1000; ++i) {
+            {
+                std::unique_lock lck{mutex};
+                items.push_back(i);
+            }
+            runner.schedule();
+        }
+        runner.wait_idle();
+    };
+
+    SECTION("concurrency is bounded") {
+        bounded_task_runner runner(ex, 2, has_work, drain);
+        produce(runner);
+        CHECK(items.empty());
+        CHECK(processed.size() == 1000);
+        CHECK(max_active <= 2);
+        CHECK(max_slot <= 1);
+    }
+
+    SECTION("a single slot keeps the order of the items") {
+        bounded_task_runner runner(ex, 1, has_work, drain);
+        produce(runner);
+        REQUIRE(processed.size() == 1000);
+        for (std::size_t i = 0; i < processed.size(); ++i) {
+            CHECK(processed[i] == i);
+        }
+    }
+}
@@ -0,0 +1,218 @@
+#include <catch2/catch.hpp>
+
+#include <dottorrent/checksum.hpp>
+#include <dottorrent/file_entry.hpp>
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/hash_checkpoint.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <optional>
+
+using namespace dottorrent;
+using namespace dottorrent::literals;
+namespace fs = std::filesystem;
+
+
+static sha256_hash make_v2_hash(std::uint8_t value)
+{
+    sha256_hash hash {};
+    std::ranges::fill(hash, std::byte(value));
+    return hash;
+}
+
+static sha1_hash make_v1_hash(std::uint8_t value)
+{
+    sha1_hash hash {};
+    std::ranges::fill(hash, std::byte(value));
+    return hash;
+}
+
+TEST_CASE("Hash checkpoint round trip")
+{
+    file_storage storage {};
+    storage.set_root_directory(fs::temp_directory_path());
+    storage.set_piece_size(16_KiB);
+    storage.add_file(file_entry{"a", 3 * 16_KiB + 100});
+    storage.add_file(file_entry{"b", 10_KiB});
+    storage.add_file(file_entry{"c", 0});
+
+    const auto path = fs::temp_directory_path() / "dottorrent-test-checkpoint.bin";
+
+    hash_checkpoint checkpoint(storage, protocol::hybrid);
+    CHECK(checkpoint.v2_piece_count(0) == 4);
+    CHECK(checkpoint.v2_piece_count(1) == 1);
+    CHECK(checkpoint.v2_piece_count(2) == 1);
+
+    checkpoint.add_v1_piece(1, make_v1_hash(1));
+    checkpoint.add_v2_piece(0, 3, make_v2_hash(2));
+    checkpoint.add_v2_piece(1, 0, make_v2_hash(3));
+    auto md5 = make_checksum(hash_function::md5);
+    std::ranges::fill(md5->value(), std::byte(4));
+    checkpoint.add_checksum(1, *md5);
+    checkpoint.save(path);
+
+    hash_checkpoint restored(storage, protocol::hybrid);
+    restored.load(path);
+    fs::remove(path);
+
+    CHECK_FALSE(restored.v1_piece(0));
+    CHECK(restored.v1_piece(1) == make_v1_hash(1));
+    CHECK_FALSE(restored.v2_piece(0, 0));
+    CHECK(restored.v2_piece(0, 3) == make_v2_hash(2));
+    CHECK(restored.v2_piece(1, 0) == make_v2_hash(3));
+
+    auto checksum = restored.get_checksum(1, hash_function::md5);
+    REQUIRE(checksum);
+    CHECK(*checksum == *md5);
+    CHECK_FALSE(restored.get_checksum(0, hash_function::md5));
+    CHECK_FALSE(restored.get_checksum(1, hash_function::sha1));
+}
+
+TEST_CASE("Hash checkpoint for a different storage")
+{
+    file_storage storage {};
+    storage.set_root_directory(fs::temp_directory_path());
+    storage.set_piece_size(16_KiB);
+    storage.add_file(file_entry{"a", 3 * 16_KiB + 100});
+
+    const auto path = fs::temp_directory_path() / "dottorrent-test-checkpoint-mismatch.bin";
+    hash_checkpoint(storage, protocol::v1).save(path);
+
+    CHECK_THROWS_AS(hash_checkpoint(storage, protocol::v2).load(path), std::invalid_argument);
+
+    file_storage other {};
+    other.set_root_directory(fs::temp_directory_path());
+    other.set_piece_size(16_KiB);
+    other.add_file(file_entry{"a", 3 * 16_KiB});
+    CHECK_THROWS_AS(hash_checkpoint(other, protocol::v1).load(path), std::invalid_argument);
+
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        f << "DTCKPT01";
+    }
+    CHECK_THROWS_AS(hash_checkpoint(storage, protocol::v1).load(path), std::runtime_error);
+    fs::remove(path);
+}
+
+TEST_CASE("Hash checkpoint discards files that changed")
+{
+    const auto root = fs::temp_directory_path() / "dottorrent-test-checkpoint-files";
+    fs::create_directories(root);
+    for (auto name : {"a", "b"}) {
+        std::ofstream f(root / name, std::ios::binary | std::ios::trunc);
+        f << std::string(20_KiB, 'x');
+    }
+
+    file_storage storage {};
+    storage.set_root_directory(root);
+    storage.set_piece_size(16_KiB);
+    storage.add_file(file_entry{"a", 20_KiB});
+    storage.add_file(file_entry{"b", 20_KiB});
+
+    hash_checkpoint checkpoint(storage, protocol::v2);
+    checkpoint.add_v2_piece(0, 0, make_v2_hash(1));
+    checkpoint.add_v2_piece(1, 0, make_v2_hash(2));
+    checkpoint.save(root / "checkpoint");
+
+    // same size, different modification time
+    fs::last_write_time(root / "b", fs::last_write_time(root / "b") - std::chrono::hours(1));
+
+    hash_checkpoint restored(storage, protocol::v2);
+    restored.load(root / "checkpoint");
+    fs::remove_all(root);
+
+    CHECK(restored.v2_piece(0, 0) == make_v2_hash(1));
+    CHECK_FALSE(restored.v2_piece(1, 0));
+}
+
+TEST_CASE("Hash checkpoint with the hashes of unchanged files")
+{
+    const auto root = fs::temp_directory_path() / "dottorrent-test-checkpoint-unchanged";
+    fs::create_directories(root);
+    for (auto name : {"a", "b"}) {
+        std::ofstream f(root / name, std::ios::binary | std::ios::trunc);
+        f << std::string(20_KiB, 'x');
+    }
+
+    auto make_storage = [&](std::optional<std::size_t> moved_by = std::nullopt) {
+        file_storage storage {};
+        storage.set_root_directory(root);
+        storage.set_piece_size(16_KiB);
+        // a new file before "a" and "b" moves them
+        if (moved_by) {
+            storage.add_file(file_entry{"c", *moved_by});
+        }
+        storage.add_file(file_entry{"a", 20_KiB});
+        storage.add_file(file_entry{"b", 20_KiB});
+        return storage;
+    };
+
+    // "b" was modified after the previous storage was hashed
+    auto previous = make_storage();
+    previous.set_last_modified_time(0, fs::last_write_time(root / "a"));
+    previous.set_last_modified_time(1, fs::last_write_time(root / "b") - std::chrono::hours(1));
+    previous.allocate_pieces();
+    for (std::size_t i = 0; i < previous.piece_count(); ++i) {
+        previous.set_piece_hash(i, make_v1_hash(std::uint8_t(i + 1)));
+    }
+    for (std::size_t i = 0; i < previous.file_count(); ++i) {
+        const std::array layer {make_v2_hash(std::uint8_t(2 * i + 1)), make_v2_hash(std::uint8_t(2 * i + 2))};
+        previous.at(i).set_pieces_root(make_v2_hash(0xff));
+        previous.at(i).set_piece_layer(layer);
+    }
+
+    auto storage = make_storage();
+
+    SECTION("v1") {
+        hash_checkpoint checkpoint(storage, protocol::v1);
+        CHECK(checkpoint.add_unchanged_files(storage, previous) == 1);
+
+        // the second piece contains data of "a" and "b"
+        CHECK(checkpoint.v1_piece(0) == make_v1_hash(1));
+        CHECK_FALSE(checkpoint.v1_piece(1));
+        CHECK_FALSE(checkpoint.v1_piece(2));
+    }
+
+    SECTION("v2") {
+        hash_checkpoint checkpoint(storage, protocol::v2);
+        CHECK(checkpoint.add_unchanged_files(storage, previous) == 1);
+
+        CHECK(checkpoint.v2_piece(0, 0) == make_v2_hash(1));
+        CHECK(checkpoint.v2_piece(0, 1) == make_v2_hash(2));
+        CHECK_FALSE(checkpoint.v2_piece(1, 0));
+    }
+
+    SECTION("v1 files moved by a multiple of the piece size") {
+        std::ofstream(root / "c", std::ios::binary) << std::string(32_KiB, 'y');
+        auto moved = make_storage(32_KiB);
+        hash_checkpoint checkpoint(moved, protocol::v1);
+        CHECK(checkpoint.add_unchanged_files(moved, previous) == 1);
+
+        // "c" is new, the first piece of "a" moved by two pieces
+        CHECK_FALSE(checkpoint.v1_piece(0));
+        CHECK_FALSE(checkpoint.v1_piece(1));
+        CHECK(checkpoint.v1_piece(2) == make_v1_hash(1));
+        CHECK_FALSE(checkpoint.v1_piece(3));
+    }
+
+    SECTION("v1 files moved by a part of a piece") {
+        std::ofstream(root / "c", std::ios::binary) << std::string(14_KiB, 'y');
+        auto moved = make_storage(14_KiB);
+        hash_checkpoint checkpoint(moved, protocol::v1);
+        CHECK(checkpoint.add_unchanged_files(moved, previous) == 1);
+
+        // the second piece only contains data of "a", but not the bytes of a previous piece
+        CHECK_FALSE(checkpoint.v1_piece(0));
+        CHECK_FALSE(checkpoint.v1_piece(1));
+        CHECK_FALSE(checkpoint.v1_piece(2));
+    }
+
+    hash_checkpoint checkpoint(storage, protocol::v1);
+    file_storage other_piece_size = make_storage();
+    other_piece_size.set_piece_size(32_KiB);
+    CHECK_THROWS_AS(checkpoint.add_unchanged_files(storage, other_piece_size), std::invalid_argument);
+    fs::remove_all(root);
+}
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <string_view>
 #include <bit>
+#include <thread>
 
 
 TEST_CASE("Test merkle tree")
@@ -53,4 +54,118 @@ TEST_CASE("Test merkle tree")
         // root hash is actually set
         CHECK(!tree.root().hex_string().empty());
     }
-}
\ No newline at end of file
+
+    SECTION("Inner nodes match the hasher") {
+        auto hasher = make_hasher(hash_function::sha256);
+
+        for (std::size_t i = 0; i < piece_count; ++i) {
+            sha256_hash h {};
+            hasher->update(pieces_data[i]);
+            hasher->finalize_to(h);
+            tree.set_leaf(i, h);
+        }
+
+        // hash the layers pairwise up to the root
+        std::vector<sha256_hash> layer(tree.get_layer(tree.tree_height()).begin(),
+                                       tree.get_layer(tree.tree_height()).end());
+        while (layer.size() > 1) {
+            std::vector<sha256_hash> parents(layer.size() / 2);
+            for (std::size_t i = 0; i < parents.size(); ++i) {
+                hasher->update(layer[2 * i]);
+                hasher->update(layer[2 * i + 1]);
+                hasher->finalize_to(parents[i]);
+            }
+            layer = std::move(parents);
+        }
+
+        tree.update(*hasher);
+        CHECK(tree.root() == layer.front());
+
+#if defined(DOTTORRENT_USE_ISAL)
+        auto mb_tree = tree;
+        mb_tree.update(*make_multi_buffer_hasher(hash_function::sha256));
+        CHECK(mb_tree.root() == layer.front());
+#endif
+    }
+
+    SECTION("Concurrent leaf writers hand the leaves over to the last writer") {
+        std::array<sha256_hash, piece_count> leaves {};
+        auto hasher = make_hasher(hash_function::sha256);
+        auto reference = tree;
+
+        for (std::size_t i = 0; i < piece_count; ++i) {
+            hasher->update(pieces_data[i]);
+            hasher->finalize_to(leaves[i]);
+            reference.set_leaf(i, leaves[i]);
+        }
+        reference.update(*hasher);
+
+        std::atomic<std::size_t> completed = 0;
+        {
+            std::vector<std::jthread> writers {};
+            for (std::size_t t = 0; t < 2; ++t) {
+                writers.emplace_back([&, t]() {
+                    for (std::size_t i = t; i < piece_count; i += 2) {
+                        if (tree.set_leaf(i, leaves[i]) == piece_count) {
+                            tree.update(*make_hasher(hash_function::sha256));
+                            ++completed;
+                        }
+                    }
+                });
+            }
+        }
+
+        CHECK(completed == 1);
+        CHECK(tree.leaves_set() == piece_count);
+        CHECK(tree.root() == reference.root());
+    }
+
+    SECTION("Padding roots match hashing the zero leaves") {
+        using tree_type = merkle_tree<hash_function::sha256>;
+        auto hasher = make_hasher(hash_function::sha256);
+
+        std::vector<sha256_hash> layer(16);
+        CHECK(tree_type::padding_root(0) == sha256_hash{});
+
+        for (std::size_t height = 1; layer.size() > 1; ++height) {
+            std::vector<sha256_hash> parents(layer.size() / 2);
+            for (std::size_t i = 0; i < parents.size(); ++i) {
+                hasher->update(layer[2 * i]);
+                hasher->update(layer[2 * i + 1]);
+                hasher->finalize_to(parents[i]);
+            }
+            layer = std::move(parents);
+            CHECK(tree_type::padding_root(height) == layer.front());
+        }
+
+        // the padding subtrees of the tree are set from the table
+        tree.update(*hasher);
+        CHECK(tree.get_node(1, 1) == tree_type::padding_root(3));
+    }
+}
+
+TEST_CASE("Blocked merkle tree update matches the breadth-first update")
+{
+    using namespace dottorrent;
+
+    // taller than a single block of subtrees, with padding
+    constexpr std::size_t leaf_count = 3000;
+    auto tree = merkle_tree<hash_function::sha256>{leaf_count};
+    auto hasher = make_hasher(hash_function::sha256);
+
+    for (std::size_t i = 0; i < leaf_count; ++i) {
+        sha256_hash h {};
+        hasher->update(std::to_string(i));
+        hasher->finalize_to(h);
+        tree.set_leaf(i, h);
+    }
+
+    auto blocked = tree;
+    tree.update(*hasher);
+    blocked.update_blocked(*hasher);
+
+    CHECK(blocked.root() == tree.root());
+    for (std::size_t depth = 0; depth <= tree.tree_height(); ++depth) {
+        CHECK(std::ranges::equal(blocked.get_layer(depth), tree.get_layer(depth)));
+    }
+}
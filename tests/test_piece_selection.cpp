@@ -0,0 +1,135 @@
+#include <catch2/catch.hpp>
+
+#include <dottorrent/file_entry.hpp>
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/piece_selection.hpp>
+
+using namespace dottorrent;
+using namespace dottorrent::literals;
+
+
+static file_storage make_v1_storage()
+{
+    file_storage storage {};
+    storage.set_piece_size(16_KiB);
+    storage.add_file(file_entry{"a", 1000 * 16_KiB + 100});
+    storage.add_file(file_entry{"b", 0});
+    storage.add_file(file_entry{"c", 10_KiB});
+    storage.add_file(file_entry{"d", 200 * 16_KiB});
+    return storage;
+}
+
+TEST_CASE("Piece selection for v1 torrents")
+{
+    const auto strategy = GENERATE(sampling_strategy::random, sampling_strategy::stratified);
+    auto storage = make_v1_storage();
+    piece_selection selection(storage, protocol::v1, {.fraction = 0.05, .count = 4, .strategy = strategy, .seed = 42});
+
+    CHECK(selection.size() == storage.piece_count());
+
+    // the first and last piece of each file are selected, "c" shares both with its neighbours
+    CHECK(selection.file_pieces(0) == std::pair<std::size_t, std::size_t>{0, 1001});
+    CHECK(selection.file_pieces(1) == std::pair<std::size_t, std::size_t>{1000, 1000});
+    CHECK(selection.file_pieces(2) == std::pair<std::size_t, std::size_t>{1000, 1001});
+    CHECK(selection.file_pieces(3) == std::pair<std::size_t, std::size_t>{1000, 1201});
+    CHECK(selection.selected(0));
+    CHECK(selection.selected(1000));
+    CHECK(selection.selected(1200));
+
+    CHECK(selection.selected_count(0) == 51);
+    CHECK(selection.selected_count(1) == 0);
+    CHECK(selection.selected_count(2) == 1);
+    CHECK(selection.selected_count(3) == 11);
+}
+
+TEST_CASE("Piece selection is reproducible with a seed")
+{
+    auto storage = make_v1_storage();
+    piece_selection a(storage, protocol::v1, {.strategy = sampling_strategy::random, .seed = 1});
+    piece_selection b(storage, protocol::v1, {.strategy = sampling_strategy::random, .seed = 1});
+
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        REQUIRE(a.selected(i) == b.selected(i));
+    }
+}
+
+TEST_CASE("Stratified piece selection spreads pieces over the file")
+{
+    file_storage storage {};
+    storage.set_piece_size(16_KiB);
+    storage.add_file(file_entry{"a", 102 * 16_KiB});
+    piece_selection selection(storage, protocol::v1, {.fraction = 0, .count = 12, .strategy = sampling_strategy::stratified});
+
+    // 10 strata of 10 pieces between the first and last piece
+    for (std::size_t stratum = 0; stratum < 10; ++stratum) {
+        std::size_t count = 0;
+        for (std::size_t i = 1 + 10 * stratum; i < 11 + 10 * stratum; ++i) {
+            count += selection.selected(i);
+        }
+        CHECK(count == 1);
+    }
+}
+
+TEST_CASE("Piece selection for v2 torrents")
+{
+    file_storage storage {};
+    storage.set_piece_size(64_KiB);
+    storage.add_file(file_entry{"a", 100 * 64_KiB});
+    storage.add_file(file_entry{"b", 100});
+    storage.add_file(file_entry{"c", 3 * 64_KiB});
+    for (auto& entry : storage) {
+        entry.set_pieces_root({});
+    }
+    storage[0].set_piece_layer(std::vector<sha256_hash>(100));
+    storage[2].set_piece_layer(std::vector<sha256_hash>(3));
+
+    piece_selection selection(storage, protocol::v2, {.fraction = 0.1, .count = 0, .seed = 3});
+    CHECK(selection.size() == 104);
+    CHECK(selection.file_pieces(1) == std::pair<std::size_t, std::size_t>{100, 101});
+    CHECK(selection.selected_count(0) == 10);
+    CHECK(selection.selected_count(1) == 1);
+    CHECK(selection.selected_count(2) == 2);
+
+    // chunk piece indices are relative to the file
+    CHECK(selection.selected(2, 0));
+    CHECK(selection.selected(2, 2));
+    CHECK_FALSE(selection.selected(2, 1));
+
+    selection.mark_failed(101);
+    CHECK(selection.file_failed(2));
+    CHECK_FALSE(selection.file_failed(0));
+    CHECK_FALSE(selection.file_failed(1));
+}
+
+TEST_CASE("Failed v1 pieces mark all files they overlap")
+{
+    auto storage = make_v1_storage();
+    piece_selection selection(storage, protocol::v1, {.seed = 0});
+
+    selection.mark_failed(1000);
+    CHECK(selection.file_failed(0));
+    CHECK_FALSE(selection.file_failed(1));
+    CHECK(selection.file_failed(2));
+    CHECK(selection.file_failed(3));
+}
+
+TEST_CASE("Piece sample summary confidence")
+{
+    piece_sample_summary summary {.piece_count = 100, .sampled = 10, .verified = 10};
+    // the probability that 10 pieces out of 100 miss all 10 corrupt pieces
+    double miss = 1;
+    for (int i = 0; i < 10; ++i) {
+        miss *= double(90 - i) / double(100 - i);
+    }
+    CHECK(summary.confidence(0.1) == Approx(1 - miss));
+    CHECK(summary.confidence(0.95) == 1);
+    CHECK(summary.confidence(0) == 0);
+
+    summary.verified = 9;
+    summary.failed = 1;
+    CHECK(summary.confidence(0.01) == 1);
+
+    piece_sample_summary complete {.piece_count = 4, .sampled = 4, .verified = 4};
+    CHECK(complete.intact());
+    CHECK(complete.confidence(0.01) == 1);
+}
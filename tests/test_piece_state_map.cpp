@@ -0,0 +1,63 @@
+#include <catch2/catch.hpp>
+
+#include <dottorrent/piece_state_map.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace dottorrent;
+
+
+TEST_CASE("Piece state map")
+{
+    auto map = piece_state_map(130);
+    CHECK(map.size() == 130);
+    CHECK(map.state(0) == piece_state::pending);
+    CHECK(map.count_checked(0, 130) == 0);
+
+    map.publish(0, true);
+    map.publish(63, false);
+    map.publish(64, true);
+    map.publish(129, true);
+
+    CHECK(map.state(0) == piece_state::verified);
+    CHECK(map.state(1) == piece_state::pending);
+    CHECK(map.state(63) == piece_state::failed);
+    CHECK(map.state(64) == piece_state::verified);
+    CHECK(map.state(129) == piece_state::verified);
+
+    CHECK(map.count_checked(0, 130) == 4);
+    CHECK(map.count_verified(0, 130) == 3);
+    // ranges within and across words
+    CHECK(map.count_checked(1, 63) == 0);
+    CHECK(map.count_checked(63, 65) == 2);
+    CHECK(map.count_verified(63, 65) == 1);
+    CHECK(map.count_verified(65, 129) == 0);
+    CHECK(map.count_verified(129, 130) == 1);
+    CHECK(map.count_verified(10, 10) == 0);
+}
+
+TEST_CASE("Piece state map with concurrent publishers")
+{
+    constexpr std::size_t piece_count = 10000;
+    constexpr std::size_t publisher_count = 4;
+    auto map = piece_state_map(piece_count);
+
+    {
+        // interleave the publishers so that they write to the same words
+        std::vector<std::jthread> publishers {};
+        for (std::size_t t = 0; t < publisher_count; ++t) {
+            publishers.emplace_back([&, t]() {
+                for (std::size_t i = t; i < piece_count; i += publisher_count) {
+                    map.publish(i, i % 3 != 0);
+                }
+            });
+        }
+    }
+
+    CHECK(map.count_checked(0, piece_count) == piece_count);
+    CHECK(map.count_verified(0, piece_count) == piece_count - (piece_count + 2) / 3);
+    for (std::size_t i = 0; i < piece_count; ++i) {
+        REQUIRE(map.state(i) == (i % 3 != 0 ? piece_state::verified : piece_state::failed));
+    }
+}
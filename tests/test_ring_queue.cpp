@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+
+#include <dottorrent/ring_queue.hpp>
+
+#include <atomic>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+
+TEST_CASE("Test ring queue")
+{
+    using namespace dottorrent;
+
+    SECTION("capacity is rounded up to a power of two") {
+        ring_queue<int> queue(5);
+        CHECK(queue.capacity() == 8);
+    }
+
+    SECTION("single thread") {
+        ring_queue<int> queue(4);
+        for (int i = 0; i < 4; ++i) {
+            CHECK(queue.try_push(int(i)));
+        }
+        CHECK_FALSE(queue.try_push(4));
+        CHECK(queue.size() == 4);
+
+        int item = -1;
+        for (int i = 0; i < 4; ++i) {
+            CHECK(queue.try_pop(item));
+            CHECK(item == i);
+        }
+        CHECK_FALSE(queue.try_pop(item));
+        CHECK(queue.size() == 0);
+    }
+
+    SECTION("popped values are released from the queue") {
+        ring_queue<std::shared_ptr<int>> queue(2);
+        auto value = std::make_shared<int>(1);
+        queue.push(value);
+
+        std::shared_ptr<int> item;
+        queue.pop(item);
+        item.reset();
+        CHECK(value.use_count() == 1);
+    }
+
+    SECTION("one producer, many consumers") {
+        constexpr std::size_t item_count = 100000;
+        constexpr std::size_t consumer_count = 8;
+        ring_queue<std::size_t> queue(16);
+
+        std::atomic<std::size_t> sum = 0;
+        std::vector<std::jthread> consumers {};
+
+        for (std::size_t i = 0; i < consumer_count; ++i) {
+            consumers.emplace_back([&] {
+                std::size_t item;
+                for (;;) {
+                    queue.pop(item);
+                    // 0 is used as stop signal
+                    if (item == 0) break;
+                    sum.fetch_add(item, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        for (std::size_t i = 1; i <= item_count; ++i) {
+            queue.push(i);
+        }
+        for (std::size_t i = 0; i < consumer_count; ++i) {
+            queue.push(0);
+        }
+        consumers.clear();
+
+        CHECK(sum == item_count * (item_count + 1) / 2);
+    }
+}
@@ -6,8 +6,12 @@
 #include <dottorrent/hash.hpp>
 #include <dottorrent/storage_hasher.hpp>
 
+#include <dottorrent/hasher/factory.hpp>
+
 #include <catch2/catch.hpp>
+#include <fstream>
 #include <iostream>
+#include <thread>
 #include <dottorrent/metafile.hpp>
 #include <dottorrent/serialization/path.hpp>
 
@@ -284,4 +288,418 @@ TEST_CASE("empty file hashing")
         CHECK(storage[1].has_v2_data());
         CHECK(storage[2].has_v2_data());
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("small files packed in shared chunks")
+{
+    // the expected info hashes were computed independently of the library
+    const auto root = fs::temp_directory_path() / "dottorrent-test-packed-files";
+    const std::pair<const char*, std::size_t> files[] = {
+            {"a", 0}, {"b", 1}, {"c", 100}, {"d", 5000}, {"e", 0}, {"f", 16_KiB},
+            {"g", 20000}, {"h", 40000}, {"i", 100000}, {"j", 3}, {"k", 1000}, {"l", 70}};
+
+    fs::create_directories(root);
+    char fill = 'a';
+    for (auto [name, size] : files) {
+        // "k" changed size after its entry was created
+        const auto content_size = name == "k"sv ? 1500 : size;
+        std::ofstream f(root / name, std::ios::binary | std::ios::trunc);
+        f << std::string(content_size, fill++);
+    }
+
+    metafile m {};
+    auto& storage = m.storage();
+    storage.set_root_directory(root);
+    storage.set_piece_size(16_KiB);
+    for (auto [name, size] : files) {
+        storage.add_file(file_entry{name, size});
+    }
+
+    SECTION("v2") {
+        storage_hasher hasher(storage, {
+                .protocol_version = protocol::v2,
+                .min_io_block_size = 64_KiB,
+        });
+        hasher.start();
+        hasher.wait();
+        REQUIRE(hasher.done());
+
+        CHECK(info_hash_v2(m).hex_string() == "05f3c7f3398dcc3ba38aa0a511f92bd68280d8951f715733c50ff8c636694137");
+    }
+
+    SECTION("hybrid") {
+        storage_hasher hasher(storage, {
+                .protocol_version = protocol::hybrid,
+                .min_io_block_size = 64_KiB,
+        });
+        hasher.start();
+        hasher.wait();
+        REQUIRE(hasher.done());
+
+        CHECK(info_hash_v1(m).hex_string() == "802b03053642a4945d095347df0aadf42c05eb21");
+        CHECK(info_hash_v2(m).hex_string() == "4acd2514bde9b82168fef5cc92cfe7a35d5fcdebeba14e565f7b1e399c07ee68");
+    }
+    fs::remove_all(root);
+}
+
+/// Return a metafile with the test resources, or a copy of them in `root`, and a piece size of 16 KiB.
+static metafile make_resources(const fs::path& root = TEST_DIR"/resources")
+{
+    std::vector<fs::path> files_;
+    for (auto&f : fs::recursive_directory_iterator(root)) {
+        if (!f.is_regular_file()) continue;
+        files_.push_back(f);
+    }
+    std::sort(files_.begin(), files_.end());
+
+    metafile m {};
+    auto& storage = m.storage();
+    storage.set_root_directory(root);
+    storage.add_files(files_.begin(), files_.end());
+    storage.set_piece_size(16_KiB);
+    return m;
+}
+
+/// Hash the test resources, or a copy of them in `root`, with a piece size of 16 KiB.
+static metafile hash_resources(storage_hasher_options options, const fs::path& root = TEST_DIR"/resources")
+{
+    auto m = make_resources(root);
+
+    options.min_io_block_size = 64_KiB;
+    storage_hasher hasher(m.storage(), options);
+    hasher.start();
+    hasher.wait();
+    CHECK(hasher.done());
+    return m;
+}
+
+/// Check that the info hashes and the SHA-1 checksums of both metafiles are equal.
+static void check_same_hashes(const metafile& result, const metafile& expected, protocol protocol_version)
+{
+    if (protocol_version != protocol::v2) {
+        CHECK(info_hash_v1(result) == info_hash_v1(expected));
+    }
+    if (protocol_version != protocol::v1) {
+        CHECK(info_hash_v2(result) == info_hash_v2(expected));
+    }
+    for (std::size_t i = 0; i < result.storage().file_count(); ++i) {
+        if (result.storage()[i].is_padding_file()) continue;
+        const auto* checksum = result.storage()[i].get_checksum(hash_function::sha1);
+        const auto* expected_checksum = expected.storage()[i].get_checksum(hash_function::sha1);
+        REQUIRE(checksum);
+        REQUIRE(expected_checksum);
+        CHECK(checksum->hex_string() == expected_checksum->hex_string());
+    }
+}
+
+/// Hash the test resources with a piece size of 16 KiB using the given reader.
+static metafile hash_resources_with_reader(protocol protocol_version,
+                                           reader_type reader,
+                                           std::size_t reader_threads = 4)
+{
+    return hash_resources({
+            .protocol_version = protocol_version,
+            .reader = reader,
+            .io_queue_depth = 8,
+            .reader_threads = reader_threads,
+    });
+}
+
+static void check_reader_matches_sequential(protocol protocol_version, reader_type reader)
+{
+    auto expected = hash_resources_with_reader(protocol_version, reader_type::sequential);
+    auto result = hash_resources_with_reader(protocol_version, reader, 3);
+
+    if (protocol_version != protocol::v2) {
+        CHECK(info_hash_v1(result) == info_hash_v1(expected));
+    }
+    if (protocol_version != protocol::v1) {
+        CHECK(info_hash_v2(result) == info_hash_v2(expected));
+    }
+}
+
+#ifdef DOTTORRENT_USE_IO_URING
+TEST_CASE("io_uring reader")
+{
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2, protocol::hybrid);
+    check_reader_matches_sequential(protocol_version, reader_type::io_uring);
+}
+#endif
+
+#ifdef DOTTORRENT_USE_MMAP
+TEST_CASE("mmap reader")
+{
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2, protocol::hybrid);
+    check_reader_matches_sequential(protocol_version, reader_type::mmap);
+}
+#endif
+
+#ifdef DOTTORRENT_USE_DIRECT_IO
+TEST_CASE("direct I/O reader")
+{
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2, protocol::hybrid);
+    check_reader_matches_sequential(protocol_version, reader_type::direct);
+}
+#endif
+
+TEST_CASE("parallel reader")
+{
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2, protocol::hybrid);
+    check_reader_matches_sequential(protocol_version, reader_type::parallel);
+
+    // per-file checksums need chunks in order
+    metafile m {};
+    auto& storage = m.storage();
+    storage.set_root_directory(TEST_DIR"/resources");
+    storage.add_file(fs::path(TEST_DIR"/resources/CAMELYON17.torrent"));
+
+    CHECK_THROWS_AS(storage_hasher(storage, {
+            .protocol_version = protocol_version,
+            .checksums = {hash_function::sha1},
+            .reader = reader_type::parallel,
+    }), std::invalid_argument);
+
+    // resumed hashing only reads the pieces that are not restored
+    CHECK_THROWS_AS(storage_hasher(storage, {
+            .protocol_version = protocol_version,
+            .reader = reader_type::parallel,
+            .checkpoint_file = fs::temp_directory_path() / "dottorrent-test-reader-checkpoint",
+    }), std::invalid_argument);
+}
+
+TEST_CASE("progress includes the pieces of unchanged files")
+{
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2, protocol::hybrid);
+    const storage_hasher_options options {
+            .protocol_version = protocol_version,
+            .checksums = {hash_function::sha1},
+    };
+
+    // the files are modified in a copy of the test resources
+    const auto root = fs::temp_directory_path() / "dottorrent-test-unchanged-files";
+    fs::remove_all(root);
+    fs::copy(TEST_DIR"/resources", root, fs::copy_options::recursive);
+
+    auto previous = std::make_shared<file_storage>(hash_resources(options, root).storage());
+    std::size_t changed_file_count = 0;
+
+    SECTION("all files unchanged") {}
+
+    // the v1 pieces that overlap the file and its neighbours are hashed again
+    SECTION("a file in the middle of the storage is modified") {
+        const auto path = root / "integers.bencode";
+        {
+            std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekg(100'000);
+            const auto c = static_cast<char>(f.get());
+            f.seekp(100'000);
+            f.put(static_cast<char>(~c));
+        }
+        fs::last_write_time(path, fs::last_write_time(path) + 1h);
+        changed_file_count = 1;
+    }
+
+    auto expected = hash_resources(options, root);
+
+    auto m = make_resources(root);
+    auto& storage = m.storage();
+    storage_hasher hasher(storage, {
+            .protocol_version = protocol_version,
+            .checksums = {hash_function::sha1},
+            .min_io_block_size = 64_KiB,
+            .previous_storage = previous,
+    });
+    hasher.start();
+    hasher.wait();
+    check_same_hashes(m, expected, protocol_version);
+
+    const auto total_size = protocol_version == protocol::v1 ? storage.total_file_size()
+                                                             : storage.total_regular_file_size();
+    CHECK(hasher.unchanged_file_count() == storage.regular_file_count() - changed_file_count);
+    if (changed_file_count == 0) {
+        CHECK(hasher.bytes_read() == 0);
+    }
+    else {
+        CHECK(hasher.bytes_read() > 0);
+        CHECK(hasher.bytes_read() < total_size);
+    }
+    CHECK(hasher.bytes_done() == total_size);
+    // hybrid hashers count the data hashed for both protocol versions
+    if (protocol_version != protocol::hybrid) {
+        CHECK(hasher.bytes_hashed() == total_size);
+    }
+
+    fs::remove_all(root);
+}
+
+TEST_CASE("cancel when the checkpoint cannot be saved")
+{
+    file_storage storage {};
+    storage.set_root_directory(TEST_DIR"/resources");
+    storage.add_file(fs::path(TEST_DIR"/resources/bittorrent-v2-test.torrent"));
+
+    storage_hasher hasher(storage, {
+            .protocol_version = protocol::v2,
+            .checkpoint_file = fs::path(TEST_DIR"/resources/missing-directory/checkpoint"),
+    });
+    hasher.start();
+
+    // the hasher is stopped before the checkpoint is saved
+    CHECK_THROWS(hasher.cancel());
+    CHECK(hasher.cancelled());
+    CHECK(hasher.done());
+    CHECK_FALSE(hasher.running());
+}
+
+TEST_CASE("resume hashing from a checkpoint")
+{
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2, protocol::hybrid);
+    const auto checkpoint_file = fs::temp_directory_path() / "dottorrent-test-resume-checkpoint";
+    fs::remove(checkpoint_file);
+
+    const auto expected = hash_resources({
+            .protocol_version = protocol_version,
+            .checksums = {hash_function::sha1},
+    });
+    const auto total_size = expected.storage().total_regular_file_size();
+
+    storage_hasher_options options {
+            .protocol_version = protocol_version,
+            .checksums = {hash_function::sha1},
+            .min_io_block_size = 64_KiB,
+            .checkpoint_file = checkpoint_file,
+    };
+
+    // returns the number of bytes read to complete the hashes
+    auto resume = [&]() {
+        auto m = make_resources();
+        storage_hasher hasher(m.storage(), options);
+        hasher.start();
+        hasher.wait();
+
+        // nothing is left to resume
+        CHECK_FALSE(fs::exists(checkpoint_file));
+        check_same_hashes(m, expected, protocol_version);
+        return hasher.bytes_read();
+    };
+
+    SECTION("cancelled while hashing") {
+        {
+            auto m = make_resources();
+            storage_hasher hasher(m.storage(), options);
+            hasher.start();
+            while (hasher.bytes_done() < total_size / 2) {
+                std::this_thread::yield();
+            }
+            hasher.cancel();
+        }
+        REQUIRE(fs::exists(checkpoint_file));
+
+        // the pieces completed before cancelling are not read again
+        CHECK(resume() < total_size);
+    }
+
+    SECTION("cancelled while the reader is blocked on a full queue") {
+        // a single piece hasher and the smallest queue,
+        // the hashed pieces and chunks still in the queues are discarded
+        options.max_memory = 0;
+        options.threads = 1;
+        {
+            auto m = make_resources();
+            storage_hasher hasher(m.storage(), options);
+            hasher.start();
+            hasher.cancel();
+            CHECK(hasher.cancelled());
+        }
+        REQUIRE(fs::exists(checkpoint_file));
+
+        resume();
+    }
+}
+
+TEST_CASE("v1 pieces written in place")
+{
+    auto expected = hash_resources({.protocol_version = protocol::v1});
+
+    SECTION("single buffer") {
+        auto result = hash_resources({
+                .protocol_version = protocol::v1,
+                .enable_multi_buffer_hashing = false,
+                .threads = 4,
+                .write_pieces_in_place = true,
+        });
+        CHECK(info_hash_v1(result) == info_hash_v1(expected));
+    }
+
+    SECTION("multi buffer") {
+        auto result = hash_resources({
+                .protocol_version = protocol::v1,
+                .enable_multi_buffer_hashing = true,
+                .threads = 4,
+                .write_pieces_in_place = true,
+        });
+        CHECK(info_hash_v1(result) == info_hash_v1(expected));
+    }
+
+    // the checkpoint records the pieces passed to the piece writer
+    SECTION("with a checkpoint file") {
+        file_storage storage {};
+        storage.set_root_directory(TEST_DIR"/resources");
+        storage.add_file(fs::path(TEST_DIR"/resources/bittorrent-v2-test.torrent"));
+
+        CHECK_THROWS_AS(storage_hasher(storage, {
+                .protocol_version = protocol::v1,
+                .write_pieces_in_place = true,
+                .checkpoint_file = fs::temp_directory_path() / "dottorrent-test-in-place-checkpoint",
+        }), std::invalid_argument);
+    }
+}
+
+TEST_CASE("shared executor")
+{
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2, protocol::hybrid);
+    auto expected = hash_resources({
+            .protocol_version = protocol_version,
+            .checksums = {hash_function::sha1},
+    });
+
+    auto ex = std::make_shared<executor>(3);
+    auto result = hash_resources({
+            .protocol_version = protocol_version,
+            .checksums = {hash_function::sha1},
+            .executor = ex,
+    });
+    check_same_hashes(result, expected, protocol_version);
+}
+
+TEST_CASE("per-file checksums hashed in parallel")
+{
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2, protocol::hybrid);
+    auto enable_multi_buffer_hashing = GENERATE(false, true);
+    auto m = hash_resources({
+            .protocol_version = protocol_version,
+            .checksums = {hash_function::md5, hash_function::sha1},
+            .enable_multi_buffer_hashing = enable_multi_buffer_hashing,
+            .threads = 4,
+    });
+    const auto& storage = m.storage();
+
+    for (const auto& entry : storage) {
+        if (entry.is_padding_file()) continue;
+
+        std::ifstream f(storage.root_directory() / entry.path(), std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+        for (auto algorithm : {hash_function::md5, hash_function::sha1}) {
+            auto hasher = make_hasher(algorithm);
+            hasher->update(std::string_view(content));
+            auto expected = make_checksum(algorithm);
+            hasher->finalize_to(expected->value());
+
+            // includes the last file of the torrent
+            const auto* checksum = entry.get_checksum(algorithm);
+            REQUIRE(checksum);
+            CHECK(checksum->hex_string() == expected->hex_string());
+        }
+    }
+}
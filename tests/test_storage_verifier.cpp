@@ -2,10 +2,15 @@
 #include <dottorrent/hash.hpp>
 #include <dottorrent/storage_verifier.hpp>
 #include <dottorrent/storage_hasher.hpp>
+#include <dottorrent/sampled_chunk_reader.hpp>
 
 #include <catch2/catch.hpp>
+#include <array>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <ranges>
+#include <span>
 
 
 using namespace dottorrent;
@@ -64,4 +69,281 @@ TEST_CASE("verify v2 torrent")
 
     auto result = verifier.result();
     CHECK(rng::all_of(result, [](auto& v) { return v == 1; }));
-}
\ No newline at end of file
+}
+TEST_CASE("verify v2 torrent with piece callback")
+{
+    fs::path root(TEST_DIR);
+
+    metafile m {};
+    auto& storage = m.storage();
+    storage.set_root_directory(root);
+
+    for (auto&f : fs::directory_iterator(root)) {
+        if (!f.is_regular_file()) continue;
+        storage.add_file(f);
+    }
+    choose_piece_size(storage);
+    storage_hasher hasher(storage, {.protocol_version = protocol::v2});
+    hasher.start();
+    hasher.wait();
+
+    // the callback runs on the verifier threads
+    std::mutex mutex {};
+    std::vector<std::size_t> reported {};
+    std::size_t failed = 0;
+    storage_verifier verifier(storage, {
+        .piece_callback = [&](std::size_t piece_index, bool verified) {
+            std::unique_lock lck {mutex};
+            reported.push_back(piece_index);
+            failed += !verified;
+        }
+    });
+    verifier.start();
+    verifier.wait();
+    CHECK(verifier.done());
+
+    // every piece is reported once
+    const auto& result = verifier.result();
+    rng::sort(reported);
+    CHECK(failed == 0);
+    CHECK(reported.size() == result.size());
+    CHECK(std::adjacent_find(reported.begin(), reported.end()) == reported.end());
+
+    const auto& states = verifier.piece_states();
+    CHECK(states.count_verified(0, states.size()) == result.size());
+}
+
+TEST_CASE("verify v2 torrent with a tampered piece layer")
+{
+    fs::path root(TEST_DIR);
+
+    metafile m {};
+    auto& storage = m.storage();
+    storage.set_root_directory(root);
+
+    for (auto&f : fs::directory_iterator(root)) {
+        if (!f.is_regular_file()) continue;
+        storage.add_file(f);
+    }
+    storage.set_piece_size(16_KiB);
+    storage_hasher hasher(storage, {.protocol_version = protocol::v2});
+    hasher.start();
+    hasher.wait();
+
+    // the layer no longer hashes to the pieces root
+    auto file = std::find_if(storage.begin(), storage.end(),
+            [](const file_entry& e) { return e.piece_layer().size() > 1; });
+    REQUIRE(file != storage.end());
+    const auto file_index = std::size_t(std::distance(storage.begin(), file));
+    std::vector<sha256_hash> layer(file->piece_layer().begin(), file->piece_layer().end());
+    *layer.back().begin() ^= std::byte(1);
+    storage.at(file_index).set_piece_layer(layer);
+
+    std::size_t first_piece = 0;
+    for (std::size_t i = 0; i < file_index; ++i) {
+        first_piece += std::max(std::size_t(1), storage[i].piece_layer().size());
+    }
+
+    std::mutex mutex {};
+    std::vector<std::size_t> failed {};
+    std::size_t reported = 0;
+    storage_verifier verifier(storage, {
+        .piece_callback = [&](std::size_t piece_index, bool verified) {
+            std::unique_lock lck {mutex};
+            ++reported;
+            if (!verified) failed.push_back(piece_index);
+        }
+    });
+    verifier.start();
+    verifier.wait();
+    CHECK(verifier.done());
+
+    // every piece of the file fails, including pieces with a hash that is still correct
+    const auto& result = verifier.result();
+    rng::sort(failed);
+    CHECK(reported == result.size());
+    REQUIRE(failed.size() == layer.size());
+    for (std::size_t i = 0; i < layer.size(); ++i) {
+        CHECK(failed[i] == first_piece + i);
+    }
+    CHECK(verifier.piece_states().count_verified(0, result.size()) == result.size() - layer.size());
+}
+
+TEST_CASE("verify a sample of the pieces")
+{
+    fs::path root(TEST_DIR);
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2);
+
+    metafile m {};
+    auto& storage = m.storage();
+    storage.set_root_directory(root);
+
+    for (auto&f : fs::directory_iterator(root)) {
+        if (!f.is_regular_file()) continue;
+        storage.add_file(f);
+    }
+    choose_piece_size(storage);
+    storage_hasher hasher(storage, {.protocol_version = protocol_version});
+    hasher.start();
+    hasher.wait();
+
+    storage_verifier verifier(storage, {
+        .protocol_version = protocol_version,
+        .sampling = piece_sampling_options{.fraction = 0.1, .seed = 1}
+    });
+    verifier.start();
+    verifier.wait();
+    CHECK(verifier.done());
+    CHECK(verifier.sampled());
+
+    // only the selected pieces are verified
+    const auto& result = verifier.result();
+    const auto& selection = verifier.selection();
+    REQUIRE(selection.size() == result.size());
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        CHECK(bool(result[i]) == selection.selected(i));
+    }
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        CHECK(verifier.sample_summary(i).intact());
+    }
+}
+
+
+/// Write files filled with their index to `root` and return a storage with a piece size of 16 KiB.
+static file_storage make_sampling_storage(const fs::path& root, std::span<const std::size_t> file_sizes)
+{
+    fs::create_directories(root);
+    file_storage storage {};
+    storage.set_root_directory(root);
+    storage.set_piece_size(16_KiB);
+
+    for (std::size_t i = 0; i < file_sizes.size(); ++i) {
+        const auto name = std::string(1, char('a' + i));
+        std::ofstream f(root / name, std::ios::binary | std::ios::trunc);
+        f << std::string(file_sizes[i], char('a' + i));
+        storage.add_file(file_entry{name, file_sizes[i]});
+    }
+    return storage;
+}
+
+TEST_CASE("sampled reader skips pieces of failed files")
+{
+    const auto root = fs::temp_directory_path() / "dottorrent-test-sampled-reader";
+    // piece 3 holds the end of "a", all of "b" and the start of "c"
+    const std::array<std::size_t, 3> file_sizes {3 * 16_KiB + 100, 10_KiB, 4 * 16_KiB};
+    auto storage = make_sampling_storage(root, file_sizes);
+    REQUIRE(storage.piece_count() == 8);
+
+    auto selection = std::make_shared<piece_selection>(storage, protocol::v1);
+    for (std::size_t i = 0; i < selection->size(); ++i) {
+        selection->select(i);
+    }
+
+    auto read_pieces = [&](std::size_t& bytes_read) {
+        auto queue = std::make_shared<data_chunk_queue>(64);
+        sampled_chunk_reader reader(storage, protocol::v1, 16_KiB, 64, selection);
+        reader.register_hash_queue(queue);
+        reader.start();
+        reader.wait();
+        bytes_read = reader.bytes_read();
+
+        std::vector<std::size_t> pieces {};
+        data_chunk chunk {};
+        while (queue->try_pop(chunk)) {
+            pieces.push_back(chunk.piece_index);
+        }
+        return pieces;
+    };
+
+    SECTION("pieces shared with files that did not fail are read") {
+        selection->mark_failed(1);
+        CHECK(selection->file_failed(0));
+        CHECK_FALSE(selection->file_failed(1));
+        CHECK_FALSE(selection->file_failed(2));
+
+        std::size_t bytes_read = 0;
+        CHECK(read_pieces(bytes_read) == std::vector<std::size_t>{3, 4, 5, 6, 7});
+        CHECK(bytes_read == storage.total_file_size() - 3 * 16_KiB);
+    }
+
+    SECTION("a shared piece fails all files it overlaps") {
+        selection->mark_failed(3);
+        CHECK(selection->file_failed(0));
+        CHECK(selection->file_failed(1));
+        CHECK(selection->file_failed(2));
+
+        std::size_t bytes_read = 0;
+        CHECK(read_pieces(bytes_read).empty());
+        CHECK(bytes_read == 0);
+    }
+    fs::remove_all(root);
+}
+
+TEST_CASE("verify a sample of the pieces of a corrupted copy")
+{
+    const auto root = fs::temp_directory_path() / "dottorrent-test-sampled-corrupt";
+    auto protocol_version = GENERATE(protocol::v1, protocol::v2);
+    auto stop_at_first_mismatch = GENERATE(false, true);
+
+    // "a" does not share pieces with the other files
+    const std::array<std::size_t, 3> file_sizes {40 * 16_KiB, 5 * 16_KiB + 100, 3000};
+    auto storage = make_sampling_storage(root, file_sizes);
+    storage_hasher hasher(storage, {.protocol_version = protocol_version});
+    hasher.start();
+    hasher.wait();
+
+    // the first piece of a file is always sampled
+    {
+        std::fstream f(root / "a", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(10);
+        f.put('x');
+    }
+
+    std::mutex mutex {};
+    std::vector<std::size_t> reported {};
+    std::vector<std::size_t> failed {};
+    storage_verifier verifier(storage, {
+        .protocol_version = protocol_version,
+        .piece_callback = [&](std::size_t piece_index, bool verified) {
+            std::unique_lock lck {mutex};
+            reported.push_back(piece_index);
+            if (!verified) failed.push_back(piece_index);
+        },
+        .sampling = piece_sampling_options{
+                .fraction = 0.25, .seed = 1, .stop_at_first_mismatch = stop_at_first_mismatch},
+    });
+    verifier.start();
+    verifier.wait();
+    CHECK(verifier.done());
+
+    const auto& states = verifier.piece_states();
+    CHECK(states.state(0) == piece_state::failed);
+    CHECK(verifier.result()[0] == 0);
+    CHECK(failed == std::vector<std::size_t>{0});
+
+    // every checked piece is reported once
+    rng::sort(reported);
+    CHECK(std::adjacent_find(reported.begin(), reported.end()) == reported.end());
+    std::size_t checked = 0;
+    for (std::size_t i = 0; i < states.size(); ++i) {
+        checked += states.state(i) != piece_state::pending;
+    }
+    CHECK(reported.size() == checked);
+
+    const auto summary = verifier.sample_summary(0);
+    CHECK(summary.failed == 1);
+    CHECK_FALSE(summary.intact());
+    CHECK(summary.confidence(0.01) == 1);
+    if (stop_at_first_mismatch) {
+        // pieces already read when the mismatch is found are still checked
+        CHECK(summary.verified + summary.failed <= summary.sampled);
+    }
+    else {
+        CHECK(summary.verified + summary.failed == summary.sampled);
+    }
+
+    for (std::size_t i = 1; i < storage.file_count(); ++i) {
+        CHECK(verifier.sample_summary(i).intact());
+    }
+    fs::remove_all(root);
+}
@@ -0,0 +1,189 @@
+#include <catch2/catch.hpp>
+
+#include <dottorrent/streaming_merkle_tree.hpp>
+#include <dottorrent/merkle_tree.hpp>
+#include <dottorrent/hasher/factory.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace dottorrent;
+
+
+static std::vector<sha256_hash> make_leaves(std::size_t count)
+{
+    auto hasher = make_hasher(hash_function::sha256);
+    std::vector<sha256_hash> leaves(count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        hasher->update(std::to_string(i));
+        hasher->finalize_to(leaves[i]);
+    }
+    return leaves;
+}
+
+
+TEST_CASE("Streaming merkle tree matches the full tree")
+{
+    using namespace Catch::Generators;
+
+    const std::size_t leaf_count = GENERATE(0, 1, 2, 3, 4, 5, 7, 8, 9, 31, 33, 100, 129);
+    const std::size_t piece_leaf_count = GENERATE(1, 2, 4, 16, 64);
+    const bool shuffle = GENERATE(false, true);
+
+    // an empty file has a single leaf with the hash of no data
+    auto leaves = make_leaves(std::max<std::size_t>(leaf_count, 1));
+
+    auto expected = merkle_tree<hash_function::sha256>(leaf_count);
+    for (std::size_t i = 0; i < leaves.size(); ++i) {
+        expected.set_leaf(i, leaves[i]);
+    }
+    expected.update();
+
+    std::vector<std::size_t> order(leaves.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (shuffle) {
+        std::shuffle(order.begin(), order.end(), std::mt19937(leaf_count));
+    }
+
+    auto tree = streaming_merkle_tree(leaf_count, piece_leaf_count);
+    for (auto i : order) {
+        tree.set_leaf(i, leaves[i]);
+    }
+    tree.finalize();
+
+    CHECK(tree.tree_height() == expected.tree_height());
+    CHECK(tree.root() == expected.root());
+
+    const auto layer_offset = std::size_t(std::countr_zero(piece_leaf_count));
+    if (layer_offset >= expected.tree_height()) {
+        CHECK(tree.piece_layer().empty());
+    }
+    else {
+        auto expected_layer = expected.get_layer(expected.tree_height() - layer_offset);
+        expected_layer = expected_layer.subspan(0, (leaf_count + piece_leaf_count - 1) / piece_leaf_count);
+        CHECK(std::ranges::equal(tree.piece_layer(), expected_layer));
+    }
+}
+
+TEST_CASE("Streaming merkle tree with missing leaves")
+{
+    constexpr std::size_t leaf_count = 37;
+    constexpr std::size_t piece_leaf_count = 4;
+    auto leaves = make_leaves(leaf_count);
+
+    auto expected = merkle_tree<hash_function::sha256>(leaf_count);
+    auto tree = streaming_merkle_tree(leaf_count, piece_leaf_count);
+
+    // skip a leaf in the middle of a piece and all leaves of another piece
+    for (std::size_t i = 0; i < leaf_count; ++i) {
+        if (i == 6 || (i >= 12 && i < 16)) continue;
+        expected.set_leaf(i, leaves[i]);
+        tree.set_leaf(i, leaves[i]);
+    }
+    expected.update();
+    tree.finalize();
+
+    CHECK(tree.root() == expected.root());
+}
+
+TEST_CASE("Streaming merkle tree with concurrent leaf writers")
+{
+    constexpr std::size_t leaf_count = 1000;
+    // pieces of a single leaf are not buffered
+    const std::size_t piece_leaf_count = GENERATE(1, 16);
+    constexpr std::size_t writer_count = 4;
+    auto leaves = make_leaves(leaf_count);
+
+    auto expected = merkle_tree<hash_function::sha256>(leaf_count);
+    for (std::size_t i = 0; i < leaf_count; ++i) {
+        expected.set_leaf(i, leaves[i]);
+    }
+    expected.update();
+
+    auto tree = streaming_merkle_tree(leaf_count, piece_leaf_count);
+    std::atomic<std::size_t> last_piece_count = 0;
+    {
+        // interleave the writers so that every piece is completed by a different thread than it started on
+        std::vector<std::jthread> writers {};
+        for (std::size_t t = 0; t < writer_count; ++t) {
+            writers.emplace_back([&, t]() {
+                for (std::size_t i = t; i < leaf_count; i += writer_count) {
+                    if (tree.set_leaf(i, leaves[i])) {
+                        ++last_piece_count;
+                    }
+                }
+            });
+        }
+    }
+    tree.finalize();
+
+    // a single writer completes the tree
+    CHECK(last_piece_count == 1);
+    CHECK(tree.root() == expected.root());
+}
+
+TEST_CASE("Streaming merkle tree reports pieces as they complete")
+{
+    constexpr std::size_t leaf_count = 37;
+    constexpr std::size_t piece_leaf_count = 4;
+    auto leaves = make_leaves(leaf_count);
+
+    auto tree = streaming_merkle_tree(leaf_count, piece_leaf_count);
+    std::vector<sha256_hash> reported(detail::div_ceil(leaf_count, piece_leaf_count));
+    std::vector<std::size_t> order {};
+    tree.set_piece_callback([&](std::size_t piece_index, const sha256_hash& hash) {
+        reported[piece_index] = hash;
+        order.push_back(piece_index);
+    });
+
+    // the last piece first, a piece is reported when its last leaf is set
+    std::size_t completed = 0;
+    for (std::size_t i = leaf_count; i-- > 0; ) {
+        completed += tree.set_leaf(i, leaves[i]);
+        if (i == 36) {
+            CHECK(order == std::vector<std::size_t>{9});
+        }
+    }
+    CHECK(completed == 1);
+
+    tree.finalize();
+    CHECK(std::ranges::equal(reported, tree.piece_layer()));
+    CHECK(order.size() == reported.size());
+}
+
+TEST_CASE("Streaming merkle tree with restored piece hashes")
+{
+    constexpr std::size_t leaf_count = 37;
+    constexpr std::size_t piece_leaf_count = 4;
+    auto leaves = make_leaves(leaf_count);
+
+    auto expected = streaming_merkle_tree(leaf_count, piece_leaf_count);
+    for (std::size_t i = 0; i < leaf_count; ++i) {
+        expected.set_leaf(i, leaves[i]);
+    }
+    expected.finalize();
+
+    // restore the even pieces, hash the leaves of the odd pieces
+    auto tree = streaming_merkle_tree(leaf_count, piece_leaf_count);
+    const auto layer = expected.piece_layer();
+    bool complete = false;
+    for (std::size_t piece = 0; piece < layer.size(); piece += 2) {
+        complete |= tree.set_piece_hash(piece, layer[piece]);
+    }
+    for (std::size_t i = 0; i < leaf_count; ++i) {
+        if ((i / piece_leaf_count) % 2 == 1) {
+            complete |= tree.set_leaf(i, leaves[i]);
+        }
+    }
+    CHECK(complete);
+
+    tree.finalize();
+    CHECK(tree.root() == expected.root());
+    CHECK(std::ranges::equal(tree.piece_layer(), expected.piece_layer()));
+}